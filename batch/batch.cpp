@@ -0,0 +1,857 @@
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <xmmintrin.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+#include "../framework/boundedQueue.h"
+#include "../framework/bezierTessellation.h"
+#include "../framework/softRasterizer.h"
+#include "../framework/edgeFilter.h"
+#include "../framework/imageEncoder.h"
+#include "../framework/threadPool.h"
+#include "../framework/cpuTopology.h"
+#include "../framework/pnm.h"
+#include "../framework/hostMemory.h"
+#include "../framework/timer.h"
+#include "../sobel/teapot.h"
+
+// Headless edge detection of many images. Each step runs in its own stage
+// with dedicated threads, stages are connected by bounded queues.
+
+struct Options
+{
+    std::vector<std::string> inputs;
+    std::string outputDir = ".";
+    uint32_t readThreads = 2;
+    uint32_t decodeThreads = 2;
+    uint32_t filterThreads = std::max(1U, std::thread::hardware_concurrency());
+    uint32_t encodeThreads = 2;
+    size_t queueCapacity = 16;
+    uint32_t rawWidth = 0;
+    uint32_t rawHeight = 0;
+    PixelFormat rawFormat = PixelFormat::R8;
+    ImageFileFormat outputFormat = ImageFileFormat::Pgm;
+    bool benchmarkEncoders = false;
+    uint32_t renderViews = 0;
+    uint32_t renderWidth = 1280;
+    uint32_t renderHeight = 720;
+    uint32_t subdivisionDegree = 8;
+    utilities::LargeAllocationPolicy largeAllocations;
+    uint32_t allocBenchmarkMegabytes = 0;
+    bool pinThreads = false;
+    uint32_t pinBenchmarkMegabytes = 0;
+    bool selfCheck = false;
+    bool verbose = false;
+};
+
+struct Job
+{
+    std::string path;
+    uint32_t view = 0;
+    std::vector<uint8_t> bytes;
+    Image image;
+    PixelBuffer edges;
+};
+
+typedef std::unique_ptr<Job> JobPtr;
+typedef BoundedQueue<JobPtr> JobQueue;
+
+class Stage : public NonCopyable
+{
+public:
+    // Returns number of bytes consumed by this stage
+    typedef std::function<size_t(Job&)> Process;
+
+    Stage(const char *name, uint32_t threadCount, JobQueue& input, JobQueue *output, Process process):
+        name(name), input(input), output(output), process(std::move(process)), alive(threadCount)
+    {
+        for (uint32_t i = 0; i < threadCount; ++i)
+            threads.emplace_back(&Stage::run, this);
+    }
+
+    ~Stage()
+    {
+        join();
+    }
+
+    void join()
+    {
+        for (auto& thread : threads)
+        {
+            if (thread.joinable())
+                thread.join();
+        }
+    }
+
+    void report(std::ostream& out, float seconds) const
+    {
+        const float busy = busyMicroseconds * 1e-6f / (seconds * threads.size());
+        out << std::left << std::setw(8) << name << std::right
+            << std::setw(8) << threads.size()
+            << std::setw(10) << items
+            << std::setw(8) << failures
+            << std::setw(12) << std::fixed << std::setprecision(1) << items / seconds
+            << std::setw(10) << bytes / (seconds * 1024.f * 1024.f)
+            << std::setw(8) << std::setprecision(0) << busy * 100.f << "%\n";
+    }
+
+private:
+    void run()
+    {
+        JobPtr job;
+        while (input.pop(job))
+        {
+            Timer timer;
+            timer.run();
+            try
+            {
+                bytes += process(*job);
+                ++items;
+            }
+            catch (const std::exception& exc)
+            {
+                std::cerr << job->path << ": " << exc.what() << std::endl;
+                ++failures;
+                continue;
+            }
+            busyMicroseconds += static_cast<uint64_t>(timer.millisecondsElapsed() * 1000.f);
+            if (output)
+                output->push(std::move(job));
+        }
+        if (0 == --alive && output)
+        {   // Last thread of stage terminates downstream
+            output->close();
+        }
+    }
+
+    const char *name;
+    JobQueue& input;
+    JobQueue *output;
+    Process process;
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> alive;
+    std::atomic<uint64_t> items{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> failures{0};
+    std::atomic<uint64_t> busyMicroseconds{0};
+};
+
+// Runs action when scope is left, either normally or by exception
+class ScopeExit : public NonCopyable
+{
+public:
+    explicit ScopeExit(std::function<void()> action): action(std::move(action)) {}
+    ~ScopeExit() { action(); }
+
+private:
+    std::function<void()> action;
+};
+
+static bool endsWith(const std::string& str, const char *suffix)
+{
+    const size_t len = strlen(suffix);
+    return str.size() >= len && 0 == str.compare(str.size() - len, len, suffix);
+}
+
+static bool isImageFile(const std::string& path)
+{
+    return endsWith(path, ".pgm") || endsWith(path, ".ppm") || endsWith(path, ".pnm") || endsWith(path, ".raw");
+}
+
+static void listDirectory(const std::string& dir, std::vector<std::string>& files)
+{
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA((dir + "\\*").c_str(), &data);
+    if (INVALID_HANDLE_VALUE == find)
+        return;
+    do
+    {
+        if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && isImageFile(data.cFileName))
+            files.push_back(dir + "\\" + data.cFileName);
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+#else
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return;
+    while (const dirent *entry = readdir(d))
+    {
+        const std::string path = dir + "/" + entry->d_name;
+        struct stat st;
+        if (0 == stat(path.c_str(), &st) && S_ISREG(st.st_mode) && isImageFile(path))
+            files.push_back(path);
+    }
+    closedir(d);
+#endif
+}
+
+static bool isDirectory(const std::string& path)
+{
+#ifdef _WIN32
+    const DWORD attributes = GetFileAttributesA(path.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat st;
+    return 0 == stat(path.c_str(), &st) && S_ISDIR(st.st_mode);
+#endif
+}
+
+static std::vector<std::string> collectFiles(const std::vector<std::string>& inputs)
+{
+    std::vector<std::string> files;
+    for (const auto& input : inputs)
+    {
+        if ('@' == input[0])
+        {   // File list, one path per line
+            std::ifstream list(input.substr(1));
+            if (!list.is_open())
+                throw std::runtime_error("failed to open file list \"" + input.substr(1) + "\"");
+            std::string line;
+            while (std::getline(list, line))
+            {
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                if (!line.empty())
+                    files.push_back(line);
+            }
+        }
+        else if (isDirectory(input))
+            listDirectory(input, files);
+        else
+            files.push_back(input);
+    }
+    return files;
+}
+
+static std::string outputPath(const std::string& outputDir, const std::string& path, ImageFileFormat format)
+{
+    size_t begin = path.find_last_of("/\\");
+    begin = (std::string::npos == begin) ? 0 : begin + 1;
+    size_t end = path.find_last_of('.');
+    if (std::string::npos == end || end < begin)
+        end = path.size();
+    return outputDir + "/" + path.substr(begin, end - begin) + getFileExtension(format);
+}
+
+static size_t readJob(Job& job)
+{
+    std::ifstream file(job.path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open file");
+    const std::streamsize size = file.tellg();
+    file.seekg(0);
+    job.bytes.resize(static_cast<size_t>(size));
+    if (!file.read(reinterpret_cast<char *>(job.bytes.data()), size))
+        throw std::runtime_error("failed to read file");
+    return job.bytes.size();
+}
+
+static size_t decodeJob(Job& job, const Options& options)
+{
+    if (endsWith(job.path, ".raw"))
+    {
+        job.image = decodeRaw(job.bytes.data(), job.bytes.size(),
+            options.rawWidth, options.rawHeight, options.rawFormat);
+    }
+    else
+        job.image = decodePnm(job.bytes.data(), job.bytes.size());
+    const size_t size = job.bytes.size();
+    std::vector<uint8_t>().swap(job.bytes);
+    return size;
+}
+
+template<typename T>
+static void filterPlane(const T *plane, uint32_t width, uint32_t height, uint8_t *edges, ThreadPool *pool)
+{
+    if (!pool)
+    {
+        detectEdges(plane, width, height, edges);
+        return;
+    }
+    // Same strips as pinning benchmark, each node of pinned pool filters its own range
+    const uint32_t stripHeight = 64;
+    const uint32_t stripCount = (height + stripHeight - 1) / stripHeight;
+    pool->parallelForNodes(stripCount, [&](uint32_t strip, uint32_t /* threadIndex */)
+    {
+        const uint32_t y = strip * stripHeight;
+        detectEdgesInRows(plane, width, height, y, std::min(stripHeight, height - y), edges);
+    });
+}
+
+// Pool is optional, without it image is filtered by calling thread
+static size_t filterJob(Job& job, ThreadPool *pool)
+{
+    const Image& image = job.image;
+    job.edges.resize(size_t(image.width) * image.height);
+    switch (image.format)
+    {
+    case PixelFormat::R8:
+        filterPlane(image.pixels.data(), image.width, image.height, job.edges.data(), pool);
+        break;
+    case PixelFormat::R16:
+        filterPlane(reinterpret_cast<const uint16_t *>(image.pixels.data()), image.width, image.height, job.edges.data(), pool);
+        break;
+    case PixelFormat::R32F:
+        filterPlane(reinterpret_cast<const float *>(image.pixels.data()), image.width, image.height, job.edges.data(), pool);
+        break;
+    }
+    const size_t size = image.pixels.size();
+    job.image.pixels = PixelBuffer();
+    return size;
+}
+
+static size_t renderJob(Job& job, SoftRasterizer& rasterizer, const IndexedMesh& mesh, uint32_t viewCount)
+{   // Same camera distance and height as interactive sample, but orbiting the teapot
+    const float angle = 2.f * 3.14159265f * job.view / viewCount;
+    const rapid::vector3 eye(8.f * std::sin(angle), 3.f, 8.f * std::cos(angle));
+    const rapid::vector3 center(0.f, 2.f, 0.f);
+    const rapid::vector3 up(0.f, 1.f, 0.f);
+    const float aspect = rasterizer.getWidth() / (float)rasterizer.getHeight();
+    const rapid::matrix viewProj = rapid::lookAtRH(eye, center, up) *
+        rapid::perspectiveFovRH(rapid::radians(60.f), aspect, 1.f, 100.f);
+    rasterizer.clear();
+    rasterizer.draw(mesh, reinterpret_cast<const float *>(&viewProj));
+    job.image.width = rasterizer.getWidth();
+    job.image.height = rasterizer.getHeight();
+    job.image.format = PixelFormat::R8;
+    job.image.pixels.resize(size_t(job.image.width) * job.image.height);
+    rasterizer.copyMask(job.image.pixels.data());
+    return job.image.pixels.size();
+}
+
+static size_t encodeJob(Job& job, const Options& options)
+{   // Images are already processed in parallel, so encode each one serially
+    EncodedBuffer data;
+    encodeImage(options.outputFormat, job.edges.data(), job.image.width, job.image.height, data);
+    if (!writeFile(outputPath(options.outputDir, job.path, options.outputFormat), data))
+        throw std::runtime_error("failed to write file");
+    return job.edges.size();
+}
+
+static void benchmarkEncoders(const Options& options, const std::string& path)
+{
+    Job job;
+    job.path = path;
+    readJob(job);
+    decodeJob(job, options);
+    filterJob(job, nullptr);
+    const uint32_t width = job.image.width;
+    const uint32_t height = job.image.height;
+    ThreadPool pool;
+    struct Encoder
+    {
+        const char *name;
+        std::function<void(EncodedBuffer&)> encode;
+    };
+    const Encoder encoders[] = {
+        {"pgm", [&](EncodedBuffer& out) { encodePgm(job.edges.data(), width, height, out); }},
+        {"qoi", [&](EncodedBuffer& out) { encodeQoi(job.edges.data(), width, height, out); }},
+        {"png none", [&](EncodedBuffer& out) { encodePng(job.edges.data(), width, height, out, PngFilter::None); }},
+        {"png sub", [&](EncodedBuffer& out) { encodePng(job.edges.data(), width, height, out, PngFilter::Sub); }},
+        {"png up", [&](EncodedBuffer& out) { encodePng(job.edges.data(), width, height, out, PngFilter::Up); }},
+        {"png", [&](EncodedBuffer& out) { encodePng(job.edges.data(), width, height, out); }},
+        {"png mt", [&](EncodedBuffer& out) { encodePng(job.edges.data(), width, height, out, PngFilter::Adaptive, &pool); }}
+    };
+    std::cout << width << "x" << height << " edge image, " << pool.getThreadCount() << " threads\n"
+        << "format        MB/s     ratio\n";
+    for (const auto& encoder : encoders)
+    {
+        EncodedBuffer out;
+        encoder.encode(out); // Warm up
+        uint32_t iterations = 0;
+        Timer timer;
+        timer.run();
+        float seconds = 0.f;
+        do
+        {
+            encoder.encode(out);
+            ++iterations;
+            seconds += timer.secondsElapsed();
+        } while (seconds < 1.f);
+        const float megabytes = iterations * job.edges.size() / (1024.f * 1024.f);
+        std::cout << std::left << std::setw(10) << encoder.name << std::right
+            << std::setw(8) << std::fixed << std::setprecision(1) << megabytes / seconds
+            << std::setw(10) << std::setprecision(3) << out.size() / float(job.edges.size()) << "\n";
+    }
+}
+
+static void benchmarkAllocators(const Options& options)
+{   // Float plane with 4096-wide rows, as fed to the edge filter
+    const uint32_t width = 4096;
+    const uint64_t rows = (uint64_t(options.allocBenchmarkMegabytes) << 20) / (width * 4);
+    if (rows > UINT32_MAX)
+        throw std::runtime_error("--alloc-benchmark size is too large");
+    const uint32_t height = std::max(3U, static_cast<uint32_t>(rows));
+    const size_t pixelCount = size_t(width) * height;
+    const utilities::LargeAllocationPolicy policy = utilities::getLargeAllocationPolicy();
+    utilities::LargeAllocationPolicy hugePolicy = policy;
+    if (utilities::HugePages::Off == hugePolicy.hugePages)
+        hugePolicy.hugePages = utilities::HugePages::Transparent;
+    utilities::LargeAllocationPolicy smallPagePolicy = policy; // Keeps --numa-node
+    smallPagePolicy.hugePages = utilities::HugePages::Off;
+    struct Allocator
+    {
+        const char *name;
+        utilities::LargeAllocationPolicy policy;
+        bool baseline;
+    };
+    const Allocator allocators[] = {
+        {"_mm_malloc 16", policy, true},
+        {"aligned 64", smallPagePolicy, false},
+        {"aligned 64 huge", hugePolicy, false}
+    };
+    std::cout << "Plane of " << width << "x" << height << " floats (" << pixelCount * sizeof(float) / (1024 * 1024) << " MB)\n"
+        << "allocator        touch GB/s   sum GB/s  sobel Mpix/s\n";
+    float checksum = 0.f; // Keeps results alive
+    for (const Allocator& allocator : allocators)
+    {
+        utilities::setLargeAllocationPolicy(allocator.policy);
+        Timer timer;
+        timer.run();
+        float *plane;
+        uint8_t *edges;
+        if (allocator.baseline)
+        {
+            plane = reinterpret_cast<float *>(_mm_malloc(pixelCount * sizeof(float), 16));
+            edges = reinterpret_cast<uint8_t *>(_mm_malloc(pixelCount, 16));
+        }
+        else
+        {
+            plane = reinterpret_cast<float *>(utilities::alignedAlloc(pixelCount * sizeof(float), utilities::cacheLineSize));
+            edges = reinterpret_cast<uint8_t *>(utilities::alignedAlloc(pixelCount, utilities::cacheLineSize));
+        }
+        if (!plane || !edges)
+            throw std::bad_alloc();
+        for (size_t i = 0; i < pixelCount; ++i)
+        {   // First touch pays for page faults
+            plane[i] = static_cast<float>((i * 2654435761U) >> 24 & 0xFF) * (1.f/255.f);
+        }
+        memset(edges, 0, pixelCount);
+        const float touchSeconds = std::max(timer.secondsElapsed(), 1e-6f);
+        const uint32_t passes = 4;
+        __m128 sum[4] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+        for (uint32_t pass = 0; pass < passes; ++pass)
+        {
+            for (size_t i = 0; i < pixelCount; i += 16)
+            {
+                sum[0] = _mm_add_ps(sum[0], _mm_load_ps(plane + i));
+                sum[1] = _mm_add_ps(sum[1], _mm_load_ps(plane + i + 4));
+                sum[2] = _mm_add_ps(sum[2], _mm_load_ps(plane + i + 8));
+                sum[3] = _mm_add_ps(sum[3], _mm_load_ps(plane + i + 12));
+            }
+        }
+        const float sumSeconds = std::max(timer.secondsElapsed(), 1e-6f);
+        detectEdges(plane, width, height, edges);
+        const float sobelSeconds = std::max(timer.secondsElapsed(), 1e-6f);
+        float lanes[4];
+        _mm_storeu_ps(lanes, _mm_add_ps(_mm_add_ps(sum[0], sum[1]), _mm_add_ps(sum[2], sum[3])));
+        checksum += lanes[0] + lanes[1] + lanes[2] + lanes[3] + edges[pixelCount / 2];
+        const float gigabytes = pixelCount * sizeof(float) / (1024.f * 1024.f * 1024.f);
+        std::cout << std::left << std::setw(16) << allocator.name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(11) << (gigabytes + pixelCount / (1024.f * 1024.f * 1024.f)) / touchSeconds
+            << std::setw(11) << gigabytes * passes / sumSeconds
+            << std::setw(14) << std::setprecision(1) << pixelCount / 1e6f / sobelSeconds << "\n";
+        if (allocator.baseline)
+        {
+            _mm_free(edges);
+            _mm_free(plane);
+        }
+        else
+        {
+            utilities::alignedFree(edges, pixelCount);
+            utilities::alignedFree(plane, pixelCount * sizeof(float));
+        }
+    }
+    utilities::setLargeAllocationPolicy(policy);
+    std::cout << "Checksum " << checksum << "\n";
+}
+
+static void benchmarkPinning(const Options& options)
+{   // Strips of float plane are first touched and filtered by the same pool
+    const CpuTopology topology = CpuTopology::probe();
+    std::cout << topology.getNodeCount() << " NUMA nodes:";
+    for (const auto& node : topology.getNodes())
+        std::cout << " node " << node.index << " (" << node.cpus.size() << " CPUs)";
+    std::cout << "\n";
+    const uint32_t width = 4096;
+    const uint64_t rows = (uint64_t(options.pinBenchmarkMegabytes) << 20) / (width * 4);
+    if (rows > UINT32_MAX)
+        throw std::runtime_error("--pin-benchmark size is too large");
+    const uint32_t height = std::max(3U, static_cast<uint32_t>(rows));
+    const uint32_t stripHeight = 64;
+    const uint32_t stripCount = (height + stripHeight - 1) / stripHeight;
+    const size_t pixelCount = size_t(width) * height;
+    std::cout << "Plane of " << width << "x" << height << " floats in " << stripCount << " strips\n"
+        << "pinning     threads  touch GB/s  sobel Mpix/s\n";
+    for (bool pinned : {false, true})
+    {
+        std::unique_ptr<ThreadPool> pool = pinned ?
+            std::make_unique<ThreadPool>(topology, options.filterThreads) :
+            std::make_unique<ThreadPool>(options.filterThreads);
+        auto forEachStrip = [&pool, pinned, stripCount](const ThreadPool::Task& task)
+        {   // Dynamic scheduling moves strips between nodes when not pinned
+            if (pinned)
+                pool->parallelForNodes(stripCount, task);
+            else
+                pool->parallelFor(stripCount, task);
+        };
+        auto stripRows = [height, stripHeight](uint32_t strip)
+        {
+            return std::min(stripHeight, height - strip * stripHeight);
+        };
+        float *plane = reinterpret_cast<float *>(utilities::alignedAlloc(pixelCount * sizeof(float), utilities::cacheLineSize));
+        uint8_t *edges = reinterpret_cast<uint8_t *>(utilities::alignedAlloc(pixelCount, utilities::cacheLineSize));
+        if (!plane || !edges)
+            throw std::bad_alloc();
+        Timer timer;
+        timer.run();
+        forEachStrip([&](uint32_t strip, uint32_t /* threadIndex */)
+        {   // Page is placed on node of the thread that touches it first
+            const size_t first = size_t(strip) * stripHeight * width;
+            const size_t count = size_t(stripRows(strip)) * width;
+            for (size_t i = first; i < first + count; ++i)
+                plane[i] = static_cast<float>((i * 2654435761U) >> 24 & 0xFF) * (1.f/255.f);
+            memset(edges + first, 0, count);
+        });
+        const float touchSeconds = std::max(timer.secondsElapsed(), 1e-6f);
+        const uint32_t passes = 4;
+        for (uint32_t pass = 0; pass < passes; ++pass)
+        {
+            forEachStrip([&](uint32_t strip, uint32_t /* threadIndex */)
+            {
+                detectEdgesInRows(plane, width, height, strip * stripHeight, stripRows(strip), edges);
+            });
+        }
+        const float sobelSeconds = std::max(timer.secondsElapsed(), 1e-6f);
+        const float gigabytes = pixelCount * (sizeof(float) + 1) / (1024.f * 1024.f * 1024.f);
+        std::cout << std::left << std::setw(12) << (pinned ? "on" : "off") << std::right
+            << std::setw(7) << pool->getThreadCount() << std::fixed << std::setprecision(2)
+            << std::setw(12) << gigabytes / touchSeconds
+            << std::setw(14) << std::setprecision(1) << pixelCount * passes / 1e6f / sobelSeconds << "\n";
+        utilities::alignedFree(edges, pixelCount);
+        utilities::alignedFree(plane, pixelCount * sizeof(float));
+    }
+}
+
+// Straightforward clamp-to-edge Sobel filter to compare vectorized one against
+static uint8_t referenceSobel(const uint8_t *pixels, uint32_t width, uint32_t height, int x, int y)
+{
+    auto lum = [&](int dx, int dy)
+    {
+        const int cx = std::min(std::max(x + dx, 0), int(width) - 1);
+        const int cy = std::min(std::max(y + dy, 0), int(height) - 1);
+        return pixels[cy * width + cx] / 255.f;
+    };
+    const float gx = (lum(1, -1) + 2.f * lum(1, 0) + lum(1, 1)) - (lum(-1, -1) + 2.f * lum(-1, 0) + lum(-1, 1));
+    const float gy = (lum(-1, 1) + 2.f * lum(0, 1) + lum(1, 1)) - (lum(-1, -1) + 2.f * lum(0, -1) + lum(1, -1));
+    const float grad = std::min(sqrtf(gx * gx + gy * gy), 1.f);
+    return static_cast<uint8_t>(grad * 255.f + 0.5f);
+}
+
+static bool checkEdgeFilter()
+{   // Narrow images run entirely in the scalar tail of the scanline,
+    // wider ones mix vector body and tail
+    bool passed = true;
+    for (uint32_t width = 1; width <= 9; ++width)
+    {
+        for (uint32_t height = 1; height <= 5; ++height)
+        {
+            std::vector<uint8_t> pixels(width * height);
+            for (uint32_t i = 0; i < width * height; ++i)
+                pixels[i] = static_cast<uint8_t>((i * 97 + 13) & 0xFF);
+            std::vector<uint8_t> edges(width * height), rowEdges(width * height);
+            detectEdges(pixels.data(), width, height, edges.data());
+            for (uint32_t y = 0; y < height; ++y)
+                detectEdgesInRows(pixels.data(), width, height, y, 1, rowEdges.data());
+            uint32_t mismatches = 0;
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {   // Vector path rounds half to even
+                    const int expected = referenceSobel(pixels.data(), width, height, x, y);
+                    const uint32_t i = y * width + x;
+                    if (std::abs(edges[i] - expected) > 1 || rowEdges[i] != edges[i])
+                        ++mismatches;
+                }
+            }
+            if (mismatches)
+            {
+                std::cout << "Edge filter " << width << "x" << height << ": " << mismatches << " pixels differ from reference\n";
+                passed = false;
+            }
+        }
+    }
+    std::cout << "Edge filter self-check " << (passed ? "passed" : "failed") << "\n";
+    return passed;
+}
+
+static void reportQueue(std::ostream& out, const char *name, const JobQueue& queue)
+{
+    const JobQueue::Stats stats = queue.getStats();
+    out << std::left << std::setw(8) << name << std::right
+        << std::setw(10) << queue.getCapacity()
+        << std::setw(10) << std::fixed << std::setprecision(2) << stats.averageOccupancy()
+        << std::setw(8) << stats.maxOccupancy
+        << std::setw(14) << std::setprecision(1) << stats.pushWaitMicroseconds * 0.001f
+        << std::setw(14) << stats.popWaitMicroseconds * 0.001f << "\n";
+}
+
+static void printUsage()
+{
+    std::cout << "Usage: batch [options] <file|directory|@list>...\n"
+        << "  -o <dir>              output directory\n"
+        << "  --read-threads <n>    threads of read stage\n"
+        << "  --decode-threads <n>  threads of decode stage\n"
+        << "  --filter-threads <n>  threads of filter stage\n"
+        << "  --encode-threads <n>  threads of encode/write stage\n"
+        << "  --queue <n>           capacity of each queue\n"
+        << "  --raw <w>x<h>[:16|:f] dimensions and format of .raw files\n"
+        << "  --format <pgm|qoi|png> output format\n"
+        << "  --benchmark           measure encoder throughput on the first image\n"
+        << "  --render <n>          rasterize n teapot views on CPU instead of reading files\n"
+        << "  --size <w>x<h>        dimensions of rendered views\n"
+        << "  --subdivision <n>     tessellation degree of rendered teapot\n"
+        << "  --huge-pages <off|transparent|explicit> page backing of large buffers\n"
+        << "  --numa-node <n>       bind large buffers to NUMA node\n"
+        << "  --alloc-benchmark <mb> compare SIMD throughput over buffers of allocators\n"
+        << "  --pin-threads         pin render and filter threads to CPUs of NUMA nodes\n"
+        << "  --pin-benchmark <mb>  compare strip filtering with pinning off and on\n"
+        << "  --self-check          compare edge filter against scalar reference on small images\n"
+        << "  -v                    print queue occupancy every second\n";
+}
+
+static Options parseCommandLine(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string
+        {
+            if (i + 1 >= argc)
+                throw std::runtime_error("missing value of " + arg);
+            return argv[++i];
+        };
+        if ("-o" == arg)
+            options.outputDir = value();
+        else if ("--read-threads" == arg)
+            options.readThreads = std::stoul(value());
+        else if ("--decode-threads" == arg)
+            options.decodeThreads = std::stoul(value());
+        else if ("--filter-threads" == arg)
+            options.filterThreads = std::stoul(value());
+        else if ("--encode-threads" == arg)
+            options.encodeThreads = std::stoul(value());
+        else if ("--queue" == arg)
+            options.queueCapacity = std::stoul(value());
+        else if ("--raw" == arg)
+        {
+            const std::string raw = value();
+            char format[8] = {0};
+            if (sscanf(raw.c_str(), "%ux%u:%7s", &options.rawWidth, &options.rawHeight, format) < 2)
+                throw std::runtime_error("invalid raw dimensions");
+            if (!strcmp(format, "16"))
+                options.rawFormat = PixelFormat::R16;
+            else if (!strcmp(format, "f"))
+                options.rawFormat = PixelFormat::R32F;
+        }
+        else if ("--format" == arg)
+        {
+            if (!parseImageFileFormat(value(), options.outputFormat))
+                throw std::runtime_error("unknown output format");
+        }
+        else if ("--benchmark" == arg)
+            options.benchmarkEncoders = true;
+        else if ("--render" == arg)
+            options.renderViews = std::stoul(value());
+        else if ("--size" == arg)
+        {
+            if (sscanf(value().c_str(), "%ux%u", &options.renderWidth, &options.renderHeight) != 2 ||
+                !options.renderWidth || !options.renderHeight)
+                throw std::runtime_error("invalid render size");
+        }
+        else if ("--subdivision" == arg)
+            options.subdivisionDegree = static_cast<uint32_t>(std::min(std::max(2UL, std::stoul(value())), 32UL));
+        else if ("--huge-pages" == arg)
+        {
+            const std::string pages = value();
+            if ("off" == pages)
+                options.largeAllocations.hugePages = utilities::HugePages::Off;
+            else if ("transparent" == pages)
+                options.largeAllocations.hugePages = utilities::HugePages::Transparent;
+            else if ("explicit" == pages)
+                options.largeAllocations.hugePages = utilities::HugePages::Explicit;
+            else
+                throw std::runtime_error("unknown huge page mode");
+        }
+        else if ("--numa-node" == arg)
+            options.largeAllocations.numaNode = std::stoi(value());
+        else if ("--alloc-benchmark" == arg)
+            options.allocBenchmarkMegabytes = std::stoul(value());
+        else if ("--pin-threads" == arg)
+            options.pinThreads = true;
+        else if ("--pin-benchmark" == arg)
+            options.pinBenchmarkMegabytes = std::stoul(value());
+        else if ("--self-check" == arg)
+            options.selfCheck = true;
+        else if ("-v" == arg)
+            options.verbose = true;
+        else if ('-' == arg[0])
+            throw std::runtime_error("unknown option " + arg);
+        else
+            options.inputs.push_back(arg);
+    }
+    options.readThreads = std::max(1U, options.readThreads);
+    options.decodeThreads = std::max(1U, options.decodeThreads);
+    options.filterThreads = std::max(1U, options.filterThreads);
+    options.encodeThreads = std::max(1U, options.encodeThreads);
+    return options;
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        const Options options = parseCommandLine(argc, argv);
+        utilities::setLargeAllocationPolicy(options.largeAllocations);
+        if (options.selfCheck)
+            return checkEdgeFilter() ? 0 : 1;
+        if (options.allocBenchmarkMegabytes)
+        {
+            benchmarkAllocators(options);
+            return 0;
+        }
+        if (options.pinBenchmarkMegabytes)
+        {
+            benchmarkPinning(options);
+            return 0;
+        }
+        const bool render = options.renderViews > 0;
+        if (options.inputs.empty() && !render)
+        {
+            printUsage();
+            return 1;
+        }
+        std::vector<std::string> files;
+        if (render)
+        {   // Names only determine output files
+            for (uint32_t i = 0; i < options.renderViews; ++i)
+            {
+                const std::string index = std::to_string(i);
+                files.push_back("teapot" + std::string(6 - std::min<size_t>(6, index.size()), '0') + index + ".pgm");
+            }
+        }
+        else
+            files = collectFiles(options.inputs);
+        if (options.benchmarkEncoders)
+        {
+            if (!files.empty())
+                benchmarkEncoders(options, files.front());
+            return 0;
+        }
+        std::unique_ptr<ThreadPool> renderPool;
+        std::unique_ptr<SoftRasterizer> rasterizer;
+        IndexedMesh teapot;
+        if (render)
+        {   // Single render thread, tiles of each view are rasterized by the pool
+            teapot = tessellateBezierPatches(teapotPatches, kTeapotNumPatches, teapotVertices, options.subdivisionDegree);
+            renderPool = options.pinThreads ?
+                std::make_unique<ThreadPool>(CpuTopology::probe(), options.filterThreads) :
+                std::make_unique<ThreadPool>(options.filterThreads);
+            rasterizer = std::make_unique<SoftRasterizer>(options.renderWidth, options.renderHeight, renderPool.get());
+            std::cout << "Rendering " << files.size() << " views of " << teapot.getTriangleCount() << " triangles\n";
+        }
+        else
+            std::cout << "Processing " << files.size() << " files\n";
+        std::unique_ptr<ThreadPool> filterPool;
+        if (options.pinThreads)
+        {   // Render pool may be busy with the next view, so filter has its own one;
+            // single stage thread hands strips of each image to pinned workers
+            filterPool = std::make_unique<ThreadPool>(CpuTopology::probe(), options.filterThreads);
+        }
+        JobQueue pathQueue(options.queueCapacity);
+        JobQueue readQueue(options.queueCapacity);
+        JobQueue decodeQueue(options.queueCapacity);
+        JobQueue filterQueue(options.queueCapacity);
+        std::atomic<bool> done(false);
+        std::thread monitor;
+        Timer timer;
+        timer.run();
+        Stage read(render ? "render" : "read", render ? 1 : options.readThreads, pathQueue, &readQueue,
+            [&](Job& job) { return render ? renderJob(job, *rasterizer, teapot, options.renderViews) : readJob(job); });
+        Stage decode("decode", options.decodeThreads, readQueue, &decodeQueue,
+            [&options, render](Job& job) -> size_t { return render ? 0 : decodeJob(job, options); });
+        Stage filter("filter", filterPool ? 1 : options.filterThreads, decodeQueue, &filterQueue,
+            [&filterPool](Job& job) { return filterJob(job, filterPool.get()); });
+        Stage encode("encode", options.encodeThreads, filterQueue, nullptr,
+            [&options](Job& job) { return encodeJob(job, options); });
+        ScopeExit shutdown([&]()
+        {   // If anything throws before queues are closed, stage threads would wait
+            // for input forever and their destructors would never return
+            pathQueue.close();
+            readQueue.close();
+            decodeQueue.close();
+            filterQueue.close();
+            done = true;
+            if (monitor.joinable())
+                monitor.join();
+        });
+        monitor = std::thread([&]()
+        {   // Shows where jobs pile up while running
+            while (options.verbose && !done)
+            {
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+                std::cout << "queues: read " << readQueue.size()
+                    << ", decode " << decodeQueue.size()
+                    << ", filter " << filterQueue.size() << "\n";
+            }
+        });
+        for (const auto& path : files)
+        {   // Blocks when read stage falls behind
+            JobPtr job(std::make_unique<Job>());
+            job->path = path;
+            job->view = static_cast<uint32_t>(&path - files.data());
+            pathQueue.push(std::move(job));
+        }
+        pathQueue.close();
+        read.join();
+        decode.join();
+        filter.join();
+        encode.join();
+        const float seconds = std::max(timer.secondsElapsed(), 1e-6f);
+        done = true;
+        monitor.join();
+        std::cout << "\nstage    threads     items  failed     items/s      MB/s    busy\n";
+        read.report(std::cout, seconds);
+        decode.report(std::cout, seconds);
+        filter.report(std::cout, seconds);
+        encode.report(std::cout, seconds);
+        std::cout << "\nqueue    capacity   avg occ max occ  push wait ms   pop wait ms\n";
+        reportQueue(std::cout, "path", pathQueue);
+        reportQueue(std::cout, "read", readQueue);
+        reportQueue(std::cout, "decode", decodeQueue);
+        reportQueue(std::cout, "filter", filterQueue);
+        std::cout << "\nTotal " << std::setprecision(2) << seconds << " s\n";
+    }
+    catch (const std::exception& exc)
+    {
+        std::cerr << "Error: " << exc.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
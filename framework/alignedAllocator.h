@@ -1,5 +1,7 @@
 #pragma once
-#include <xmmintrin.h>
+#include <new>
+#include <type_traits>
+#include "hostMemory.h"
 
 #ifndef _DECLSPEC_ALLOCATOR
 #define _DECLSPEC_ALLOCATOR
@@ -8,9 +10,15 @@
 namespace utilities
 {
         // CLASS TEMPLATE allocator
-template<class _Ty>
+        // Default alignment of 16 suits SSE loads; pass 64 to keep streams on
+        // separate cache lines and to suit AVX-512 loads.
+        // Large blocks are page-mapped, see LargeAllocationPolicy.
+template<class _Ty,
+	size_t _Alignment = 16>
 	class aligned_allocator
 	{	// generic allocator for objects of class _Ty
+	static_assert(_Alignment >= alignof(_Ty) && !(_Alignment & (_Alignment - 1)),
+		"alignment should be power of two not less than alignment of type");
 public:
 #ifdef _MSC_VER
 	static_assert(!std::is_const_v<_Ty>,
@@ -25,7 +33,10 @@ public:
 	using is_always_equal = std::true_type;
 
     template<class _Other>
-	using other = aligned_allocator<_Other>;
+	struct rebind
+		{	// non-type parameter prevents default rebind of allocator_traits
+		using other = aligned_allocator<_Other, _Alignment>;
+		};
 
 	aligned_allocator() noexcept
 		{	// construct default allocator (do nothing)
@@ -33,35 +44,39 @@ public:
 
 	aligned_allocator(const aligned_allocator&) noexcept = default;
 	template<class _Other>
-		aligned_allocator(const aligned_allocator<_Other>&) noexcept
+		aligned_allocator(const aligned_allocator<_Other, _Alignment>&) noexcept
 		{	// construct from a related allocator (do nothing)
 		}
 
 	void deallocate(_Ty * const _Ptr, const size_t _Count)
 		{	// deallocate object at _Ptr
-		_mm_free(_Ptr);
+		alignedFree(_Ptr, _Count * sizeof(_Ty));
 		}
 
 	_DECLSPEC_ALLOCATOR _Ty * allocate(const size_t _Count)
 		{	// allocate array of _Count elements
-		void* ptr = _mm_malloc(_Count * sizeof(_Ty), 16);
+		void* ptr = alignedAlloc(_Count * sizeof(_Ty), _Alignment);
+		if (!ptr)
+			throw std::bad_alloc();
                 return reinterpret_cast<_Ty *>(ptr);
 		}
 	};
 
     // http://en.cppreference.com/w/cpp/memory/allocator/operator_cmp
     template<class _Ty,
-	    class _Other> inline
-	    bool operator==(const aligned_allocator<_Ty>&,
-                const aligned_allocator<_Other>&) noexcept
+	    class _Other,
+	    size_t _Alignment> inline
+	    bool operator==(const aligned_allocator<_Ty, _Alignment>&,
+                const aligned_allocator<_Other, _Alignment>&) noexcept
 	    {	// test for allocator equality
             return (true);
 	    }
 
     template<class _Ty,
-	    class _Other> inline
-	    bool operator!=(const aligned_allocator<_Ty>&,
-                const aligned_allocator<_Other>&) noexcept
+	    class _Other,
+	    size_t _Alignment> inline
+	    bool operator!=(const aligned_allocator<_Ty, _Alignment>&,
+                const aligned_allocator<_Other, _Alignment>&) noexcept
 	    {	// test for allocator inequality
             return (false);
 	    }
@@ -0,0 +1,490 @@
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <new>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <dbghelp.h>
+#pragma comment(lib, "dbghelp.lib")
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
+#else
+#include <execinfo.h>
+#endif
+#include "allocationAudit.h"
+
+constexpr uint32_t maxZones = 32;
+constexpr uint32_t maxCallStacks = 64;
+constexpr uint32_t maxStackDepth = 24;
+
+struct ZoneCounters
+{
+    const char *name;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> steadyCount;
+    std::atomic<uint64_t> steadyBytes;
+};
+
+struct CallStack
+{
+    uint64_t hash;
+    void *frames[maxStackDepth];
+    uint32_t depth;
+    uint32_t zone;
+    uint64_t count;
+    uint64_t bytes;
+};
+
+constexpr uint32_t noZone = 0; // Render thread outside of any zone
+constexpr uint32_t otherThreads = 1;
+
+static ZoneCounters zones[maxZones];
+static std::atomic<uint32_t> zoneCount(2);
+static std::atomic_flag zoneLock = ATOMIC_FLAG_INIT;
+static CallStack callStacks[maxCallStacks];
+static uint32_t callStackCount;
+static uint64_t droppedCallStacks;
+static std::atomic_flag callStackLock = ATOMIC_FLAG_INIT;
+static thread_local uint32_t currentZone;
+static thread_local bool inHook;
+static thread_local bool renderThread; // Only its allocations belong to frame
+
+static std::atomic<bool> enabled(false);
+static std::atomic<bool> steadyState(false);
+static std::atomic<uint64_t> frameCount(0);
+static std::atomic<uint64_t> frameBytes(0);
+static bool assertSteadyState;
+static uint32_t warmupFrames;
+static uint32_t frameIndex;
+static uint32_t steadyFrames;
+static uint32_t allocatingFrames; // Steady-state frames with at least one allocation
+static uint64_t maxFrameCount;
+static uint64_t maxFrameBytes;
+
+class SpinLock
+{
+public:
+    explicit SpinLock(std::atomic_flag& flag) noexcept: flag(flag)
+        { while (flag.test_and_set(std::memory_order_acquire)); }
+    ~SpinLock() { flag.clear(std::memory_order_release); }
+
+private:
+    std::atomic_flag& flag;
+};
+
+static uint32_t captureCallStack(void **frames, uint32_t maxDepth) noexcept
+{
+#ifdef _WIN32
+    return CaptureStackBackTrace(2, maxDepth, frames, nullptr);
+#else
+    return static_cast<uint32_t>(backtrace(frames, static_cast<int>(maxDepth)));
+#endif
+}
+
+static void recordCallStack(size_t size) noexcept
+{
+    void *frames[maxStackDepth];
+    const uint32_t depth = captureCallStack(frames, maxStackDepth);
+    uint64_t hash = 14695981039346656037ull; // FNV-1a over return addresses
+    for (uint32_t i = 0; i < depth; ++i)
+        hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i])) * 1099511628211ull;
+    SpinLock lock(callStackLock);
+    for (uint32_t i = 0; i < callStackCount; ++i)
+    {
+        CallStack& stack = callStacks[i];
+        if (stack.hash == hash && stack.depth == depth && stack.zone == currentZone)
+        {
+            ++stack.count;
+            stack.bytes += size;
+            return;
+        }
+    }
+    if (callStackCount == maxCallStacks)
+    {
+        ++droppedCallStacks;
+        return;
+    }
+    CallStack& stack = callStacks[callStackCount++];
+    stack.hash = hash;
+    memcpy(stack.frames, frames, sizeof(void *) * depth);
+    stack.depth = depth;
+    stack.zone = currentZone;
+    stack.count = 1;
+    stack.bytes = size;
+}
+
+static void printCallStack(std::ostream& out, const CallStack& stack)
+{
+#ifdef _WIN32
+    const HANDLE process = GetCurrentProcess();
+    static const bool symbols = (TRUE == SymInitialize(process, nullptr, TRUE));
+    char buffer[sizeof(SYMBOL_INFO) + 256];
+    SYMBOL_INFO *symbol = reinterpret_cast<SYMBOL_INFO *>(buffer);
+    for (uint32_t i = 0; i < stack.depth; ++i)
+    {
+        const DWORD64 address = reinterpret_cast<DWORD64>(stack.frames[i]);
+        symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+        symbol->MaxNameLen = 255;
+        DWORD64 displacement = 0;
+        out << "        ";
+        if (symbols && SymFromAddr(process, address, &displacement, symbol))
+        {
+            out << symbol->Name;
+            IMAGEHLP_LINE64 line = {sizeof(IMAGEHLP_LINE64)};
+            DWORD lineDisplacement = 0;
+            if (SymGetLineFromAddr64(process, address, &lineDisplacement, &line))
+                out << " (" << line.FileName << ":" << line.LineNumber << ")";
+        }
+        else
+            out << stack.frames[i];
+        out << "\n";
+    }
+#else
+    char **symbols = backtrace_symbols(stack.frames, static_cast<int>(stack.depth));
+    for (uint32_t i = 0; i < stack.depth; ++i)
+        out << "        " << (symbols ? symbols[i] : "?") << "\n";
+    free(symbols);
+#endif
+}
+
+#if defined(ALLOCATION_AUDIT) && defined(_MSC_VER) && defined(_DEBUG)
+static int crtAllocHook(int allocType, void * /* userData */, size_t size, int blockType,
+    long /* request */, const unsigned char * /* filename */, int /* line */)
+{   // Skip CRT internal blocks, operator new is counted by itself
+    if ((_HOOK_ALLOC == allocType || _HOOK_REALLOC == allocType) && blockType != _CRT_BLOCK)
+        AllocationAudit::onAllocation(size);
+    return TRUE;
+}
+#endif
+
+void AllocationAudit::enable(uint32_t warmupFrames, bool assertSteadyState)
+{
+    ::warmupFrames = warmupFrames;
+    ::assertSteadyState = assertSteadyState;
+    zones[noZone].name = "(none)";
+    zones[otherThreads].name = "(other threads)";
+    renderThread = true; // Until the first frame tells otherwise
+#ifndef _WIN32
+    void *frames[1]; // backtrace() loads unwinder and allocates on first call
+    backtrace(frames, 1);
+#endif
+#if defined(ALLOCATION_AUDIT) && defined(_MSC_VER) && defined(_DEBUG)
+    _CrtSetAllocHook(crtAllocHook);
+#endif
+    enabled = true;
+    if (!hooksInstalled())
+        std::cout << "Allocation audit covers magma objects only, build with ALLOCATION_AUDIT to hook operator new\n";
+}
+
+bool AllocationAudit::isEnabled() noexcept
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+bool AllocationAudit::hooksInstalled() noexcept
+{
+#ifdef ALLOCATION_AUDIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocationAudit::beginFrame() noexcept
+{
+    if (!isEnabled())
+        return;
+    renderThread = true;
+    frameCount = 0;
+    frameBytes = 0;
+    steadyState = (frameIndex >= warmupFrames);
+}
+
+void AllocationAudit::endFrame()
+{
+    if (!isEnabled())
+        return;
+    const uint64_t count = frameCount;
+    const uint64_t bytes = frameBytes;
+    const bool steady = steadyState;
+    steadyState = false;
+    ++frameIndex;
+    if (!steady)
+        return;
+    ++steadyFrames;
+    if (count)
+        ++allocatingFrames;
+    maxFrameCount = std::max(maxFrameCount, count);
+    maxFrameBytes = std::max(maxFrameBytes, bytes);
+    if (assertSteadyState && count)
+    {
+        printReport();
+        std::ostringstream msg;
+        msg << count << " heap allocations (" << bytes << " bytes) in steady-state frame " << frameIndex - 1;
+        throw std::runtime_error(msg.str());
+    }
+}
+
+void AllocationAudit::onAllocation(size_t size) noexcept
+{
+    if (!enabled.load(std::memory_order_relaxed) || inHook)
+        return;
+    inHook = true;
+    if (!renderThread)
+    {   // Background threads, e.g. readback writer, are reported but don't fail frames
+        ++zones[otherThreads].count;
+        zones[otherThreads].bytes += size;
+        inHook = false;
+        return;
+    }
+    ++frameCount;
+    frameBytes += size;
+    ZoneCounters& zone = zones[currentZone];
+    ++zone.count;
+    zone.bytes += size;
+    if (steadyState.load(std::memory_order_relaxed))
+    {
+        ++zone.steadyCount;
+        zone.steadyBytes += size;
+        recordCallStack(size);
+    }
+    inHook = false;
+}
+
+void AllocationAudit::printReport()
+{
+    const bool hook = inHook;
+    inHook = true; // Don't count own allocations
+    std::ostringstream out;
+    out << "Allocation audit: " << allocatingFrames << " of " << steadyFrames << " steady-state frames allocated";
+    if (steadyFrames)
+        out << ", at most " << maxFrameCount << " allocations (" << maxFrameBytes << " bytes) per frame";
+    out << "\n";
+    const uint32_t count = zoneCount;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const ZoneCounters& zone = zones[i];
+        if (!zone.count)
+            continue;
+        out << "    " << zone.name << ": " << zone.count << " allocations, " << zone.bytes << " bytes total";
+        if (steadyFrames && i != otherThreads)
+        {
+            out << ", " << zone.steadyCount / (double)steadyFrames << " allocations, "
+                << zone.steadyBytes / (double)steadyFrames << " bytes per steady-state frame";
+        }
+        out << "\n";
+    }
+    {
+        SpinLock lock(callStackLock);
+        for (uint32_t i = 0; i < callStackCount; ++i)
+        {
+            const CallStack& stack = callStacks[i];
+            out << "    " << stack.count << " allocations (" << stack.bytes << " bytes) in zone "
+                << zones[stack.zone].name << " from:\n";
+            printCallStack(out, stack);
+        }
+        if (droppedCallStacks)
+            out << "    " << droppedCallStacks << " allocations from other call stacks\n";
+    }
+    std::cout << out.str();
+    inHook = hook;
+}
+
+AllocationZone::AllocationZone(const char *name) noexcept:
+    parent(currentZone)
+{
+    if (!AllocationAudit::isEnabled())
+        return;
+    uint32_t count = zoneCount.load(std::memory_order_acquire);
+    for (uint32_t i = otherThreads + 1; i < count; ++i)
+    {
+        if (zones[i].name == name)
+        {
+            currentZone = i;
+            return;
+        }
+    }
+    SpinLock lock(zoneLock);
+    count = zoneCount.load(std::memory_order_relaxed);
+    for (uint32_t i = otherThreads + 1; i < count; ++i)
+    {   // Could be registered by other thread meanwhile
+        if (zones[i].name == name)
+        {
+            currentZone = i;
+            return;
+        }
+    }
+    if (count < maxZones)
+    {
+        zones[count].name = name;
+        zoneCount.store(count + 1, std::memory_order_release);
+        currentZone = count;
+    }
+}
+
+AllocationZone::~AllocationZone()
+{
+    currentZone = parent;
+}
+
+#ifdef ALLOCATION_AUDIT
+// Replacement of global allocation functions. Allocation itself goes to malloc()
+// with hook disabled, so that debug CRT hook doesn't count it twice.
+static void *allocate(size_t size) noexcept
+{
+    AllocationAudit::onAllocation(size);
+    const bool hook = inHook;
+    inHook = true;
+    void *p = malloc(size ? size : 1);
+    inHook = hook;
+    return p;
+}
+
+void *operator new(size_t size)
+{
+    void *p = allocate(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    void *p = allocate(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t&) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t&) noexcept
+{
+    free(p);
+}
+
+#ifdef __cpp_aligned_new
+// Over-aligned types bypass the functions above, so they are replaced too
+static void *allocateAligned(size_t size, std::align_val_t alignment) noexcept
+{
+    AllocationAudit::onAllocation(size);
+    const bool hook = inHook;
+    inHook = true;
+#ifdef _WIN32
+    void *p = _aligned_malloc(size ? size : 1, static_cast<size_t>(alignment));
+#else
+    void *p = nullptr;
+    if (posix_memalign(&p, std::max(static_cast<size_t>(alignment), sizeof(void *)), size ? size : 1))
+        p = nullptr;
+#endif
+    inHook = hook;
+    return p;
+}
+
+static void freeAligned(void *p) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    void *p = allocateAligned(size, alignment);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+    void *p = allocateAligned(size, alignment);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    freeAligned(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    freeAligned(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{
+    freeAligned(p);
+}
+
+void operator delete[](void *p, size_t, std::align_val_t) noexcept
+{
+    freeAligned(p);
+}
+
+void operator delete(void *p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    freeAligned(p);
+}
+
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    freeAligned(p);
+}
+#endif // __cpp_aligned_new
+#endif // ALLOCATION_AUDIT
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "nonCopyable.h"
+
+// Counts heap allocations per frame and per zone to confirm that render loop
+// doesn't allocate once it reaches steady state. Global operator new/delete
+// are replaced only if ALLOCATION_AUDIT is defined (Debug configurations),
+// with MSVC debug CRT malloc() is reported through allocation hook as well.
+// Magma objects are counted by AuditObjectAllocator in any configuration.
+// Only the thread that calls beginFrame() is counted against frames, other
+// threads (e.g. readback writer) are totalled in a zone of their own.
+// Call stacks of allocations in steady-state frames are collected into a
+// fixed table, as nothing may be allocated from inside the hook.
+class AllocationAudit
+{
+public:
+    // Frames after warm-up are steady state. If assertion is requested,
+    // endFrame() throws on the first steady-state frame that allocated.
+    static void enable(uint32_t warmupFrames, bool assertSteadyState);
+    static bool isEnabled() noexcept;
+    static bool hooksInstalled() noexcept;
+    static void beginFrame() noexcept;
+    static void endFrame();
+    static void onAllocation(size_t size) noexcept;
+    static void printReport();
+};
+
+// Attributes allocations of the calling thread to named zone while in scope.
+// Name should be string literal, zones are told apart by pointer.
+class AllocationZone : public NonCopyable
+{
+public:
+    explicit AllocationZone(const char *name) noexcept;
+    ~AllocationZone();
+
+private:
+    uint32_t parent;
+};
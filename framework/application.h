@@ -11,7 +11,7 @@
 #include "platform.h"
 #include "nonCopyable.h"
 
-class IApplication : public AlignAs<16>, public NonCopyable
+class IApplication : public AlignAs<utilities::cacheLineSize>, public NonCopyable
 {
 public:
     virtual void setWindowCaption(const std::tstring& caption) = 0;
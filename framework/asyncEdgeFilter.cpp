@@ -0,0 +1,404 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include "asyncEdgeFilter.h"
+#include "shader.h"
+#include "../magma/magma.h"
+
+// Written by compute shader, then sampled for presentation. Unlike R8,
+// RGBA8 storage doesn't require shaderStorageImageExtendedFormats.
+class EdgeImage : public magma::Image
+{
+public:
+    EdgeImage(std::shared_ptr<magma::Device> device, uint32_t width, uint32_t height):
+        magma::Image(device, VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_UNORM, VkExtent3D{width, height, 1},
+            1, // Mip levels
+            1, // Array layers
+            1, // Samples
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            0)
+    {}
+};
+
+// Collects semaphores of one submission, magma::Queue::submit() takes only one of each
+class Batch
+{
+public:
+    void wait(VkSemaphore semaphore, VkPipelineStageFlags stage) noexcept
+    {
+        waitSemaphores[waitCount] = semaphore;
+        waitStages[waitCount++] = stage;
+    }
+
+    void signal(VkSemaphore semaphore) noexcept
+    {
+        signalSemaphores[signalCount++] = semaphore;
+    }
+
+    void submit(VkQueue queue, VkCommandBuffer cmdBuffer, VkFence fence) const
+    {
+        VkSubmitInfo info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        info.waitSemaphoreCount = waitCount;
+        info.pWaitSemaphores = waitSemaphores;
+        info.pWaitDstStageMask = waitStages;
+        info.commandBufferCount = 1;
+        info.pCommandBuffers = &cmdBuffer;
+        info.signalSemaphoreCount = signalCount;
+        info.pSignalSemaphores = signalSemaphores;
+        if (vkQueueSubmit(queue, 1, &info, fence) != VK_SUCCESS)
+            throw std::runtime_error("failed to submit command buffer");
+    }
+
+private:
+    VkSemaphore waitSemaphores[2];
+    VkPipelineStageFlags waitStages[2];
+    uint32_t waitCount = 0;
+    VkSemaphore signalSemaphores[2];
+    uint32_t signalCount = 0;
+};
+
+static void imageBarrier(VkCommandBuffer cmdBuffer, VkImage image,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkImageLayout oldLayout,
+    VkPipelineStageFlags dstStage, VkAccessFlags dstAccess, VkImageLayout newLayout,
+    uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t dstFamily = VK_QUEUE_FAMILY_IGNORED)
+{
+    VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = srcFamily;
+    barrier.dstQueueFamilyIndex = dstFamily;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(cmdBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+// Release half of ownership transfer. Destination access is ignored,
+// writes are made visible by acquire barrier on the other queue.
+static void releaseImage(VkCommandBuffer cmdBuffer, VkImage image, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+    VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t srcFamily, uint32_t dstFamily)
+{
+    if (srcFamily == dstFamily)
+        srcFamily = dstFamily = VK_QUEUE_FAMILY_IGNORED; // Plain layout transition
+    imageBarrier(cmdBuffer, image, srcStage, srcAccess, oldLayout,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, newLayout, srcFamily, dstFamily);
+}
+
+// Acquire half should be in the stage that semaphore wait blocks, so that the two are chained
+static void acquireImage(VkCommandBuffer cmdBuffer, VkImage image, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess,
+    VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t srcFamily, uint32_t dstFamily)
+{
+    if (srcFamily == dstFamily)
+    {   // Layout has been transitioned by release barrier
+        srcFamily = dstFamily = VK_QUEUE_FAMILY_IGNORED;
+        oldLayout = newLayout;
+    }
+    imageBarrier(cmdBuffer, image, dstStage, 0, oldLayout, dstStage, dstAccess, newLayout, srcFamily, dstFamily);
+}
+
+AsyncEdgeFilter::AsyncEdgeFilter(std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+    std::shared_ptr<magma::PipelineCache> pipelineCache,
+    std::shared_ptr<magma::Queue> graphicsQueue,
+    std::shared_ptr<magma::Queue> computeQueue,
+    std::shared_ptr<magma::CommandPool> computePool,
+    const std::vector<std::shared_ptr<magma::Image2D>>& masks,
+    const std::vector<std::shared_ptr<magma::ImageView>>& maskViews):
+    device(computePool->getDevice()),
+    graphicsQueue(graphicsQueue),
+    computeQueue(computeQueue),
+    graphicsFamily(graphicsQueue->getFamilyIndex()),
+    computeFamily(computeQueue->getFamilyIndex()),
+    timestampPeriod(physicalDevice->getProperties().limits.timestampPeriod)
+{
+    assert(masks.size() == frameCount && maskViews.size() == frameCount);
+    const VkDevice hDevice = *device;
+    const VkPhysicalDevice hPhysicalDevice = *physicalDevice;
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(hPhysicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(hPhysicalDevice, &familyCount, families.data());
+    if (families[graphicsFamily].timestampValidBits && families[computeFamily].timestampValidBits)
+    {   // Graphics and compute queries of each frame slot
+        VkQueryPoolCreateInfo queryPoolInfo = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = frameCount * QueryCount;
+        if (vkCreateQueryPool(hDevice, &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+            queryPool = VK_NULL_HANDLE;
+        trace.reserve(maxTraceFrames); // Render loop shouldn't allocate
+    }
+    // Setup descriptor sets
+    sampler = std::make_shared<magma::Sampler>(device, magma::samplers::magMinLinearMipNearestClampToEdge);
+    const magma::Descriptor imageSamplerDesc = magma::descriptors::CombinedImageSampler(1);
+    const magma::Descriptor storageImageDesc = magma::descriptors::StorageImage(1);
+    descriptorPool = std::make_shared<magma::DescriptorPool>(device, frameCount,
+        std::vector<magma::Descriptor>{
+            magma::descriptors::CombinedImageSampler(frameCount),
+            magma::descriptors::StorageImage(frameCount)
+        });
+    descriptorSetLayout = std::make_shared<magma::DescriptorSetLayout>(device,
+        std::initializer_list<magma::DescriptorSetLayout::Binding>{
+            magma::bindings::ComputeStageBinding(0, imageSamplerDesc), // Mask
+            magma::bindings::ComputeStageBinding(1, storageImageDesc)  // Edges
+        });
+    pipelineLayout = std::make_shared<magma::PipelineLayout>(descriptorSetLayout);
+    pipeline = std::make_shared<magma::ComputePipeline>(device, pipelineCache,
+        ComputeShader(device, "edgeFilter.o"), pipelineLayout);
+    const uint32_t width = masks[0]->getMipExtent(0).width;
+    const uint32_t height = masks[0]->getMipExtent(0).height;
+    for (uint32_t i = 0; i < frameCount; ++i)
+    {
+        Slot& slot = slots[i];
+        slot.mask = masks[i];
+        slot.edges = std::make_shared<EdgeImage>(device, width, height);
+        slot.edgeView = std::make_shared<magma::ImageView>(slot.edges);
+        slot.descriptorSet = descriptorPool->allocateDescriptorSet(descriptorSetLayout);
+        slot.descriptorSet->update(0, maskViews[i], sampler);
+        // Storage image is written in general layout
+        VkDescriptorImageInfo imageInfo;
+        imageInfo.sampler = VK_NULL_HANDLE;
+        imageInfo.imageView = *slot.edgeView;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        VkWriteDescriptorSet descriptorWrite = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+        descriptorWrite.dstSet = *slot.descriptorSet;
+        descriptorWrite.dstBinding = 1;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        descriptorWrite.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(hDevice, 1, &descriptorWrite, 0, nullptr);
+        slot.maskReady = std::make_shared<magma::Semaphore>(device);
+        slot.maskFree = std::make_shared<magma::Semaphore>(device);
+        slot.edgeReady = std::make_shared<magma::Semaphore>(device);
+        slot.edgeFree = std::make_shared<magma::Semaphore>(device);
+        constexpr bool signaled = true; // Don't wait on first frame of each slot
+        slot.maskFence = std::make_shared<magma::Fence>(device, signaled);
+        slot.filterFence = std::make_shared<magma::Fence>(device, signaled);
+        // Images and descriptor sets never change, so record once
+        slot.cmdBuffer = computePool->allocateCommandBuffer(true);
+        recordFilter(slot, i, width, height);
+    }
+    // The first frame presents edges of "previous" one
+    clearEdges(computePool, slots[getPresentSlot()]);
+}
+
+AsyncEdgeFilter::~AsyncEdgeFilter()
+{
+    if (queryPool)
+        vkDestroyQueryPool(*device, queryPool, nullptr);
+}
+
+uint32_t AsyncEdgeFilter::beginFrame()
+{
+    slots[getPresentSlot()].maskFence->wait(); // Inputs of mask render may be overwritten
+    const uint32_t index = static_cast<uint32_t>(frameIndex % frameCount);
+    Slot& slot = slots[index];
+    // Frame before previous one is done, so its command buffers are no longer pending
+    slot.maskFence->wait();
+    slot.filterFence->wait();
+    if (slot.submitted)
+        readTimestamps(slot, index);
+    slot.maskFence->reset();
+    slot.filterFence->reset();
+    return index;
+}
+
+uint32_t AsyncEdgeFilter::getPresentSlot() const noexcept
+{
+    return static_cast<uint32_t>((frameIndex + frameCount - 1) % frameCount);
+}
+
+std::shared_ptr<magma::ImageView> AsyncEdgeFilter::getEdgeView(uint32_t slot) const noexcept
+{
+    return slots[slot].edgeView;
+}
+
+void AsyncEdgeFilter::recordMaskBegin(magma::CommandBuffer& cmdBuffer, uint32_t slot) const
+{
+    if (queryPool)
+    {
+        const VkCommandBuffer handle = cmdBuffer;
+        vkCmdResetQueryPool(handle, queryPool, slot * QueryCount + MaskBegin, 2);
+        vkCmdWriteTimestamp(handle, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, slot * QueryCount + MaskBegin);
+    }
+}
+
+void AsyncEdgeFilter::recordMaskEnd(magma::CommandBuffer& cmdBuffer, uint32_t slot) const
+{   // Render pass has left mask in shader read-only layout
+    const VkCommandBuffer handle = cmdBuffer;
+    releaseImage(handle, *slots[slot].mask, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, graphicsFamily, computeFamily);
+    if (queryPool)
+        vkCmdWriteTimestamp(handle, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, slot * QueryCount + MaskEnd);
+}
+
+void AsyncEdgeFilter::recordEdgeAcquire(magma::CommandBuffer& cmdBuffer, uint32_t slot) const
+{
+    const VkCommandBuffer handle = cmdBuffer;
+    acquireImage(handle, *slots[slot].edges, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, computeFamily, graphicsFamily);
+}
+
+void AsyncEdgeFilter::submit(std::shared_ptr<magma::CommandBuffer> maskCmdBuffer,
+    std::shared_ptr<magma::CommandBuffer> presentCmdBuffer,
+    std::shared_ptr<magma::Semaphore> presentFinished,
+    std::shared_ptr<magma::Semaphore> renderFinished,
+    std::shared_ptr<magma::Fence> fence)
+{
+    Slot& slot = slots[frameIndex % frameCount];
+    Slot& presented = slots[getPresentSlot()];
+    Batch mask;
+    if (slot.maskFreePending)
+    {   // Wait for filter of frame before previous one to read the mask. Layout transition
+        // of render pass isn't chained to color output stage, so wait before anything.
+        mask.wait(*slot.maskFree, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        slot.maskFreePending = false;
+    }
+    mask.signal(*slot.maskReady);
+    mask.submit(*graphicsQueue, *maskCmdBuffer, *slot.maskFence);
+
+    Batch filter;
+    filter.wait(*slot.maskReady, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    if (slot.edgeFreePending)
+    {   // Edges of frame before previous one have been presented
+        filter.wait(*slot.edgeFree, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        slot.edgeFreePending = false;
+    }
+    filter.signal(*slot.edgeReady);
+    filter.signal(*slot.maskFree);
+    filter.submit(*computeQueue, *slot.cmdBuffer, *slot.filterFence);
+    slot.edgeReadyPending = true;
+    slot.maskFreePending = true;
+
+    Batch present;
+    present.wait(*presentFinished, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    if (presented.edgeReadyPending)
+    {
+        present.wait(*presented.edgeReady, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        presented.edgeReadyPending = false;
+    }
+    present.signal(*renderFinished);
+    present.signal(*presented.edgeFree);
+    present.submit(*graphicsQueue, *presentCmdBuffer, *fence);
+    presented.edgeFreePending = true;
+    slot.submitted = true;
+    ++frameIndex;
+}
+
+void AsyncEdgeFilter::printStatistics()
+{   // Frames that are still in slots, in submission order
+    for (uint64_t frame = frameIndex > frameCount ? frameIndex - frameCount : 0; frame < frameIndex; ++frame)
+    {
+        const uint32_t index = static_cast<uint32_t>(frame % frameCount);
+        if (slots[index].submitted)
+            readTimestamps(slots[index], index);
+    }
+    std::cout << "Edge filter on " << (separateFamilies() ? "async compute" : "graphics") << " queue family";
+    if (!timedFrames)
+    {
+        std::cout << (queryPool ? "\n" : ", timestamps not supported\n");
+        return;
+    }
+    std::cout << ": mask rendered in " << maskTime / timedFrames << " us, edges filtered in "
+        << filterTime / timedFrames << " us per frame";
+    if (pairedFilterTime > 0.)
+        std::cout << ", " << overlapTime * 100. / pairedFilterTime << "% of filter time overlapped with next mask";
+    std::cout << "\n";
+}
+
+void AsyncEdgeFilter::writeTrace(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file.is_open() || trace.empty())
+        return;
+    const double toMicroseconds = timestampPeriod * 0.001;
+    const uint64_t origin = trace[0].timestamps[MaskBegin];
+    file << "frame,mask begin,mask end,filter begin,filter end\n";
+    for (size_t i = 0; i < trace.size(); ++i)
+    {
+        file << i;
+        for (uint64_t timestamp : trace[i].timestamps)
+            file << "," << static_cast<int64_t>(timestamp - origin) * toMicroseconds;
+        file << "\n";
+    }
+}
+
+void AsyncEdgeFilter::recordFilter(Slot& slot, uint32_t index, uint32_t width, uint32_t height)
+{
+    magma::CommandBuffer& cmdBuffer = *slot.cmdBuffer;
+    cmdBuffer.begin();
+    {
+        const VkCommandBuffer handle = cmdBuffer;
+        if (queryPool)
+        {
+            vkCmdResetQueryPool(handle, queryPool, index * QueryCount + FilterBegin, 2);
+            vkCmdWriteTimestamp(handle, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, index * QueryCount + FilterBegin);
+        }
+        acquireImage(handle, *slot.mask, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, graphicsFamily, computeFamily);
+        // Previous edges have been presented, so contents are discarded without ownership transfer
+        imageBarrier(handle, *slot.edges, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL);
+        cmdBuffer.bindPipeline(pipeline);
+        cmdBuffer.bindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, slot.descriptorSet);
+        cmdBuffer.dispatch((width + workGroupSize - 1) / workGroupSize, (height + workGroupSize - 1) / workGroupSize, 1);
+        releaseImage(handle, *slot.edges, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, computeFamily, graphicsFamily);
+        if (queryPool)
+            vkCmdWriteTimestamp(handle, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, index * QueryCount + FilterEnd);
+    }
+    cmdBuffer.end();
+}
+
+void AsyncEdgeFilter::clearEdges(std::shared_ptr<magma::CommandPool> computePool, Slot& slot)
+{   // Released the same way as filtered edges, so that acquire barrier matches
+    std::shared_ptr<magma::CommandBuffer> cmdBuffer = computePool->allocateCommandBuffer(true);
+    cmdBuffer->begin();
+    {
+        const VkCommandBuffer handle = *cmdBuffer;
+        imageBarrier(handle, *slot.edges, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL);
+        const VkClearColorValue black = {{0.f, 0.f, 0.f, 1.f}};
+        const VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdClearColorImage(handle, *slot.edges, VK_IMAGE_LAYOUT_GENERAL, &black, 1, &range);
+        releaseImage(handle, *slot.edges, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, computeFamily, graphicsFamily);
+    }
+    cmdBuffer->end();
+    std::shared_ptr<magma::Fence> fence = std::make_shared<magma::Fence>(device);
+    computeQueue->submit(cmdBuffer, 0, nullptr, slot.edgeReady, fence);
+    fence->wait();
+    slot.edgeReadyPending = true;
+}
+
+void AsyncEdgeFilter::readTimestamps(Slot& slot, uint32_t index)
+{
+    slot.submitted = false;
+    if (!queryPool)
+        return;
+    Timing timing;
+    const VkResult result = vkGetQueryPoolResults(*device, queryPool, index * QueryCount, QueryCount,
+        sizeof(timing.timestamps), timing.timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS)
+        return;
+    // Timestamps of different queues are compared as if they were in the same time domain,
+    // which holds for desktop GPUs, though Vulkan 1.0 doesn't guarantee it
+    const double toMicroseconds = timestampPeriod * 0.001;
+    const uint64_t *t = timing.timestamps;
+    maskTime += (t[MaskEnd] - t[MaskBegin]) * toMicroseconds;
+    filterTime += (t[FilterEnd] - t[FilterBegin]) * toMicroseconds;
+    ++timedFrames;
+    if (hasLastTiming)
+    {   // Filter of previous frame against mask render of this one
+        const uint64_t *last = lastTiming.timestamps;
+        const uint64_t begin = std::max(last[FilterBegin], t[MaskBegin]);
+        const uint64_t end = std::min(last[FilterEnd], t[MaskEnd]);
+        if (end > begin)
+            overlapTime += (end - begin) * toMicroseconds;
+        pairedFilterTime += (last[FilterEnd] - last[FilterBegin]) * toMicroseconds;
+    }
+    if (trace.size() < maxTraceFrames)
+        trace.push_back(timing);
+    lastTiming = timing;
+    hasLastTiming = true;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "nonCopyable.h"
+
+namespace magma
+{
+    class Device;
+    class PhysicalDevice;
+    class Queue;
+    class CommandPool;
+    class CommandBuffer;
+    class Image;
+    class Image2D;
+    class ImageView;
+    class Sampler;
+    class Semaphore;
+    class Fence;
+    class PipelineCache;
+    class PipelineLayout;
+    class ComputePipeline;
+    class DescriptorPool;
+    class DescriptorSetLayout;
+    class DescriptorSet;
+}
+
+// Runs edge filter of frame N on compute queue while graphics queue renders
+// mask of frame N+1. Each frame in flight has its own mask and edge image;
+// mask is released by graphics queue family and acquired by compute one,
+// edge image goes back the same way. Presentation lags one frame behind,
+// so that graphics queue never waits for filter of the frame it has just
+// rendered. Timestamps are written on both queues to trace the overlap.
+class AsyncEdgeFilter : public NonCopyable
+{
+public:
+    static constexpr uint32_t frameCount = 2;
+
+    // Mask images are render targets of frames in flight, their render pass
+    // has to leave them in shader read-only layout.
+    AsyncEdgeFilter(std::shared_ptr<magma::PhysicalDevice> physicalDevice,
+        std::shared_ptr<magma::PipelineCache> pipelineCache,
+        std::shared_ptr<magma::Queue> graphicsQueue,
+        std::shared_ptr<magma::Queue> computeQueue,
+        std::shared_ptr<magma::CommandPool> computePool,
+        const std::vector<std::shared_ptr<magma::Image2D>>& masks,
+        const std::vector<std::shared_ptr<magma::ImageView>>& maskViews);
+    ~AsyncEdgeFilter();
+    bool separateFamilies() const noexcept { return graphicsFamily != computeFamily; }
+    // Waits until mask of previous frame is rendered, so that host may update
+    // its inputs, and returns frame slot to render mask to
+    uint32_t beginFrame();
+    // Slot of previous frame, which edges are presented
+    uint32_t getPresentSlot() const noexcept;
+    std::shared_ptr<magma::ImageView> getEdgeView(uint32_t slot) const noexcept;
+    // Mask render has to be recorded between these, outside of render pass
+    void recordMaskBegin(magma::CommandBuffer& cmdBuffer, uint32_t slot) const;
+    void recordMaskEnd(magma::CommandBuffer& cmdBuffer, uint32_t slot) const;
+    // Has to be recorded before edge image is sampled for presentation
+    void recordEdgeAcquire(magma::CommandBuffer& cmdBuffer, uint32_t slot) const;
+    // Submits mask render and edge filter of current frame, then presentation of previous one
+    void submit(std::shared_ptr<magma::CommandBuffer> maskCmdBuffer,
+        std::shared_ptr<magma::CommandBuffer> presentCmdBuffer,
+        std::shared_ptr<magma::Semaphore> presentFinished,
+        std::shared_ptr<magma::Semaphore> renderFinished,
+        std::shared_ptr<magma::Fence> fence);
+    // Device should be idle, so that timestamps of the last frames are available
+    void printStatistics();
+    // Writes begin and end of mask render and edge filter of each frame in microseconds
+    void writeTrace(const std::string& filename) const;
+
+private:
+    enum Query : uint32_t { MaskBegin, MaskEnd, FilterBegin, FilterEnd, QueryCount };
+
+    struct Timing
+    {
+        uint64_t timestamps[QueryCount];
+    };
+
+    struct Slot
+    {
+        std::shared_ptr<magma::Image> mask;
+        std::shared_ptr<magma::Image> edges;
+        std::shared_ptr<magma::ImageView> edgeView;
+        std::shared_ptr<magma::DescriptorSet> descriptorSet;
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer;
+        std::shared_ptr<magma::Semaphore> maskReady;
+        std::shared_ptr<magma::Semaphore> maskFree;
+        std::shared_ptr<magma::Semaphore> edgeReady;
+        std::shared_ptr<magma::Semaphore> edgeFree;
+        std::shared_ptr<magma::Fence> maskFence;
+        std::shared_ptr<magma::Fence> filterFence;
+        // Every signaled semaphore is waited exactly once
+        bool maskFreePending = false;
+        bool edgeReadyPending = false;
+        bool edgeFreePending = false;
+        bool submitted = false;
+    };
+
+    void recordFilter(Slot& slot, uint32_t index, uint32_t width, uint32_t height);
+    void clearEdges(std::shared_ptr<magma::CommandPool> computePool, Slot& slot);
+    void readTimestamps(Slot& slot, uint32_t index);
+
+    static constexpr uint32_t workGroupSize = 8;
+    static constexpr size_t maxTraceFrames = 10000;
+    std::shared_ptr<magma::Device> device;
+    std::shared_ptr<magma::Queue> graphicsQueue;
+    std::shared_ptr<magma::Queue> computeQueue;
+    const uint32_t graphicsFamily;
+    const uint32_t computeFamily;
+    Slot slots[frameCount];
+    uint64_t frameIndex = 0;
+    std::shared_ptr<magma::Sampler> sampler;
+    std::shared_ptr<magma::DescriptorPool> descriptorPool;
+    std::shared_ptr<magma::DescriptorSetLayout> descriptorSetLayout;
+    std::shared_ptr<magma::PipelineLayout> pipelineLayout;
+    std::shared_ptr<magma::ComputePipeline> pipeline;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    float timestampPeriod; // Nanoseconds per tick
+    std::vector<Timing> trace;
+    Timing lastTiming;
+    bool hasLastTiming = false;
+    uint32_t timedFrames = 0;
+    double maskTime = 0.; // Microseconds
+    double filterTime = 0.;
+    double pairedFilterTime = 0.; // Of frames that are followed by another one
+    double overlapTime = 0.;
+};
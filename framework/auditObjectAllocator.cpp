@@ -0,0 +1,23 @@
+#include "auditObjectAllocator.h"
+#include "allocationAudit.h"
+
+AuditObjectAllocator::AuditObjectAllocator(std::shared_ptr<magma::IObjectAllocator> allocator) noexcept:
+    allocator(std::move(allocator))
+{}
+
+void *AuditObjectAllocator::alloc(size_t size)
+{
+    AllocationZone zone("magma objects");
+    AllocationAudit::onAllocation(size);
+    return allocator->alloc(size);
+}
+
+void AuditObjectAllocator::free(void *p) noexcept
+{
+    allocator->free(p);
+}
+
+size_t AuditObjectAllocator::getBytesAllocated() const noexcept
+{
+    return allocator->getBytesAllocated();
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <memory>
+#include "../magma/allocator/objectAllocator.h"
+
+// Reports allocations of magma objects to AllocationAudit and forwards them
+// to wrapped allocator. Object allocator doesn't go through operator new,
+// so this is the only way to see magma objects created inside of a frame.
+class AuditObjectAllocator : public magma::IObjectAllocator
+{
+public:
+    explicit AuditObjectAllocator(std::shared_ptr<magma::IObjectAllocator> allocator) noexcept;
+    virtual void *alloc(size_t size) override;
+    virtual void free(void *p) noexcept override;
+    virtual size_t getBytesAllocated() const noexcept override;
+
+private:
+    std::shared_ptr<magma::IObjectAllocator> allocator;
+};
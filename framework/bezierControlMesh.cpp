@@ -0,0 +1,129 @@
+#include <cassert>
+#include "bezierControlMesh.h"
+#include "bezierMesh.h"
+#include "meshOptimizer.h"
+#include "gpuPatchCulling.h"
+#include "../magma/magma.h"
+#include "../rapid/rapid.h"
+
+BezierControlMesh::BezierControlMesh(
+    const uint32_t patches[][16],
+    const uint32_t numPatches,
+    const float patchVertices[][3],
+    const uint32_t subdivisionDegree,
+    std::shared_ptr<magma::CommandBuffer> cmdBuffer):
+    numPatches(numPatches)
+{
+    std::shared_ptr<magma::SrcTransferBuffer> srcBuffer(std::make_shared<magma::SrcTransferBuffer>(
+        cmdBuffer->getDevice(), numPatches * 16 * sizeof(rapid::float4)));
+    magma::helpers::mapScoped<rapid::float4>(srcBuffer, [&](rapid::float4 *cp)
+    {
+        for (uint32_t np = 0; np < numPatches; ++np)
+        {
+            rapid::float3 hull[16];
+            for (uint32_t i = 0; i < 16; ++i, ++cp)
+            {   // Swap Y and Z component to match coordinate system.
+                // Evaluation is linear in control points, so swap can be done before it.
+                const float *P = patchVertices[patches[np][i] - 1];
+                cp->x = P[0];
+                cp->y = P[2];
+                cp->z = P[1];
+                cp->w = 1.f;
+                hull[i] = {P[0], P[2], P[1]};
+            }
+            // No triangles, so normal cone is disabled
+            bounds.addPatch(hull, 16, nullptr, 0);
+        }
+    });
+    controlPoints = std::make_shared<magma::StorageBuffer>(cmdBuffer, srcBuffer);
+    std::shared_ptr<magma::SrcTransferBuffer> srcIndices(std::make_shared<magma::SrcTransferBuffer>(
+        cmdBuffer->getDevice(), numPatches * sizeof(uint32_t)));
+    magma::helpers::mapScoped<uint32_t>(srcIndices, [numPatches](uint32_t *indices)
+    {
+        for (uint32_t np = 0; np < numPatches; ++np)
+            indices[np] = np;
+    });
+    patchIndices = std::make_shared<magma::StorageBuffer>(cmdBuffer, srcIndices);
+    subdivide(subdivisionDegree, cmdBuffer);
+}
+
+void BezierControlMesh::subdivide(const uint32_t subdivisionDegree,
+    std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+{
+    assert(subdivisionDegree >= 2);
+    assert(subdivisionDegree <= 32);
+    divs = subdivisionDegree;
+    const uint32_t vertexCount = (divs + 1) * (divs + 1);
+    std::shared_ptr<magma::SrcTransferBuffer> srcGrid(std::make_shared<magma::SrcTransferBuffer>(
+        cmdBuffer->getDevice(), vertexCount * sizeof(rapid::float2)));
+    magma::helpers::mapScoped<rapid::float2>(srcGrid, [this](rapid::float2 *st)
+    {
+        for (uint32_t j = 0, k = 0; j <= divs; ++j)
+        {
+            for (uint32_t i = 0; i <= divs; ++i, ++k)
+            {
+                st[k].x = i / (float)divs;
+                st[k].y = j / (float)divs;
+            }
+        }
+    });
+    gridBuffer = std::make_shared<magma::VertexBuffer>(cmdBuffer, srcGrid);
+    // Grid has at most 33x33 vertices, so 16-bit indices are enough
+    const uint32_t numFaces = divs * divs;
+    std::vector<uint32_t> indices(numFaces * 2 * 3);
+    triangulatePatchGrid(divs, 0, indices.data());
+    optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    std::shared_ptr<magma::SrcTransferBuffer> srcIndices(std::make_shared<magma::SrcTransferBuffer>(
+        cmdBuffer->getDevice(), indices.size() * sizeof(uint16_t)));
+    magma::helpers::mapScoped<uint16_t>(srcIndices, [&indices](uint16_t *faces)
+    {
+        for (uint32_t index : indices)
+            *faces++ = static_cast<uint16_t>(index);
+    });
+    indexBuffer = std::make_shared<magma::IndexBuffer>(cmdBuffer, srcIndices, VK_INDEX_TYPE_UINT16);
+    if (culler)
+        culler->setIndexCount(indexBuffer->getIndexCount());
+}
+
+void BezierControlMesh::draw(magma::CommandBuffer& cmdBuffer) const
+{
+    cmdBuffer.bindVertexBuffer(0, gridBuffer);
+    cmdBuffer.bindIndexBuffer(indexBuffer);
+    // gl_InstanceIndex selects patch
+    if (culler)
+        cmdBuffer.drawIndexedIndirect(culler->getIndirectBuffer(), 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+    else
+        cmdBuffer.drawIndexedInstanced(indexBuffer->getIndexCount(), numPatches, 0, 0, 0);
+}
+
+std::shared_ptr<magma::Buffer> BezierControlMesh::getPatchIndices() const noexcept
+{
+    if (culler)
+        return culler->getVisiblePatches();
+    return patchIndices;
+}
+
+uint32_t BezierControlMesh::getIndexCount() const noexcept
+{
+    return indexBuffer->getIndexCount();
+}
+
+const magma::VertexInputState& BezierControlMesh::getVertexInput() const
+{
+    static const magma::VertexInputState vertexInput(
+    {
+        magma::VertexInputBinding(0, sizeof(rapid::float2)) // Patch (u,v)
+    },
+    {
+        magma::VertexInputAttribute(0, 0, VK_FORMAT_R32G32_SFLOAT, 0)
+    });
+    return vertexInput;
+}
+
+uint64_t BezierControlMesh::getMemorySize() const noexcept
+{
+    const uint64_t vertexCount = (divs + 1) * (divs + 1);
+    return numPatches * (16 * sizeof(rapid::float4) + sizeof(uint32_t)) +
+        vertexCount * sizeof(rapid::float2) +
+        divs * divs * 2 * 3 * sizeof(uint16_t);
+}
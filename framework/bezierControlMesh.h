@@ -0,0 +1,56 @@
+#pragma once
+#include "mesh.h"
+#include "patchCulling.h"
+
+namespace magma
+{
+    class Buffer;
+    class StorageBuffer;
+}
+
+class GpuPatchCuller;
+
+// Keeps only 16 control points per patch on the GPU and a single (u,v) grid
+// shared by all patches. Position and normal are evaluated in vertex shader,
+// patch is selected by instance index, so the whole mesh is one draw call.
+// Instance is mapped to patch through index list, which is either identity
+// or written by GPU culling pass.
+// Instances are used for patches, so instance count of the mesh is ignored.
+class BezierControlMesh : public Mesh
+{
+public:
+    BezierControlMesh(const uint32_t patches[][16],
+        const uint32_t numPatches,
+        const float patchVertices[][3],
+        const uint32_t subdivisionDegree,
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer);
+    // Only grid depends on subdivision degree, control points are kept as is.
+    // Culler stores index count in draw command, so it is updated as well;
+    // command buffers have to be re-recorded.
+    void subdivide(const uint32_t subdivisionDegree,
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer);
+    using Mesh::draw;
+    virtual void draw(magma::CommandBuffer& cmdBuffer) const override;
+    virtual const magma::VertexInputState& getVertexInput() const override;
+    // Draw is done indirectly with instance count written by culler
+    void setCuller(std::shared_ptr<GpuPatchCuller> culler) noexcept { this->culler = std::move(culler); }
+    std::shared_ptr<magma::StorageBuffer> getControlPoints() const noexcept { return controlPoints; }
+    std::shared_ptr<magma::Buffer> getPatchIndices() const noexcept;
+    // Bounds are conservative because patch lies within convex hull of its control points
+    const PatchBounds& getBounds() const noexcept { return bounds; }
+    uint32_t getIndexCount() const noexcept;
+    uint32_t getPatchCount() const noexcept { return numPatches; }
+    uint32_t getSubdivisionDegree() const noexcept { return divs; }
+    // Device memory taken by control points, grid and indices
+    uint64_t getMemorySize() const noexcept;
+
+private:
+    const uint32_t numPatches;
+    uint32_t divs = 0;
+    std::shared_ptr<magma::StorageBuffer> controlPoints;
+    std::shared_ptr<magma::StorageBuffer> patchIndices;
+    std::shared_ptr<GpuPatchCuller> culler;
+    PatchBounds bounds;
+    std::shared_ptr<magma::VertexBuffer> gridBuffer;
+    std::shared_ptr<magma::IndexBuffer> indexBuffer;
+};
@@ -1,5 +1,7 @@
+#include <cstring>
+#include <algorithm>
 #include "bezierMesh.h"
-#include "bezier.inl"
+#include "meshOptimizer.h"
 #include "../magma/magma.h"
 
 BezierPatchMesh::BezierPatchMesh(
@@ -13,92 +15,74 @@ BezierPatchMesh::BezierPatchMesh(
     assert(subdivisionDegree <= 32);
     const uint32_t divs = subdivisionDegree;
     const uint32_t vertexCount = (divs + 1) * (divs + 1);
-    std::shared_ptr<magma::SrcTransferBuffer> vertices(std::make_shared<magma::SrcTransferBuffer>(
-        cmdBuffer->getDevice(), vertexCount * sizeof(rapid::float3)));
-    std::shared_ptr<magma::SrcTransferBuffer> normals(std::make_shared<magma::SrcTransferBuffer>(
-        cmdBuffer->getDevice(), vertexCount * sizeof(rapid::float3)));
-    std::shared_ptr<magma::SrcTransferBuffer> texCoords(std::make_shared<magma::SrcTransferBuffer>(
-        cmdBuffer->getDevice(), vertexCount * sizeof(rapid::float2)));
-    rapid::vector3 controlPoints[16];
-    for (uint32_t np = 0; np < numPatches; ++np)
-    {   // Set patch control points
-        for (uint32_t i = 0; i < 16; ++i)
-        {
-            controlPoints[i] = rapid::vector3(patchVertices[patches[np][i] - 1][0],
-                                              patchVertices[patches[np][i] - 1][1],
-                                              patchVertices[patches[np][i] - 1][2]);
-        }
-        rapid::float3 *P = static_cast<rapid::float3 *>(vertices->getMemory()->map());
-        rapid::float3 *N = static_cast<rapid::float3 *>(normals->getMemory()->map());
-        rapid::float2 *st = static_cast<rapid::float2 *>(texCoords->getMemory()->map());
-        // Generate grid
-        for (uint16_t j = 0, k = 0; j <= divs; ++j)
-        {
-            float v = j / (float)divs;
-            for (uint16_t i = 0; i <= divs; ++i, ++k)
-            {
-                float u = i / (float)divs;
-                evalBezierPatch(controlPoints, u, v).store(&P[k]);
-                rapid::vector3 dU = dUBezier(controlPoints, u, v);
-                rapid::vector3 dV = dVBezier(controlPoints, u, v);
-                rapid::vector3 normal = (dU^dV).normalized();
-                normal.store(&N[k]);
-                st[k].x = u;
-                st[k].y = v;
-            }
-        }
-        for (uint32_t i = 0; i < vertexCount; ++i)
-        {   // Swap Y and Z component to match coordinate system
-            std::swap(P[i].y, P[i].z);
-            std::swap(N[i].y, N[i].z);
-        }
-        texCoords->getMemory()->unmap();
-        normals->getMemory()->unmap();
-        vertices->getMemory()->unmap();
-        // Triangulate and load to buffers
-        std::shared_ptr<Patch> patch(std::make_shared<Patch>(cmdBuffer, vertices, normals, texCoords));
-        this->patches.push_back(patch);
-    }
+    const StagingBuffers staging(cmdBuffer->getDevice(), vertexCount);
     const uint32_t numFaces = divs * divs;
-    std::vector<uint32_t> indices(numFaces * 4);
     // All patches are subdivided in the same way, so here we share the same topology
-    for (uint16_t j = 0, k = 0; j < divs; ++j)
+    std::vector<uint32_t> indices(numFaces * 2 * 3);
+    triangulatePatchGrid(divs, 0, indices.data());
+    std::vector<rapid::float3> P(vertexCount), N(vertexCount);
+    std::vector<rapid::float2> st(vertexCount);
+    for (uint32_t np = 0; np < numPatches; ++np)
     {
-        for (uint16_t i = 0; i < divs; ++i, ++k)
-        {
-            indices[k * 4] = (divs + 1) * j + i;
-            indices[k * 4 + 1] = (divs + 1) * j + i + 1;
-            indices[k * 4 + 2] = (divs + 1) * (j + 1) + i + 1;
-            indices[k * 4 + 3] = (divs + 1) * (j + 1) + i;
-        }
+        evalPatchGrid(patches[np], patchVertices, divs, P.data(), N.data(), st.data());
+        bounds.addPatch(P.data(), vertexCount, indices.data(), static_cast<uint32_t>(indices.size()));
+        addPatch(P.data(), N.data(), st.data(), staging, cmdBuffer);
     }
-    std::shared_ptr<magma::SrcTransferBuffer> srcBuffer(std::make_shared<magma::SrcTransferBuffer>(
-        cmdBuffer->getDevice(), numFaces * 2 * 3 * sizeof(uint32_t)));
-    magma::helpers::mapScoped<uint32_t>(srcBuffer, [numFaces, indices](uint32_t *faces)
-    {
-        for (uint32_t i = 0, k = 0, n = 0; i < numFaces; ++i, k += 4) // For each face
-        {
-            for (uint32_t j = 0; j < 2; ++j) // For each triangle in the face
-            {
-                faces[n    ] = indices[k];
-                faces[n + 1] = indices[k + j + 1];
-                faces[n + 2] = indices[k + j + 2];
-                n += 3;
-            }
-        }
-    });
-    indexBuffer = std::make_shared<magma::IndexBuffer>(cmdBuffer, srcBuffer, VK_INDEX_TYPE_UINT32);
+    optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    // Grid has at most 33x33 vertices, so 16-bit indices are enough
+    const std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+    createIndexBuffer(shortIndices.data(), static_cast<uint32_t>(shortIndices.size()), cmdBuffer);
 }
 
-void BezierPatchMesh::draw(std::shared_ptr<magma::CommandBuffer> cmdBuffer) const
+BezierPatchMesh::BezierPatchMesh(const PatchMeshData& data,
+    std::shared_ptr<magma::CommandBuffer> cmdBuffer)
 {
-    cmdBuffer->bindIndexBuffer(indexBuffer);
-    for (const auto& patch : patches)
-    {
-        cmdBuffer->bindVertexBuffer(0, patch->vertexBuffer);
-        cmdBuffer->bindVertexBuffer(1, patch->normalBuffer);
-        cmdBuffer->bindVertexBuffer(2, patch->texCoordBuffer);
-        cmdBuffer->drawIndexed(indexBuffer->getIndexCount(), 0, 0);
+    static_assert(sizeof(rapid::float3) == sizeof(float) * 3, "unexpected float3 size");
+    static_assert(sizeof(rapid::float2) == sizeof(float) * 2, "unexpected float2 size");
+    const uint32_t divs = data.subdivisionDegree;
+    const uint32_t vertexCount = (divs + 1) * (divs + 1);
+    const StagingBuffers staging(cmdBuffer->getDevice(), vertexCount);
+    for (uint32_t np = 0; np < data.numPatches; ++np)
+    {   // Copy straight from read-only data, nothing to evaluate
+        const uint32_t first = np * vertexCount;
+        bounds.addPatch(data.bounds[np]);
+        addPatch(reinterpret_cast<const rapid::float3 *>(data.positions + first),
+            reinterpret_cast<const rapid::float3 *>(data.normals + first),
+            reinterpret_cast<const rapid::float2 *>(data.texCoords + first),
+            staging, cmdBuffer);
+    }
+    // Already ordered for vertex cache
+    createIndexBuffer(data.indices, divs * divs * 2 * 3, cmdBuffer);
+}
+
+bool BezierPatchMesh::cull(const PatchCuller& culler, CullStats *stats /* nullptr */)
+{
+    const uint32_t count = culler.cull(bounds, culledPatches.data(), stats);
+    if (count == visiblePatches.size() &&
+        std::equal(visiblePatches.begin(), visiblePatches.end(), culledPatches.begin()))
+        return false;
+    visiblePatches.assign(culledPatches.begin(), culledPatches.begin() + count);
+    return true;
+}
+
+void BezierPatchMesh::draw(magma::CommandBuffer& cmdBuffer) const
+{
+    draw(cmdBuffer, 0, getDrawCount());
+}
+
+void BezierPatchMesh::draw(magma::CommandBuffer& cmdBuffer, uint32_t firstDraw, uint32_t drawCount) const
+{
+    const uint32_t lastDraw = std::min(firstDraw + drawCount, getDrawCount());
+    if (firstDraw >= lastDraw)
+        return;
+    cmdBuffer.bindIndexBuffer(indexBuffer);
+    const VkCommandBuffer handle = cmdBuffer;
+    const VkDeviceSize offsets[3] = {0, 0, 0};
+    const uint32_t indexCount = indexBuffer->getIndexCount();
+    for (uint32_t i = firstDraw; i < lastDraw; ++i)
+    {   // One call binds all three streams
+        vkCmdBindVertexBuffers(handle, 0, 3, patches[visiblePatches[i]].handles, offsets);
+        vkCmdDrawIndexed(handle, indexCount, instanceCount, 0, 0, 0);
     }
 }
 
@@ -118,6 +102,58 @@ const magma::VertexInputState& BezierPatchMesh::getVertexInput() const
     return vertexInput;
 }
 
+uint64_t BezierPatchMesh::getMemorySize(const uint32_t numPatches,
+    const uint32_t subdivisionDegree) noexcept
+{
+    const uint32_t divs = subdivisionDegree;
+    const uint64_t vertexCount = (divs + 1) * (divs + 1);
+    const uint64_t vertexSize = sizeof(rapid::float3) * 2 + sizeof(rapid::float2);
+    return numPatches * vertexCount * vertexSize +
+        divs * divs * 2 * 3 * sizeof(uint16_t);
+}
+
+void BezierPatchMesh::addPatch(const rapid::float3 *positions,
+    const rapid::float3 *normals,
+    const rapid::float2 *texCoords,
+    const StagingBuffers& staging,
+    std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+{
+    const uint32_t vertexCount = staging.vertexCount;
+    memcpy(staging.vertices->getMemory()->map(), positions, vertexCount * sizeof(rapid::float3));
+    memcpy(staging.normals->getMemory()->map(), normals, vertexCount * sizeof(rapid::float3));
+    memcpy(staging.texCoords->getMemory()->map(), texCoords, vertexCount * sizeof(rapid::float2));
+    staging.texCoords->getMemory()->unmap();
+    staging.normals->getMemory()->unmap();
+    staging.vertices->getMemory()->unmap();
+    // Triangulate and load to buffers
+    patches.emplace_back(cmdBuffer, staging.vertices, staging.normals, staging.texCoords);
+}
+
+void BezierPatchMesh::createIndexBuffer(const uint16_t *indices,
+    const uint32_t indexCount,
+    std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+{
+    std::shared_ptr<magma::SrcTransferBuffer> srcBuffer(std::make_shared<magma::SrcTransferBuffer>(
+        cmdBuffer->getDevice(), indexCount * sizeof(uint16_t)));
+    magma::helpers::mapScoped<uint16_t>(srcBuffer, [indices, indexCount](uint16_t *faces)
+    {
+        memcpy(faces, indices, indexCount * sizeof(uint16_t));
+    });
+    indexBuffer = std::make_shared<magma::IndexBuffer>(cmdBuffer, srcBuffer, VK_INDEX_TYPE_UINT16);
+    const uint32_t numPatches = static_cast<uint32_t>(patches.size());
+    visiblePatches.resize(numPatches);
+    for (uint32_t np = 0; np < numPatches; ++np)
+        visiblePatches[np] = np;
+    culledPatches.resize(numPatches);
+}
+
+BezierPatchMesh::StagingBuffers::StagingBuffers(std::shared_ptr<magma::Device> device, uint32_t vertexCount):
+    vertices(std::make_shared<magma::SrcTransferBuffer>(device, vertexCount * sizeof(rapid::float3))),
+    normals(std::make_shared<magma::SrcTransferBuffer>(device, vertexCount * sizeof(rapid::float3))),
+    texCoords(std::make_shared<magma::SrcTransferBuffer>(device, vertexCount * sizeof(rapid::float2))),
+    vertexCount(vertexCount)
+{}
+
 BezierPatchMesh::Patch::Patch(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
     std::shared_ptr<magma::SrcTransferBuffer> vertices,
     std::shared_ptr<magma::SrcTransferBuffer> normals,
@@ -126,4 +162,7 @@ BezierPatchMesh::Patch::Patch(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
     vertexBuffer = std::make_shared<magma::VertexBuffer>(cmdBuffer, vertices);
     normalBuffer = std::make_shared<magma::VertexBuffer>(cmdBuffer, normals);
     texCoordBuffer = std::make_shared<magma::VertexBuffer>(cmdBuffer, texCoords);
+    handles[0] = *vertexBuffer;
+    handles[1] = *normalBuffer;
+    handles[2] = *texCoordBuffer;
 }
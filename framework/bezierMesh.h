@@ -1,7 +1,10 @@
 #pragma once
 #include <vector>
+#include <vulkan/vulkan.h>
 #include "mesh.h"
-#include "../rapid/rapid.h"
+#include "bezierTessellation.h"
+#include "staticBezierMesh.h"
+#include "patchCulling.h"
 
 // https://www.scratchapixel.com/lessons/advanced-rendering/bezier-curve-rendering-utah-teapot
 class BezierPatchMesh : public Mesh
@@ -12,10 +15,35 @@ public:
         const float patchVertices[][3],
         const uint32_t subdivisionDegree,
         std::shared_ptr<magma::CommandBuffer> cmdBuffer);
-    virtual void draw(std::shared_ptr<magma::CommandBuffer> cmdBuffer) const override;
+    // Vertices, index order and culling bounds are baked at compile time,
+    // see tessellateStaticPatches()
+    BezierPatchMesh(const PatchMeshData& data,
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer);
+    // Updates list of patches to draw, returns true if it has changed
+    bool cull(const PatchCuller& culler, CullStats *stats = nullptr);
+    const PatchBounds& getBounds() const noexcept { return bounds; }
+    using Mesh::draw;
+    // Binds vertex buffers of each patch by raw handles, as this is per-patch work
+    virtual void draw(magma::CommandBuffer& cmdBuffer) const override;
+    virtual void draw(magma::CommandBuffer& cmdBuffer, uint32_t firstDraw, uint32_t drawCount) const override;
+    virtual uint32_t getDrawCount() const noexcept override
+        { return static_cast<uint32_t>(visiblePatches.size()); }
     virtual const magma::VertexInputState& getVertexInput() const override;
+    // Device memory taken by baked vertices and indices
+    static uint64_t getMemorySize(const uint32_t numPatches,
+        const uint32_t subdivisionDegree) noexcept;
 
 private:
+    struct StagingBuffers
+    {
+        StagingBuffers(std::shared_ptr<magma::Device> device, uint32_t vertexCount);
+
+        std::shared_ptr<magma::SrcTransferBuffer> vertices;
+        std::shared_ptr<magma::SrcTransferBuffer> normals;
+        std::shared_ptr<magma::SrcTransferBuffer> texCoords;
+        const uint32_t vertexCount;
+    };
+
     struct Patch
     {
         Patch(std::shared_ptr<magma::CommandBuffer> cmdBuffer,
@@ -26,8 +54,21 @@ private:
         std::shared_ptr<magma::VertexBuffer> vertexBuffer;
         std::shared_ptr<magma::VertexBuffer> normalBuffer;
         std::shared_ptr<magma::VertexBuffer> texCoordBuffer;
+        VkBuffer handles[3]; // Owned by buffers above
     };
 
-    std::vector<std::shared_ptr<Patch>> patches;
+    void addPatch(const rapid::float3 *positions,
+        const rapid::float3 *normals,
+        const rapid::float2 *texCoords,
+        const StagingBuffers& staging,
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer);
+    void createIndexBuffer(const uint16_t *indices,
+        const uint32_t indexCount,
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer);
+
+    std::vector<Patch> patches;
     std::shared_ptr<magma::IndexBuffer> indexBuffer;
+    PatchBounds bounds;
+    std::vector<uint32_t> visiblePatches;
+    std::vector<uint32_t> culledPatches;
 };
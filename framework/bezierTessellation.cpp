@@ -0,0 +1,85 @@
+#include <cassert>
+#include <utility>
+#include "bezierTessellation.h"
+#include "bezier.inl"
+
+void evalPatchGrid(const uint32_t patch[16], const float patchVertices[][3], const uint32_t divs,
+    rapid::float3 *P, rapid::float3 *N, rapid::float2 *st)
+{
+    rapid::vector3 controlPoints[16];
+    for (uint32_t i = 0; i < 16; ++i)
+    {   // Set patch control points
+        controlPoints[i] = rapid::vector3(patchVertices[patch[i] - 1][0],
+                                          patchVertices[patch[i] - 1][1],
+                                          patchVertices[patch[i] - 1][2]);
+    }
+    // Generate grid
+    for (uint16_t j = 0, k = 0; j <= divs; ++j)
+    {
+        float v = j / (float)divs;
+        for (uint16_t i = 0; i <= divs; ++i, ++k)
+        {
+            float u = i / (float)divs;
+            evalBezierPatch(controlPoints, u, v).store(&P[k]);
+            rapid::vector3 dU = dUBezier(controlPoints, u, v);
+            rapid::vector3 dV = dVBezier(controlPoints, u, v);
+            rapid::vector3 normal = (dU^dV).normalized();
+            normal.store(&N[k]);
+            st[k].x = u;
+            st[k].y = v;
+        }
+    }
+    const uint32_t vertexCount = (divs + 1) * (divs + 1);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {   // Swap Y and Z component to match coordinate system
+        std::swap(P[i].y, P[i].z);
+        std::swap(N[i].y, N[i].z);
+    }
+}
+
+void triangulatePatchGrid(const uint32_t subdivisionDegree, const uint32_t baseVertex, uint32_t *faces)
+{
+    const uint32_t divs = subdivisionDegree;
+    for (uint32_t j = 0; j < divs; ++j)
+    {
+        for (uint32_t i = 0; i < divs; ++i)
+        {
+            const uint32_t quad[4] = {
+                baseVertex + (divs + 1) * j + i,
+                baseVertex + (divs + 1) * j + i + 1,
+                baseVertex + (divs + 1) * (j + 1) + i + 1,
+                baseVertex + (divs + 1) * (j + 1) + i};
+            for (uint32_t t = 0; t < 2; ++t) // For each triangle in the face
+            {
+                *faces++ = quad[0];
+                *faces++ = quad[t + 1];
+                *faces++ = quad[t + 2];
+            }
+        }
+    }
+}
+
+IndexedMesh tessellateBezierPatches(const uint32_t patches[][16],
+    const uint32_t numPatches,
+    const float patchVertices[][3],
+    const uint32_t subdivisionDegree)
+{
+    assert(subdivisionDegree >= 2);
+    assert(subdivisionDegree <= 32);
+    const uint32_t divs = subdivisionDegree;
+    const uint32_t vertexCount = (divs + 1) * (divs + 1);
+    const uint32_t indexCount = divs * divs * 2 * 3;
+    IndexedMesh mesh;
+    mesh.positions.resize(numPatches * vertexCount);
+    mesh.normals.resize(numPatches * vertexCount);
+    mesh.texCoords.resize(numPatches * vertexCount);
+    mesh.indices.resize(numPatches * indexCount);
+    for (uint32_t np = 0; np < numPatches; ++np)
+    {
+        const uint32_t baseVertex = np * vertexCount;
+        evalPatchGrid(patches[np], patchVertices, divs,
+            &mesh.positions[baseVertex], &mesh.normals[baseVertex], &mesh.texCoords[baseVertex]);
+        triangulatePatchGrid(divs, baseVertex, &mesh.indices[np * indexCount]);
+    }
+    return mesh;
+}
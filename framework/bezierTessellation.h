@@ -0,0 +1,16 @@
+#pragma once
+#include "indexedMesh.h"
+
+// CPU tessellation of bicubic Bezier patches, has no dependency on Vulkan.
+// Patch indices are one-based, Y and Z are swapped to match coordinate system.
+
+// Evaluates (divs+1)^2 grid of positions, normals and parametric coordinates of single patch
+void evalPatchGrid(const uint32_t patch[16], const float patchVertices[][3], const uint32_t divs,
+    rapid::float3 *P, rapid::float3 *N, rapid::float2 *st);
+// Evaluates all patches into single mesh, every patch has its own (divs+1)^2 vertices
+IndexedMesh tessellateBezierPatches(const uint32_t patches[][16],
+    const uint32_t numPatches,
+    const float patchVertices[][3],
+    const uint32_t subdivisionDegree);
+// Splits (divs+1)^2 grid of patch vertices into triangle pairs, writes divs^2*6 indices
+void triangulatePatchGrid(const uint32_t subdivisionDegree, const uint32_t baseVertex, uint32_t *faces);
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <condition_variable>
+#include "nonCopyable.h"
+
+// Blocking FIFO of limited capacity. Producer waits when queue is full,
+// which propagates backpressure to the upstream stage of pipeline.
+template<typename T>
+class BoundedQueue : public NonCopyable
+{
+public:
+    struct Stats
+    {
+        uint64_t pushCount = 0;
+        uint64_t occupancySum = 0;
+        size_t maxOccupancy = 0;
+        uint64_t pushWaitMicroseconds = 0;
+        uint64_t popWaitMicroseconds = 0;
+
+        float averageOccupancy() const
+            { return pushCount ? occupancySum / static_cast<float>(pushCount) : 0.f; }
+    };
+
+    explicit BoundedQueue(size_t capacity):
+        capacity(std::max(capacity, size_t(1))) {}
+
+    bool push(T&& item)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (items.size() >= capacity && !closed)
+        {
+            const auto begin = std::chrono::high_resolution_clock::now();
+            notFull.wait(lock, [this] { return items.size() < capacity || closed; });
+            stats.pushWaitMicroseconds += elapsedMicroseconds(begin);
+        }
+        if (closed)
+            return false;
+        items.push_back(std::move(item));
+        ++stats.pushCount;
+        stats.occupancySum += items.size();
+        stats.maxOccupancy = std::max(stats.maxOccupancy, items.size());
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Returns false when queue is closed and drained
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (items.empty() && !closed)
+        {
+            const auto begin = std::chrono::high_resolution_clock::now();
+            notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+            stats.popWaitMicroseconds += elapsedMicroseconds(begin);
+        }
+        if (items.empty())
+            return false;
+        item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            closed = true;
+        }
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return items.size();
+    }
+
+    size_t getCapacity() const noexcept { return capacity; }
+
+    Stats getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return stats;
+    }
+
+private:
+    static uint64_t elapsedMicroseconds(std::chrono::high_resolution_clock::time_point begin)
+    {
+        const auto now = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(now - begin).count();
+    }
+
+    const size_t capacity;
+    std::deque<T> items;
+    mutable std::mutex mtx;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    Stats stats;
+    bool closed = false;
+};
@@ -0,0 +1,40 @@
+#include <cmath>
+#include <cassert>
+#include "cameraPath.h"
+
+static float catmullRom(float p0, float p1, float p2, float p3, float t) noexcept
+{
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    return 0.5f * (2.f * p1 + (p2 - p0) * t +
+        (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t2 +
+        (3.f * p1 - p0 - 3.f * p2 + p3) * t3);
+}
+
+CameraPath::CameraPath(const std::vector<Key>& keys, float periodSeconds):
+    keys(keys),
+    period(periodSeconds)
+{
+    assert(!keys.empty());
+    assert(periodSeconds > 0.f);
+}
+
+void CameraPath::evaluate(float seconds, float eye[3], float center[3]) const noexcept
+{
+    const size_t count = keys.size();
+    float phase = std::fmod(seconds / period, 1.f);
+    if (phase < 0.f)
+        phase += 1.f;
+    const float position = phase * count;
+    const size_t i = static_cast<size_t>(position) % count;
+    const float t = position - std::floor(position);
+    const Key& k0 = keys[(i + count - 1) % count];
+    const Key& k1 = keys[i];
+    const Key& k2 = keys[(i + 1) % count];
+    const Key& k3 = keys[(i + 2) % count];
+    for (int c = 0; c < 3; ++c)
+    {
+        eye[c] = catmullRom(k0.eye[c], k1.eye[c], k2.eye[c], k3.eye[c], t);
+        center[c] = catmullRom(k0.center[c], k1.center[c], k2.center[c], k3.center[c], t);
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+
+// Closed Catmull-Rom spline through camera keys. Camera is evaluated by time
+// rather than by frame, so scripted fly-through doesn't depend on frame rate.
+class CameraPath
+{
+public:
+    struct Key
+    {
+        float eye[3];
+        float center[3];
+    };
+
+    // Keys are evenly spaced in time, path returns to the first key after period
+    CameraPath(const std::vector<Key>& keys, float periodSeconds);
+    void evaluate(float seconds, float eye[3], float center[3]) const noexcept;
+
+private:
+    std::vector<Key> keys;
+    float period;
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <sstream>
+#include "application.h"
+
+// Simple parser of "--name value" and "--name" options
+class CommandLine
+{
+public:
+    explicit CommandLine(const AppEntry& entry)
+    {
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+        std::istringstream stream(entry.lpCmdLine ? entry.lpCmdLine : "");
+        std::string arg;
+        while (stream >> arg)
+            args.push_back(arg);
+#else
+        for (int i = 1; i < entry.argc; ++i)
+            args.push_back(entry.argv[i]);
+#endif
+    }
+
+    bool hasOption(const char *name) const
+    {
+        return find(name) != args.end();
+    }
+
+    std::string getValue(const char *name, const std::string& defaultValue) const
+    {
+        auto it = find(name);
+        if (it == args.end() || ++it == args.end())
+            return defaultValue;
+        return *it;
+    }
+
+    uint32_t getValue(const char *name, uint32_t defaultValue) const
+    {
+        const std::string value = getValue(name, std::string());
+        return value.empty() ? defaultValue : static_cast<uint32_t>(std::stoul(value));
+    }
+
+private:
+    std::vector<std::string>::const_iterator find(const char *name) const
+    {
+        for (auto it = args.begin(); it != args.end(); ++it)
+        {
+            if (*it == name)
+                return it;
+        }
+        return args.end();
+    }
+
+    std::vector<std::string> args;
+};
@@ -0,0 +1,99 @@
+#include <cstdlib>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+#include "cpuTopology.h"
+
+#ifndef _WIN32
+static std::string readLine(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+#endif
+
+std::vector<uint32_t> parseCpuList(const std::string& list)
+{
+    std::vector<uint32_t> cpus;
+    std::istringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        char *end = nullptr;
+        const unsigned long first = strtoul(range.c_str(), &end, 10);
+        if (end == range.c_str())
+            continue;
+        const unsigned long last = ('-' == *end) ? strtoul(end + 1, nullptr, 10) : first;
+        for (unsigned long cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(static_cast<uint32_t>(cpu));
+    }
+    return cpus;
+}
+
+CpuTopology CpuTopology::probe()
+{
+    CpuTopology topology;
+#ifdef _WIN32
+    ULONG highestNode = 0;
+    if (GetNumaHighestNodeNumber(&highestNode))
+    {
+        for (UCHAR node = 0; node <= highestNode; ++node)
+        {
+            ULONGLONG mask = 0;
+            if (!GetNumaNodeProcessorMask(node, &mask) || !mask)
+                continue;
+            Node entry;
+            entry.index = node;
+            for (uint32_t cpu = 0; cpu < 64; ++cpu)
+            {
+                if (mask & (1ULL << cpu))
+                    entry.cpus.push_back(cpu);
+            }
+            topology.nodes.push_back(std::move(entry));
+        }
+    }
+#else
+    cpu_set_t affinity;
+    CPU_ZERO(&affinity);
+    const bool hasAffinity = (0 == sched_getaffinity(0, sizeof(affinity), &affinity));
+    for (uint32_t node : parseCpuList(readLine("/sys/devices/system/node/online")))
+    {
+        Node entry;
+        entry.index = node;
+        for (uint32_t cpu : parseCpuList(readLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist")))
+        {   // Container may be restricted to some of them
+            if (!hasAffinity || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &affinity)))
+                entry.cpus.push_back(cpu);
+        }
+        if (!entry.cpus.empty()) // Memory-only node
+            topology.nodes.push_back(std::move(entry));
+    }
+#endif // !_WIN32
+    if (topology.nodes.empty())
+    {
+        Node entry;
+        entry.index = 0;
+        for (uint32_t cpu = 0; cpu < std::max(1U, std::thread::hardware_concurrency()); ++cpu)
+            entry.cpus.push_back(cpu);
+        topology.nodes.push_back(std::move(entry));
+    }
+    return topology;
+}
+
+uint32_t CpuTopology::getCpuCount() const noexcept
+{
+    size_t count = 0;
+    for (const Node& node : nodes)
+        count += node.cpus.size();
+    return static_cast<uint32_t>(count);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// NUMA nodes and their logical CPUs. On Linux it is read from
+// /sys/devices/system/node and limited to the affinity mask of the process,
+// on Windows from the first processor group. If nothing can be read,
+// all hardware threads are reported as a single node.
+class CpuTopology
+{
+public:
+    struct Node
+    {
+        uint32_t index; // OS node number
+        std::vector<uint32_t> cpus;
+    };
+
+    static CpuTopology probe();
+    const std::vector<Node>& getNodes() const noexcept { return nodes; }
+    uint32_t getNodeCount() const noexcept { return static_cast<uint32_t>(nodes.size()); }
+    uint32_t getCpuCount() const noexcept;
+
+private:
+    std::vector<Node> nodes;
+};
+
+// Parses kernel CPU list format, e.g. "0-3,8-11"
+std::vector<uint32_t> parseCpuList(const std::string& list);
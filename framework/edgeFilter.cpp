@@ -0,0 +1,49 @@
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <emmintrin.h>
+#include "edgeFilter.h"
+
+void sobelScanline(const float *above, const float *row, const float *below,
+    uint32_t width, uint8_t *edges)
+{
+    const __m128 two = _mm_set1_ps(2.f);
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 maxValue = _mm_set1_ps(255.f);
+    uint32_t x = 0;
+    for (; x + 4 <= width; x += 4)
+    {   // Left, center and right columns of 3x3 neighbourhood
+        const __m128 l0 = _mm_loadu_ps(above + x - 1);
+        const __m128 c0 = _mm_loadu_ps(above + x);
+        const __m128 r0 = _mm_loadu_ps(above + x + 1);
+        const __m128 l1 = _mm_loadu_ps(row + x - 1);
+        const __m128 r1 = _mm_loadu_ps(row + x + 1);
+        const __m128 l2 = _mm_loadu_ps(below + x - 1);
+        const __m128 c2 = _mm_loadu_ps(below + x);
+        const __m128 r2 = _mm_loadu_ps(below + x + 1);
+        const __m128 gx = _mm_sub_ps(
+            _mm_add_ps(_mm_add_ps(r0, r2), _mm_mul_ps(r1, two)),
+            _mm_add_ps(_mm_add_ps(l0, l2), _mm_mul_ps(l1, two)));
+        const __m128 gy = _mm_sub_ps(
+            _mm_add_ps(_mm_add_ps(l2, r2), _mm_mul_ps(c2, two)),
+            _mm_add_ps(_mm_add_ps(l0, r0), _mm_mul_ps(c0, two)));
+        __m128 grad = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy)));
+        // Saturate as UNORM render target does
+        grad = _mm_mul_ps(_mm_min_ps(grad, one), maxValue);
+        const __m128i i32 = _mm_cvtps_epi32(grad);
+        const __m128i i16 = _mm_packs_epi32(i32, i32);
+        const __m128i u8 = _mm_packus_epi16(i16, i16);
+        const int32_t packed = _mm_cvtsi128_si32(u8);
+        memcpy(edges + x, &packed, sizeof(int32_t));
+    }
+    for (; x < width; ++x)
+    {   // Offsets are taken from column pointers, so that left border at x = 0
+        // reads padding element [-1] instead of wrapping unsigned index
+        const float *a = above + x, *r = row + x, *b = below + x;
+        const float gx = (a[1] + 2.f * r[1] + b[1]) - (a[-1] + 2.f * r[-1] + b[-1]);
+        const float gy = (b[-1] + 2.f * b[0] + b[1]) - (a[-1] + 2.f * a[0] + a[1]);
+        const float grad = std::min(sqrtf(gx * gx + gy * gy), 1.f);
+        edges[x] = static_cast<uint8_t>(grad * 255.f + 0.5f);
+    }
+}
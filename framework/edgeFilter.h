@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <functional>
+#include "alignedAllocator.h"
+#include "nonCopyable.h"
+
+// Converts source pixels to normalized luminance in [0, 1]
+template<typename T>
+struct PixelTraits;
+
+template<>
+struct PixelTraits<uint8_t>
+{
+    static float normalize(uint8_t value) { return value * (1.f/255.f); }
+};
+
+template<>
+struct PixelTraits<uint16_t>
+{
+    static float normalize(uint16_t value) { return value * (1.f/65535.f); }
+};
+
+template<>
+struct PixelTraits<float>
+{
+    static float normalize(float value) { return value; }
+};
+
+// Computes one row of 8-bit gradient magnitude from three consecutive padded rows.
+// Each row should have valid elements at [-1] and [width].
+void sobelScanline(const float *above, const float *row, const float *below,
+    uint32_t width, uint8_t *edges);
+
+// Push-style Sobel filter that keeps only kernel-height ring of rows.
+// Output row is emitted as soon as its neighbourhood is complete, so
+// the latency is one scanline instead of the whole frame.
+template<typename T>
+class ScanlineEdgeFilter : public NonCopyable
+{
+public:
+    typedef std::function<void(uint32_t y, const uint8_t *edges)> RowCallback;
+
+    ScanlineEdgeFilter(uint32_t width, uint32_t height, RowCallback callback);
+    void pushRow(const T *row);
+    void reset();
+    uint32_t getWidth() const { return width; }
+    uint32_t getHeight() const { return height; }
+    bool finished() const { return rowsEmitted == height; }
+
+private:
+    float *ringRow(uint32_t y) { return ring.data() + (y % kernelSize) * pitch + 1; }
+    void loadRow(const T *row, float *dst);
+    void emitRow(uint32_t y);
+
+    static constexpr uint32_t kernelSize = 3;
+    const uint32_t width;
+    const uint32_t height;
+    const uint32_t pitch;
+    RowCallback callback;
+    std::vector<float, utilities::aligned_allocator<float>> ring;
+    std::vector<uint8_t> edges;
+    uint32_t rowsPushed = 0;
+    uint32_t rowsEmitted = 0;
+};
+
+// Filters whole image at once, edges should have width * height elements
+template<typename T>
+void detectEdges(const T *pixels, uint32_t width, uint32_t height, uint8_t *edges);
+
+// Filters band of rows, reading one row of halo above and below it,
+// so that horizontal strips of image can be processed independently
+template<typename T>
+void detectEdgesInRows(const T *pixels, uint32_t width, uint32_t height,
+    uint32_t firstRow, uint32_t rowCount, uint8_t *edges);
+
+#include "edgeFilter.inl"
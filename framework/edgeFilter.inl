@@ -0,0 +1,83 @@
+template<typename T>
+inline ScanlineEdgeFilter<T>::ScanlineEdgeFilter(uint32_t width, uint32_t height, RowCallback callback):
+    width(width),
+    height(height),
+    pitch((width + 2 + 3) & ~3), // Left and right border, multiple of SSE vector
+    callback(std::move(callback)),
+    ring(kernelSize * pitch),
+    edges(width)
+{
+    assert(width > 0);
+    assert(height > 0);
+}
+
+template<typename T>
+inline void ScanlineEdgeFilter<T>::pushRow(const T *row)
+{
+    assert(rowsPushed < height);
+    loadRow(row, ringRow(rowsPushed));
+    ++rowsPushed;
+    if (rowsPushed >= 2)
+        emitRow(rowsPushed - 2);
+    if (rowsPushed == height)
+    {   // Bottom row has no neighbour below, clamp to edge
+        emitRow(height - 1);
+    }
+}
+
+template<typename T>
+inline void ScanlineEdgeFilter<T>::reset()
+{
+    rowsPushed = 0;
+    rowsEmitted = 0;
+}
+
+template<typename T>
+inline void ScanlineEdgeFilter<T>::loadRow(const T *row, float *dst)
+{
+    for (uint32_t x = 0; x < width; ++x)
+        dst[x] = PixelTraits<T>::normalize(row[x]);
+    // Clamp to edge
+    dst[-1] = dst[0];
+    dst[width] = dst[width - 1];
+}
+
+template<typename T>
+inline void ScanlineEdgeFilter<T>::emitRow(uint32_t y)
+{
+    const float *above = ringRow(y > 0 ? y - 1 : 0);
+    const float *below = ringRow(y + 1 < height ? y + 1 : y);
+    sobelScanline(above, ringRow(y), below, width, edges.data());
+    callback(y, edges.data());
+    ++rowsEmitted;
+}
+
+template<typename T>
+inline void detectEdges(const T *pixels, uint32_t width, uint32_t height, uint8_t *edges)
+{
+    ScanlineEdgeFilter<T> filter(width, height,
+        [edges, width](uint32_t y, const uint8_t *row)
+        {
+            memcpy(edges + size_t(y) * width, row, width);
+        });
+    for (uint32_t y = 0; y < height; ++y)
+        filter.pushRow(pixels + size_t(y) * width);
+}
+
+template<typename T>
+inline void detectEdgesInRows(const T *pixels, uint32_t width, uint32_t height,
+    uint32_t firstRow, uint32_t rowCount, uint8_t *edges)
+{
+    assert(firstRow + rowCount <= height);
+    const uint32_t top = firstRow > 0 ? firstRow - 1 : 0;
+    const uint32_t bottom = firstRow + rowCount < height ? firstRow + rowCount + 1 : height;
+    ScanlineEdgeFilter<T> filter(width, bottom - top,
+        [edges, width, top, firstRow, rowCount](uint32_t y, const uint8_t *row)
+        {   // Halo rows are clamped at the band border, so drop them
+            const uint32_t imageRow = top + y;
+            if (imageRow >= firstRow && imageRow < firstRow + rowCount)
+                memcpy(edges + size_t(imageRow) * width, row, width);
+        });
+    for (uint32_t y = top; y < bottom; ++y)
+        filter.pushRow(pixels + size_t(y) * width);
+}
@@ -0,0 +1,45 @@
+#include "edgeLines.h"
+#include "../magma/magma.h"
+
+// Written by CPU every frame, read by vertex input
+class HostLineBuffer : public magma::Buffer
+{
+public:
+    HostLineBuffer(std::shared_ptr<magma::Device> device, VkDeviceSize size):
+        magma::Buffer(device, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 0,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+    {}
+};
+
+EdgeLines::EdgeLines(std::shared_ptr<magma::Device> device, uint32_t maxEdges):
+    maxEdges(maxEdges)
+{
+    buffer = std::make_shared<HostLineBuffer>(device, maxEdges * 2 * sizeof(rapid::float3));
+    vertices = static_cast<rapid::float3 *>(buffer->getMemory()->map());
+}
+
+EdgeLines::~EdgeLines()
+{
+    buffer->getMemory()->unmap();
+}
+
+void EdgeLines::draw(magma::CommandBuffer& cmdBuffer, uint32_t edgeCount) const
+{
+    assert(edgeCount <= maxEdges);
+    if (!edgeCount)
+        return;
+    cmdBuffer.bindVertexBuffer(0, buffer);
+    cmdBuffer.draw(edgeCount * 2, 1, 0, 0);
+}
+
+const magma::VertexInputState& EdgeLines::getVertexInput()
+{
+    static const magma::VertexInputState vertexInput(
+    {
+        magma::VertexInputBinding(0, sizeof(rapid::float3)) // Position
+    },
+    {
+        magma::VertexInputAttribute(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0)
+    });
+    return vertexInput;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "indexedMesh.h"
+#include "nonCopyable.h"
+
+namespace magma
+{
+    class Device;
+    class Buffer;
+    class CommandBuffer;
+    class VertexInputState;
+}
+
+// Host-visible line list that MeshEdges::extract() writes to every frame.
+// Buffer stays mapped and is sized for the case when all edges are visible.
+class EdgeLines : public NonCopyable
+{
+public:
+    EdgeLines(std::shared_ptr<magma::Device> device, uint32_t maxEdges);
+    ~EdgeLines();
+    rapid::float3 *getVertices() noexcept { return vertices; }
+    void draw(magma::CommandBuffer& cmdBuffer, uint32_t edgeCount) const;
+    static const magma::VertexInputState& getVertexInput();
+
+private:
+    const uint32_t maxEdges;
+    std::shared_ptr<magma::Buffer> buffer;
+    rapid::float3 *vertices;
+};
@@ -0,0 +1,46 @@
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <iostream>
+#include "frameBenchmark.h"
+
+FrameBenchmark::FrameBenchmark(uint32_t frameCount, uint32_t warmupFrames, float timestepMilliseconds):
+    frameCount(frameCount),
+    warmupFrames(warmupFrames),
+    timestep(timestepMilliseconds),
+    prev(HiResClock::now())
+{
+    frameTimes.reserve(frameCount);
+}
+
+bool FrameBenchmark::endFrame()
+{
+    const auto now = HiResClock::now();
+    const std::chrono::duration<float, std::milli> frameTime = now - prev;
+    prev = now;
+    if (frameIndex >= warmupFrames && frameIndex < warmupFrames + frameCount)
+        frameTimes.push_back(frameTime.count());
+    ++frameIndex;
+    return finished();
+}
+
+void FrameBenchmark::printStatistics() const
+{
+    if (frameTimes.empty())
+        return;
+    std::vector<float> sorted(frameTimes);
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](float p)
+    {   // Nearest rank
+        const size_t rank = static_cast<size_t>(std::ceil(p * 0.01f * sorted.size()));
+        return sorted[std::min(std::max(rank, size_t(1)), sorted.size()) - 1];
+    };
+    const float total = std::accumulate(sorted.begin(), sorted.end(), 0.f);
+    const float mean = total / sorted.size();
+    std::cout << "Benchmark: " << sorted.size() << " frames at " << timestep << " ms step"
+        << " (" << frameIndex - sorted.size() << " warm-up), mean " << mean << " ms ("
+        << 1000.f / mean << " fps), min " << sorted.front()
+        << ", p50 " << percentile(50.f) << ", p90 " << percentile(90.f)
+        << ", p95 " << percentile(95.f) << ", p99 " << percentile(99.f)
+        << ", max " << sorted.back() << " ms\n";
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include "nonCopyable.h"
+
+// Makes runs reproducible: simulation advances by fixed time step instead of
+// wall clock, so every run renders the same sequence of frames, and app quits
+// after given number of frames. Wall-clock frame times are collected after
+// warm-up frames to print percentiles that can be compared across runs.
+class FrameBenchmark : public NonCopyable
+{
+public:
+    FrameBenchmark(uint32_t frameCount, uint32_t warmupFrames, float timestepMilliseconds);
+    float getTimestep() const noexcept { return timestep; } // Milliseconds
+    // Simulation time of current frame in seconds
+    float getTime() const noexcept { return frameIndex * timestep * 0.001f; }
+    uint32_t getFrameIndex() const noexcept { return frameIndex; }
+    // Marks end of frame, returns true when the last frame is done
+    bool endFrame();
+    bool finished() const noexcept { return frameIndex >= warmupFrames + frameCount; }
+    void printStatistics() const;
+
+private:
+    typedef std::chrono::high_resolution_clock HiResClock;
+
+    const uint32_t frameCount;
+    const uint32_t warmupFrames;
+    const float timestep;
+    uint32_t frameIndex = 0;
+    HiResClock::time_point prev;
+    std::vector<float> frameTimes; // Milliseconds
+};
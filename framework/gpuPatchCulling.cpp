@@ -0,0 +1,97 @@
+#include <cstring>
+#include "gpuPatchCulling.h"
+#include "shader.h"
+#include "../magma/magma.h"
+
+// Written by compute shader, then read by indirect draw or vertex shader
+class DeviceStorageBuffer : public magma::Buffer
+{
+public:
+    DeviceStorageBuffer(std::shared_ptr<magma::Device> device, VkDeviceSize size, VkBufferUsageFlags usage):
+        magma::Buffer(device, size,
+            usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 0,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    {}
+};
+
+GpuPatchCuller::GpuPatchCuller(std::shared_ptr<magma::Device> device,
+    std::shared_ptr<magma::PipelineCache> pipelineCache,
+    const PatchBounds& bounds,
+    uint32_t indexCount,
+    std::shared_ptr<magma::CommandBuffer> cmdBuffer):
+    patchCount(bounds.getPatchCount()),
+    indexCount(indexCount)
+{
+    const std::vector<float> packedBounds = bounds.pack();
+    std::shared_ptr<magma::SrcTransferBuffer> srcBuffer(std::make_shared<magma::SrcTransferBuffer>(
+        device, packedBounds.size() * sizeof(float)));
+    magma::helpers::mapScoped<float>(srcBuffer, [&packedBounds](float *data)
+    {
+        memcpy(data, packedBounds.data(), packedBounds.size() * sizeof(float));
+    });
+    boundsBuffer = std::make_shared<magma::StorageBuffer>(cmdBuffer, srcBuffer);
+    indirectBuffer = std::make_shared<DeviceStorageBuffer>(device,
+        sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    visiblePatches = std::make_shared<DeviceStorageBuffer>(device, patchCount * sizeof(uint32_t), 0);
+    constants = std::make_shared<magma::UniformBuffer<Constants>>(device);
+    // Setup descriptor set
+    const magma::Descriptor uniformBufferDesc = magma::descriptors::UniformBuffer(1);
+    const magma::Descriptor storageBufferDesc = magma::descriptors::StorageBuffer(3);
+    descriptorPool = std::make_shared<magma::DescriptorPool>(device, 1,
+        std::vector<magma::Descriptor>{uniformBufferDesc, storageBufferDesc});
+    descriptorSetLayout = std::make_shared<magma::DescriptorSetLayout>(device,
+        std::initializer_list<magma::DescriptorSetLayout::Binding>{
+            magma::bindings::ComputeStageBinding(0, uniformBufferDesc),
+            magma::bindings::ComputeStageBinding(1, magma::descriptors::StorageBuffer(1)), // Bounds
+            magma::bindings::ComputeStageBinding(2, magma::descriptors::StorageBuffer(1)), // Draw command
+            magma::bindings::ComputeStageBinding(3, magma::descriptors::StorageBuffer(1))  // Visible patches
+        });
+    descriptorSet = descriptorPool->allocateDescriptorSet(descriptorSetLayout);
+    descriptorSet->update(0, constants);
+    descriptorSet->update(1, boundsBuffer);
+    descriptorSet->update(2, indirectBuffer);
+    descriptorSet->update(3, visiblePatches);
+    pipelineLayout = std::make_shared<magma::PipelineLayout>(descriptorSetLayout);
+    pipeline = std::make_shared<magma::ComputePipeline>(device, pipelineCache,
+        ComputeShader(device, "cull.o"), pipelineLayout);
+}
+
+GpuPatchCuller::~GpuPatchCuller()
+{}
+
+void GpuPatchCuller::setWorldViewProj(const float worldViewProj[16])
+{
+    culler.setWorldViewProj(worldViewProj);
+    magma::helpers::mapScoped<Constants>(constants, true, [this](Constants *data)
+    {
+        for (uint32_t i = 0; i < 6; ++i)
+            memcpy(data->planes[i], culler.getPlane(i), sizeof(float) * 4);
+        memcpy(data->eye, culler.getEye(), sizeof(float) * 3);
+        data->eye[3] = culler.hasEye() ? 1.f : 0.f;
+        data->patchCount = patchCount;
+    });
+}
+
+void GpuPatchCuller::recordCulling(magma::CommandBuffer& cmdBuffer) const
+{   // Reset instance count, the rest of draw command never changes
+    const VkDrawIndexedIndirectCommand drawCommand = {indexCount, 0, 0, 0, 0};
+    cmdBuffer.updateBuffer(indirectBuffer, sizeof(drawCommand), &drawCommand);
+    cmdBuffer.pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        magma::MemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT));
+    cmdBuffer.bindPipeline(pipeline);
+    cmdBuffer.bindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, descriptorSet);
+    cmdBuffer.dispatch((patchCount + workGroupSize - 1) / workGroupSize, 1, 1);
+    cmdBuffer.pipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        magma::MemoryBarrier(VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT));
+}
+
+std::shared_ptr<magma::Buffer> GpuPatchCuller::getIndirectBuffer() const noexcept
+{
+    return indirectBuffer;
+}
+
+std::shared_ptr<magma::Buffer> GpuPatchCuller::getVisiblePatches() const noexcept
+{
+    return visiblePatches;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "patchCulling.h"
+#include "nonCopyable.h"
+
+namespace magma
+{
+    class Device;
+    class Buffer;
+    class StorageBuffer;
+    class CommandBuffer;
+    class PipelineCache;
+    class PipelineLayout;
+    class ComputePipeline;
+    class DescriptorPool;
+    class DescriptorSetLayout;
+    class DescriptorSet;
+    template<typename Type> class UniformBuffer;
+}
+
+// Compute pass that tests patch bounds and writes single VkDrawIndexedIndirectCommand,
+// which instance count is the number of visible patches, and list of their indices
+// for vertex shader to look up by gl_InstanceIndex. Commands are recorded once,
+// only frustum constants change per frame.
+class GpuPatchCuller : public NonCopyable
+{
+public:
+    GpuPatchCuller(std::shared_ptr<magma::Device> device,
+        std::shared_ptr<magma::PipelineCache> pipelineCache,
+        const PatchBounds& bounds,
+        uint32_t indexCount,
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer);
+    ~GpuPatchCuller();
+    void setWorldViewProj(const float worldViewProj[16]);
+    // Takes effect in command buffers recorded afterwards
+    void setIndexCount(uint32_t indexCount) noexcept { this->indexCount = indexCount; }
+    // Has to be recorded outside of render pass
+    void recordCulling(magma::CommandBuffer& cmdBuffer) const;
+    std::shared_ptr<magma::Buffer> getIndirectBuffer() const noexcept;
+    std::shared_ptr<magma::Buffer> getVisiblePatches() const noexcept;
+
+private:
+    struct Constants
+    {
+        float planes[6][4];
+        float eye[4]; // w is 0 if back-face test is disabled
+        uint32_t patchCount;
+        uint32_t padding[3];
+    };
+
+    static constexpr uint32_t workGroupSize = 64;
+    const uint32_t patchCount;
+    uint32_t indexCount;
+    PatchCuller culler;
+    std::shared_ptr<magma::StorageBuffer> boundsBuffer;
+    std::shared_ptr<magma::Buffer> indirectBuffer;
+    std::shared_ptr<magma::Buffer> visiblePatches;
+    std::shared_ptr<magma::UniformBuffer<Constants>> constants;
+    std::shared_ptr<magma::DescriptorPool> descriptorPool;
+    std::shared_ptr<magma::DescriptorSetLayout> descriptorSetLayout;
+    std::shared_ptr<magma::DescriptorSet> descriptorSet;
+    std::shared_ptr<magma::PipelineLayout> pipelineLayout;
+    std::shared_ptr<magma::ComputePipeline> pipeline;
+};
@@ -0,0 +1,128 @@
+#include <cassert>
+#include <cstdint>
+#include <atomic>
+#include <xmmintrin.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#include "hostMemory.h"
+
+namespace utilities
+{
+static std::atomic<int> hugePages(static_cast<int>(HugePages::Off));
+static std::atomic<int> numaNode(-1);
+
+static size_t roundUp(size_t size, size_t multiple) noexcept
+{
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+#ifdef _WIN32
+static void *allocatePages(size_t size, HugePages pages, int node) noexcept
+{   // Large pages need "Lock pages in memory" privilege
+    const HANDLE process = GetCurrentProcess();
+    const DWORD preferredNode = node >= 0 ? static_cast<DWORD>(node) : NUMA_NO_PREFERRED_NODE;
+    const SIZE_T largePageSize = GetLargePageMinimum();
+    if (HugePages::Explicit == pages && largePageSize)
+    {
+        void *p = VirtualAllocExNuma(process, nullptr, roundUp(size, largePageSize),
+            MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, preferredNode);
+        if (p)
+            return p;
+    }
+    return VirtualAllocExNuma(process, nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, preferredNode);
+}
+
+static void freePages(void *p, size_t /* size */) noexcept
+{
+    VirtualFree(p, 0, MEM_RELEASE);
+}
+#else
+static void bindToNode(void *p, size_t size, int node) noexcept
+{   // mbind() from libnuma is just a wrapper of the syscall
+    constexpr int MPOL_PREFERRED = 1;
+    unsigned long nodeMask[4] = {};
+    constexpr int maxNode = sizeof(nodeMask) * 8;
+    if (node < maxNode)
+    {
+        nodeMask[node / (sizeof(unsigned long) * 8)] |= 1UL << (node % (sizeof(unsigned long) * 8));
+        syscall(SYS_mbind, p, size, MPOL_PREFERRED, nodeMask, maxNode, 0);
+    }
+}
+
+static void *allocatePages(size_t size, HugePages pages, int node) noexcept
+{
+    void *p = MAP_FAILED;
+    if (HugePages::Explicit == pages)
+    {   // Fails if no huge pages are reserved in /proc/sys/vm/nr_hugepages
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (MAP_FAILED == p)
+    {   // Map extra 2M and trim it to get 2M-aligned range, otherwise
+        // transparent huge pages can't be used at both ends
+        const size_t length = size + largeAllocationSize;
+        char *base = reinterpret_cast<char *>(mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (MAP_FAILED == base)
+            return nullptr;
+        char *aligned = reinterpret_cast<char *>(roundUp(reinterpret_cast<uintptr_t>(base), largeAllocationSize));
+        if (aligned > base)
+            munmap(base, aligned - base);
+        if (aligned + size < base + length)
+            munmap(aligned + size, base + length - (aligned + size));
+        p = aligned;
+        if (pages != HugePages::Off)
+            madvise(p, size, MADV_HUGEPAGE);
+    }
+    if (node >= 0)
+        bindToNode(p, size, node);
+    return p;
+}
+
+static void freePages(void *p, size_t size) noexcept
+{
+    munmap(p, size);
+}
+#endif // !_WIN32
+
+void setLargeAllocationPolicy(const LargeAllocationPolicy& policy) noexcept
+{
+    hugePages = static_cast<int>(policy.hugePages);
+    numaNode = policy.numaNode;
+}
+
+LargeAllocationPolicy getLargeAllocationPolicy() noexcept
+{
+    LargeAllocationPolicy policy;
+    policy.hugePages = static_cast<HugePages>(hugePages.load());
+    policy.numaNode = numaNode;
+    return policy;
+}
+
+void *alignedAlloc(size_t size, size_t alignment) noexcept
+{
+    assert(alignment && !(alignment & (alignment - 1)));
+    assert(alignment <= 4096);
+    if (size < largeAllocationSize)
+        return _mm_malloc(size, alignment);
+    // Pages are always aligned enough
+    return allocatePages(roundUp(size, largeAllocationSize),
+        static_cast<HugePages>(hugePages.load(std::memory_order_relaxed)),
+        numaNode.load(std::memory_order_relaxed));
+}
+
+void alignedFree(void *p, size_t size) noexcept
+{
+    if (!p)
+        return;
+    if (size < largeAllocationSize)
+        _mm_free(p);
+    else
+        freePages(p, roundUp(size, largeAllocationSize));
+}
+} // namespace utilities
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+
+namespace utilities
+{
+    constexpr size_t cacheLineSize = 64;
+    // Allocations of this size and larger are mapped from the OS directly,
+    // rounded up to multiple of this size, so they can be backed by 2M pages.
+    constexpr size_t largeAllocationSize = 2 * 1024 * 1024;
+
+    enum class HugePages
+    {
+        Off,
+        Transparent, // madvise(MADV_HUGEPAGE), no effect on Windows
+        Explicit     // MAP_HUGETLB or MEM_LARGE_PAGES, falls back to transparent
+    };
+
+    // Applies to large allocations made after it is set
+    struct LargeAllocationPolicy
+    {
+        HugePages hugePages = HugePages::Off;
+        int numaNode = -1; // Any node
+    };
+
+    void setLargeAllocationPolicy(const LargeAllocationPolicy& policy) noexcept;
+    LargeAllocationPolicy getLargeAllocationPolicy() noexcept;
+
+    // Alignment should be power of two not greater than page size.
+    // Size passed to alignedFree() should be the same as allocated.
+    void *alignedAlloc(size_t size, size_t alignment) noexcept;
+    void alignedFree(void *p, size_t size) noexcept;
+} // namespace utilities
@@ -0,0 +1,504 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <emmintrin.h>
+#include "imageEncoder.h"
+#include "threadPool.h"
+
+// Deflate bit stream is filled from least significant bit
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<uint8_t>& out): out(out) {}
+
+    void put(uint32_t bits, uint32_t count)
+    {
+        buffer |= uint64_t(bits) << bitCount;
+        bitCount += count;
+        while (bitCount >= 8)
+        {
+            out.push_back(static_cast<uint8_t>(buffer));
+            buffer >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    void align()
+    {
+        if (bitCount)
+            put(0, 8 - bitCount);
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t buffer = 0;
+    uint32_t bitCount = 0;
+};
+
+struct FixedCode
+{
+    uint16_t bits;
+    uint16_t length;
+};
+
+// Fixed Huffman codes of literal/length alphabet, bit-reversed for the stream
+static const FixedCode *getFixedCodes()
+{
+    static const struct Table
+    {
+        Table()
+        {
+            for (uint32_t literal = 0; literal < 288; ++literal)
+            {
+                uint32_t code, length;
+                if (literal < 144)
+                    code = 0x30 + literal, length = 8;
+                else if (literal < 256)
+                    code = 0x190 + literal - 144, length = 9;
+                else if (literal < 280)
+                    code = literal - 256, length = 7;
+                else
+                    code = 0xC0 + literal - 280, length = 8;
+                uint32_t reversed = 0;
+                for (uint32_t i = 0; i < length; ++i, code >>= 1)
+                    reversed = (reversed << 1) | (code & 1);
+                codes[literal].bits = static_cast<uint16_t>(reversed);
+                codes[literal].length = static_cast<uint16_t>(length);
+            }
+        }
+        FixedCode codes[288];
+    } table;
+    return table.codes;
+}
+
+static void putFixedLiteral(BitWriter& writer, const FixedCode *codes, uint32_t literal)
+{
+    writer.put(codes[literal].bits, codes[literal].length);
+}
+
+static void putFixedMatch(BitWriter& writer, const FixedCode *codes, uint32_t length)
+{
+    static const uint16_t lengthBase[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const uint8_t lengthExtra[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    uint32_t code = 28;
+    while (lengthBase[code] > length)
+        --code;
+    putFixedLiteral(writer, codes, 257 + code);
+    writer.put(length - lengthBase[code], lengthExtra[code]);
+    writer.put(0, 5); // Distance 1
+}
+
+// Compresses data as non-final fixed Huffman block followed by empty stored block,
+// so that output ends on byte boundary and can be concatenated with other chunks.
+static void deflateChunk(const uint8_t *data, size_t size, std::vector<uint8_t>& out)
+{
+    const FixedCode *codes = getFixedCodes();
+    BitWriter writer(out);
+    writer.put(0, 1); // BFINAL
+    writer.put(1, 2); // BTYPE = fixed Huffman
+    size_t i = 0;
+    while (i < size)
+    {
+        if (i > 0)
+        {   // Repeat previous byte
+            const uint8_t prev = data[i - 1];
+            uint32_t run = 0;
+            while (i + run < size && run < 258 && data[i + run] == prev)
+                ++run;
+            if (run >= 3)
+            {
+                putFixedMatch(writer, codes, run);
+                i += run;
+                continue;
+            }
+        }
+        putFixedLiteral(writer, codes, data[i++]);
+    }
+    putFixedLiteral(writer, codes, 256); // End of block
+    writer.put(0, 3); // Empty stored block
+    writer.align();
+    const uint8_t emptyStored[4] = {0x00, 0x00, 0xFF, 0xFF};
+    out.insert(out.end(), emptyStored, emptyStored + 4);
+}
+
+static uint32_t adler32(const uint8_t *data, size_t size)
+{
+    const uint32_t base = 65521;
+    uint32_t a = 1, b = 0;
+    while (size)
+    {   // Largest number of bytes that can't overflow
+        const size_t n = std::min(size, size_t(5552));
+        for (size_t i = 0; i < n; ++i)
+        {
+            a += data[i];
+            b += a;
+        }
+        a %= base;
+        b %= base;
+        data += n;
+        size -= n;
+    }
+    return (b << 16) | a;
+}
+
+// https://github.com/madler/zlib/blob/master/adler32.c
+static uint32_t adler32Combine(uint32_t adler1, uint32_t adler2, size_t size2)
+{
+    const uint32_t base = 65521;
+    const uint32_t rem = static_cast<uint32_t>(size2 % base);
+    uint32_t sum1 = adler1 & 0xFFFF;
+    uint32_t sum2 = static_cast<uint32_t>((uint64_t(rem) * sum1) % base);
+    sum1 += (adler2 & 0xFFFF) + base - 1;
+    sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + base - rem;
+    if (sum1 >= base) sum1 -= base;
+    if (sum1 >= base) sum1 -= base;
+    if (sum2 >= (base << 1)) sum2 -= (base << 1);
+    if (sum2 >= base) sum2 -= base;
+    return sum1 | (sum2 << 16);
+}
+
+static uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0)
+{
+    static const struct Table
+    {
+        Table()
+        {
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+                entries[n] = c;
+            }
+        }
+        uint32_t entries[256];
+    } table;
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void putBigEndian(uint8_t *dst, uint32_t value)
+{
+    dst[0] = static_cast<uint8_t>(value >> 24);
+    dst[1] = static_cast<uint8_t>(value >> 16);
+    dst[2] = static_cast<uint8_t>(value >> 8);
+    dst[3] = static_cast<uint8_t>(value);
+}
+
+static void appendChunk(std::vector<uint8_t>& out, const char *type, const uint8_t *data, size_t size)
+{
+    const size_t pos = out.size();
+    out.resize(pos + 12 + size);
+    uint8_t *chunk = out.data() + pos;
+    putBigEndian(chunk, static_cast<uint32_t>(size));
+    memcpy(chunk + 4, type, 4);
+    if (size)
+        memcpy(chunk + 8, data, size);
+    putBigEndian(chunk + 8 + size, crc32(chunk + 4, size + 4));
+}
+
+// Filter cost heuristic: sum of absolute values of bytes treated as signed
+static uint32_t filterCost(const uint8_t *row, uint32_t width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+        const __m128i absValue = _mm_min_epu8(v, _mm_sub_epi8(zero, v));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(absValue, zero));
+    }
+    uint32_t cost = static_cast<uint32_t>(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+    for (; x < width; ++x)
+        cost += std::min<uint32_t>(row[x], 256 - row[x]);
+    return cost;
+}
+
+static void filterSub(const uint8_t *row, uint32_t width, uint8_t *out)
+{
+    out[0] = row[0];
+    uint32_t x = 1;
+    for (; x + 16 <= width; x += 16)
+    {
+        const __m128i curr = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+        const __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x - 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_sub_epi8(curr, left));
+    }
+    for (; x < width; ++x)
+        out[x] = row[x] - row[x - 1];
+}
+
+static void filterUp(const uint8_t *row, const uint8_t *prevRow, uint32_t width, uint8_t *out)
+{
+    if (!prevRow)
+    {
+        memcpy(out, row, width);
+        return;
+    }
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        const __m128i curr = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+        const __m128i up = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prevRow + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_sub_epi8(curr, up));
+    }
+    for (; x < width; ++x)
+        out[x] = row[x] - prevRow[x];
+}
+
+struct PngBlock
+{
+    std::vector<uint8_t> filtered;
+    std::vector<uint8_t> chunk;
+    uint32_t adler = 1;
+};
+
+static void encodePngBlock(const uint8_t *pixels, uint32_t width, uint32_t y0, uint32_t y1,
+    PngFilter filter, bool first, PngBlock& block)
+{
+    const size_t stride = size_t(width) + 1;
+    block.filtered.resize((y1 - y0) * stride);
+    std::vector<uint8_t> candidate(PngFilter::Adaptive == filter ? width : 0);
+    for (uint32_t y = y0; y < y1; ++y)
+    {
+        const uint8_t *row = pixels + size_t(y) * width;
+        const uint8_t *prevRow = y > 0 ? row - width : nullptr;
+        uint8_t *out = block.filtered.data() + (y - y0) * stride;
+        switch (filter)
+        {
+        case PngFilter::None:
+            out[0] = 0;
+            memcpy(out + 1, row, width);
+            break;
+        case PngFilter::Sub:
+            out[0] = 1;
+            filterSub(row, width, out + 1);
+            break;
+        case PngFilter::Up:
+            out[0] = 2;
+            filterUp(row, prevRow, width, out + 1);
+            break;
+        case PngFilter::Adaptive:
+            {   // Pick the cheapest of None, Sub and Up
+                uint32_t bestCost = filterCost(row, width);
+                out[0] = 0;
+                memcpy(out + 1, row, width);
+                filterSub(row, width, candidate.data());
+                uint32_t cost = filterCost(candidate.data(), width);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    out[0] = 1;
+                    memcpy(out + 1, candidate.data(), width);
+                }
+                if (prevRow)
+                {
+                    filterUp(row, prevRow, width, candidate.data());
+                    cost = filterCost(candidate.data(), width);
+                    if (cost < bestCost)
+                    {
+                        out[0] = 2;
+                        memcpy(out + 1, candidate.data(), width);
+                    }
+                }
+            }
+            break;
+        }
+    }
+    block.adler = adler32(block.filtered.data(), block.filtered.size());
+    std::vector<uint8_t> data;
+    data.reserve(block.filtered.size() * 9 / 8 + 16);
+    if (first)
+    {   // zlib header: deflate, 32K window, fastest
+        data.push_back(0x78);
+        data.push_back(0x01);
+    }
+    deflateChunk(block.filtered.data(), block.filtered.size(), data);
+    block.chunk.clear();
+    appendChunk(block.chunk, "IDAT", data.data(), data.size());
+}
+
+void encodePgm(const uint8_t *pixels, uint32_t width, uint32_t height, EncodedBuffer& out)
+{
+    const std::string header = "P5\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    const size_t size = size_t(width) * height;
+    out.resize(header.size() + size);
+    memcpy(out.data(), header.data(), header.size());
+    memcpy(out.data() + header.size(), pixels, size);
+}
+
+// https://qoiformat.org/qoi-specification.pdf
+// Gray is encoded as RGB with equal channels.
+void encodeQoi(const uint8_t *pixels, uint32_t width, uint32_t height, EncodedBuffer& out)
+{
+    const size_t pixelCount = size_t(width) * height;
+    out.resize(14 + pixelCount * 4 + 8); // Worst case
+    uint8_t *dst = out.data();
+    memcpy(dst, "qoif", 4);
+    putBigEndian(dst + 4, width);
+    putBigEndian(dst + 8, height);
+    dst[12] = 3; // RGB
+    dst[13] = 1; // Linear
+    dst += 14;
+    int16_t index[64];
+    std::fill(index, index + 64, int16_t(-1));
+    uint8_t prev = 0;
+    uint32_t run = 0;
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        const uint8_t value = pixels[i];
+        if (value == prev)
+        {
+            ++run;
+            if (62 == run || i + 1 == pixelCount)
+            {
+                *dst++ = static_cast<uint8_t>(0xC0 | (run - 1)); // QOI_OP_RUN
+                run = 0;
+            }
+            continue;
+        }
+        if (run)
+        {
+            *dst++ = static_cast<uint8_t>(0xC0 | (run - 1));
+            run = 0;
+        }
+        const uint32_t hash = (value * 15 + 255 * 11) % 64;
+        if (index[hash] == value)
+            *dst++ = static_cast<uint8_t>(hash); // QOI_OP_INDEX
+        else
+        {
+            index[hash] = value;
+            const int8_t diff = static_cast<int8_t>(value - prev);
+            if (diff >= -2 && diff <= 1)
+            {   // QOI_OP_DIFF
+                const uint8_t d = static_cast<uint8_t>(diff + 2);
+                *dst++ = static_cast<uint8_t>(0x40 | (d << 4) | (d << 2) | d);
+            }
+            else if (diff >= -32 && diff <= 31)
+            {   // QOI_OP_LUMA, red and blue differ from green by zero
+                *dst++ = static_cast<uint8_t>(0x80 | (diff + 32));
+                *dst++ = 0x88;
+            }
+            else
+            {   // QOI_OP_RGB
+                *dst++ = 0xFE;
+                *dst++ = value;
+                *dst++ = value;
+                *dst++ = value;
+            }
+        }
+        prev = value;
+    }
+    const uint8_t padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    memcpy(dst, padding, 8);
+    dst += 8;
+    out.resize(dst - out.data());
+}
+
+void encodePng(const uint8_t *pixels, uint32_t width, uint32_t height, EncodedBuffer& out,
+    PngFilter filter /* PngFilter::Adaptive */, ThreadPool *pool /* nullptr */, uint32_t rowsPerBlock /* 64 */)
+{
+    rowsPerBlock = std::max(rowsPerBlock, 1U);
+    const uint32_t blockCount = (height + rowsPerBlock - 1) / rowsPerBlock;
+    std::vector<PngBlock> blocks(blockCount);
+    auto encodeBlock = [&](uint32_t i, uint32_t /* threadIndex */)
+    {
+        const uint32_t y0 = i * rowsPerBlock;
+        const uint32_t y1 = std::min(y0 + rowsPerBlock, height);
+        encodePngBlock(pixels, width, y0, y1, filter, 0 == i, blocks[i]);
+    };
+    if (pool)
+        pool->parallelFor(blockCount, encodeBlock);
+    else
+    {
+        for (uint32_t i = 0; i < blockCount; ++i)
+            encodeBlock(i, 0);
+    }
+    std::vector<uint8_t> header;
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    header.assign(signature, signature + 8);
+    uint8_t ihdr[13];
+    putBigEndian(ihdr, width);
+    putBigEndian(ihdr + 4, height);
+    ihdr[8] = 8; // Bit depth
+    ihdr[9] = 0; // Grayscale
+    ihdr[10] = 0; // Deflate
+    ihdr[11] = 0; // Adaptive filtering
+    ihdr[12] = 0; // No interlace
+    appendChunk(header, "IHDR", ihdr, sizeof(ihdr));
+    // Final empty block and checksum of the whole stream
+    uint32_t adler = 1;
+    for (const auto& block : blocks)
+        adler = adler32Combine(adler, block.adler, block.filtered.size());
+    uint8_t tail[9] = {0x01, 0x00, 0x00, 0xFF, 0xFF};
+    putBigEndian(tail + 5, adler);
+    std::vector<uint8_t> trailer;
+    appendChunk(trailer, "IDAT", tail, sizeof(tail));
+    appendChunk(trailer, "IEND", nullptr, 0);
+    size_t size = header.size() + trailer.size();
+    for (const auto& block : blocks)
+        size += block.chunk.size();
+    out.resize(size);
+    uint8_t *dst = out.data();
+    memcpy(dst, header.data(), header.size());
+    dst += header.size();
+    for (const auto& block : blocks)
+    {
+        memcpy(dst, block.chunk.data(), block.chunk.size());
+        dst += block.chunk.size();
+    }
+    memcpy(dst, trailer.data(), trailer.size());
+}
+
+void encodeImage(ImageFileFormat format, const uint8_t *pixels, uint32_t width, uint32_t height,
+    EncodedBuffer& out, ThreadPool *pool /* nullptr */)
+{
+    switch (format)
+    {
+    case ImageFileFormat::Pgm: encodePgm(pixels, width, height, out); break;
+    case ImageFileFormat::Qoi: encodeQoi(pixels, width, height, out); break;
+    case ImageFileFormat::Png: encodePng(pixels, width, height, out, PngFilter::Adaptive, pool); break;
+    }
+}
+
+const char *getFileExtension(ImageFileFormat format) noexcept
+{
+    switch (format)
+    {
+    case ImageFileFormat::Pgm: return ".pgm";
+    case ImageFileFormat::Qoi: return ".qoi";
+    case ImageFileFormat::Png: return ".png";
+    default: return "";
+    }
+}
+
+bool parseImageFileFormat(const std::string& name, ImageFileFormat& format) noexcept
+{
+    if ("pgm" == name)
+        format = ImageFileFormat::Pgm;
+    else if ("qoi" == name)
+        format = ImageFileFormat::Qoi;
+    else if ("png" == name)
+        format = ImageFileFormat::Png;
+    else
+        return false;
+    return true;
+}
+
+bool writeFile(const std::string& filename, const EncodedBuffer& data)
+{
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (!file)
+        return false;
+    // Buffer is already large, don't copy it through stdio
+    setvbuf(file, nullptr, _IONBF, 0);
+    const bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return (0 == fclose(file)) && written;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <memory>
+#include "alignedAllocator.h"
+
+class ThreadPool;
+
+enum class ImageFileFormat
+{
+    Pgm, Qoi, Png
+};
+
+enum class PngFilter
+{
+    None, Sub, Up, Adaptive
+};
+
+// Output is sized once and written to one large aligned block: PGM size is exact,
+// QOI reserves worst case and is trimmed, PNG deflates blocks into their own
+// buffers first and concatenates them when the total size is known.
+typedef std::vector<uint8_t, utilities::aligned_allocator<uint8_t>> EncodedBuffer;
+
+// All encoders take 8-bit single-channel image with tightly packed rows
+void encodePgm(const uint8_t *pixels, uint32_t width, uint32_t height, EncodedBuffer& out);
+void encodeQoi(const uint8_t *pixels, uint32_t width, uint32_t height, EncodedBuffer& out);
+// Blocks of rows are filtered and deflated independently, in parallel if pool is provided.
+// Deflate uses fixed Huffman codes with run-length matches, which suits sparse edge images.
+void encodePng(const uint8_t *pixels, uint32_t width, uint32_t height, EncodedBuffer& out,
+    PngFilter filter = PngFilter::Adaptive, ThreadPool *pool = nullptr, uint32_t rowsPerBlock = 64);
+void encodeImage(ImageFileFormat format, const uint8_t *pixels, uint32_t width, uint32_t height,
+    EncodedBuffer& out, ThreadPool *pool = nullptr);
+const char *getFileExtension(ImageFileFormat format) noexcept;
+bool parseImageFileFormat(const std::string& name, ImageFileFormat& format) noexcept;
+// Writes whole buffer with single unbuffered call
+bool writeFile(const std::string& filename, const EncodedBuffer& data);
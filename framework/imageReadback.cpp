@@ -0,0 +1,125 @@
+#include <iostream>
+#include "imageReadback.h"
+
+ImageReadback::ImageReadback(std::shared_ptr<magma::CommandPool> commandPool,
+    std::shared_ptr<magma::Image2D> image,
+    uint32_t slotCount,
+    Consumer consumer,
+    Prologue prologue /* nullptr */):
+    width(image->getMipExtent(0).width),
+    height(image->getMipExtent(0).height),
+    consumer(std::move(consumer)),
+    completed(slotCount)
+{
+    std::shared_ptr<magma::Device> device = commandPool->getDevice();
+    const VkDeviceSize size = VkDeviceSize(width) * height * magma::Format(image->getFormat()).size();
+    for (uint32_t i = 0; i < slotCount; ++i)
+    {
+        std::unique_ptr<Slot> slot(std::make_unique<Slot>());
+        slot->buffer = std::make_shared<magma::DstTransferBuffer>(device, size);
+        // Keep mapped for the whole lifetime
+        slot->pixels = static_cast<const uint8_t *>(slot->buffer->getMemory()->map());
+        slot->fence = std::make_shared<magma::Fence>(device);
+        slot->cmdBuffer = commandPool->allocateCommandBuffer(true);
+        // Source and destination never change, so record once
+        slot->cmdBuffer->begin();
+        {
+            if (prologue)
+                prologue(slot->cmdBuffer);
+            // Wait for previous submissions that render to image
+            slot->cmdBuffer->pipelineBarrier(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                magma::MemoryBarrier(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT));
+            VkBufferImageCopy region;
+            region.bufferOffset = 0;
+            region.bufferRowLength = 0; // Tightly packed
+            region.bufferImageHeight = 0;
+            region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {width, height, 1};
+            slot->cmdBuffer->copyImageToBuffer(image, slot->buffer, region);
+            slot->cmdBuffer->pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                magma::MemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT));
+        }
+        slot->cmdBuffer->end();
+        slots.push_back(std::move(slot));
+    }
+    consumerThread = std::thread(&ImageReadback::consume, this);
+    timer.run();
+}
+
+ImageReadback::~ImageReadback()
+{
+    flush();
+    completed.close();
+    consumerThread.join();
+    for (auto& slot : slots)
+        slot->buffer->getMemory()->unmap();
+}
+
+bool ImageReadback::acquire(uint64_t frame,
+    std::shared_ptr<magma::CommandBuffer>& cmdBuffer,
+    std::shared_ptr<magma::Fence>& fence)
+{
+    Slot *slot = slots[next].get();
+    if (slot->state != Free)
+    {   // Consumer is behind, skip this frame instead of waiting
+        ++framesDropped;
+        return false;
+    }
+    next = (next + 1) % static_cast<uint32_t>(slots.size());
+    slot->frame = frame;
+    slot->fence->reset();
+    slot->state = Pending;
+    cmdBuffer = slot->cmdBuffer;
+    fence = slot->fence;
+    ++framesAcquired;
+    return true;
+}
+
+void ImageReadback::poll()
+{
+    for (auto& slot : slots)
+    {
+        if (Pending == slot->state && VK_SUCCESS == slot->fence->getStatus())
+        {
+            slot->state = Consuming;
+            completed.push(slot.get());
+        }
+    }
+}
+
+void ImageReadback::flush()
+{
+    for (auto& slot : slots)
+    {   // Don't destroy buffers that are still in flight
+        if (Pending == slot->state)
+            slot->fence->wait();
+    }
+    poll();
+    for (auto& slot : slots)
+    {
+        while (slot->state != Free)
+            std::this_thread::yield();
+    }
+}
+
+void ImageReadback::printStatistics()
+{
+    const float seconds = timer.secondsElapsed();
+    const uint64_t bytes = framesConsumed * width * height;
+    std::cout << "Read back " << framesConsumed << " of " << framesAcquired + framesDropped
+        << " frames (" << framesDropped << " skipped), "
+        << framesConsumed / seconds << " fps, "
+        << bytes / (seconds * 1024.f * 1024.f) << " MB/s\n";
+}
+
+void ImageReadback::consume()
+{
+    Slot *slot;
+    while (completed.pop(slot))
+    {
+        consumer(slot->frame, slot->pixels, width, height);
+        ++framesConsumed;
+        slot->state = Free;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include "boundedQueue.h"
+#include "timer.h"
+#include "../magma/magma.h"
+
+// Copies rendered image into one of a ring of host-visible buffers.
+// Slot is handed to consumer thread when its fence is signaled, consumer
+// reads mapped memory in place and then the slot returns to the ring.
+// If all slots are busy the frame is skipped, so render loop never stalls.
+class ImageReadback : public NonCopyable
+{
+public:
+    typedef std::function<void(uint64_t frame, const uint8_t *pixels, uint32_t width, uint32_t height)> Consumer;
+    typedef std::function<void(std::shared_ptr<magma::CommandBuffer> cmdBuffer)> Prologue;
+
+    // Prologue records commands that produce image before the copy
+    ImageReadback(std::shared_ptr<magma::CommandPool> commandPool,
+        std::shared_ptr<magma::Image2D> image,
+        uint32_t slotCount,
+        Consumer consumer,
+        Prologue prologue = nullptr);
+    ~ImageReadback();
+    // Returns copy command buffer and fence to submit, or false if ring is full
+    bool acquire(uint64_t frame,
+        std::shared_ptr<magma::CommandBuffer>& cmdBuffer,
+        std::shared_ptr<magma::Fence>& fence);
+    // Dispatches completed copies to consumer thread
+    void poll();
+    // Waits until all copies in flight are consumed
+    void flush();
+    void printStatistics();
+
+private:
+    enum SlotState : uint32_t { Free, Pending, Consuming };
+
+    struct Slot
+    {
+        std::shared_ptr<magma::DstTransferBuffer> buffer;
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer;
+        std::shared_ptr<magma::Fence> fence;
+        const uint8_t *pixels = nullptr;
+        uint64_t frame = 0;
+        std::atomic<uint32_t> state{Free};
+    };
+
+    void consume();
+
+    const uint32_t width;
+    const uint32_t height;
+    std::vector<std::unique_ptr<Slot>> slots;
+    uint32_t next = 0;
+    Consumer consumer;
+    BoundedQueue<Slot *> completed;
+    std::thread consumerThread;
+    uint64_t framesAcquired = 0;
+    uint64_t framesDropped = 0;
+    std::atomic<uint64_t> framesConsumed{0};
+    Timer timer;
+};
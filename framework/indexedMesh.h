@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "../rapid/rapid.h"
+#include "alignedAllocator.h"
+
+// Vertex arrays of tessellated meshes are large enough to be page-mapped
+template<typename Type>
+using VertexStream = std::vector<Type, utilities::aligned_allocator<Type, utilities::cacheLineSize>>;
+
+// CPU-side triangle list with separate attribute streams,
+// used to process geometry before it is uploaded to the GPU.
+struct IndexedMesh
+{
+    VertexStream<rapid::float3> positions;
+    VertexStream<rapid::float3> normals;
+    VertexStream<rapid::float2> texCoords;
+    std::vector<uint32_t> indices;
+
+    uint32_t getVertexCount() const noexcept { return static_cast<uint32_t>(positions.size()); }
+    uint32_t getTriangleCount() const noexcept { return static_cast<uint32_t>(indices.size() / 3); }
+    uint64_t getMemorySize() const noexcept
+    {
+        return positions.size() * sizeof(rapid::float3) +
+            normals.size() * sizeof(rapid::float3) +
+            texCoords.size() * sizeof(rapid::float2) +
+            indices.size() * sizeof(uint32_t);
+    }
+};
@@ -0,0 +1,49 @@
+#include "instanceBuffer.h"
+#include "../magma/magma.h"
+
+// Written by CPU every frame, read by vertex input
+class HostVertexBuffer : public magma::Buffer
+{
+public:
+    HostVertexBuffer(std::shared_ptr<magma::Device> device, VkDeviceSize size):
+        magma::Buffer(device, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 0,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+    {}
+};
+
+InstanceBuffer::InstanceBuffer(std::shared_ptr<magma::Device> device, uint32_t maxInstances):
+    maxInstances(maxInstances)
+{
+    buffer = std::make_shared<HostVertexBuffer>(device, maxInstances * sizeof(InstancedScene::Transform));
+    transforms = static_cast<InstancedScene::Transform *>(buffer->getMemory()->map());
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    buffer->getMemory()->unmap();
+}
+
+void InstanceBuffer::bind(magma::CommandBuffer& cmdBuffer) const
+{
+    cmdBuffer.bindVertexBuffer(binding, buffer);
+}
+
+const magma::VertexInputState& InstanceBuffer::getVertexInput()
+{
+    static const magma::VertexInputState vertexInput(
+    {
+        magma::VertexInputBinding(0, sizeof(float) * 3), // Position
+        magma::VertexInputBinding(1, sizeof(float) * 3), // Normal
+        magma::VertexInputBinding(2, sizeof(float) * 2), // TexCoord
+        magma::VertexInputBinding(binding, sizeof(InstancedScene::Transform), VK_VERTEX_INPUT_RATE_INSTANCE)
+    },
+    {
+        magma::VertexInputAttribute(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0),
+        magma::VertexInputAttribute(1, 1, VK_FORMAT_R32G32B32_SFLOAT, 0),
+        magma::VertexInputAttribute(2, 2, VK_FORMAT_R32G32_SFLOAT, 0),
+        magma::VertexInputAttribute(binding, 3, VK_FORMAT_R32G32B32A32_SFLOAT, 0),
+        magma::VertexInputAttribute(binding, 4, VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(float) * 4),
+        magma::VertexInputAttribute(binding, 5, VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(float) * 8)
+    });
+    return vertexInput;
+}
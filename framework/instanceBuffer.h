@@ -0,0 +1,33 @@
+#pragma once
+#include "instancedScene.h"
+#include "nonCopyable.h"
+
+namespace magma
+{
+    class Device;
+    class Buffer;
+    class CommandBuffer;
+    class VertexInputState;
+}
+
+// Host-visible vertex buffer with per-instance transforms. It stays mapped,
+// so InstancedScene::update() writes into it directly without staging copy.
+class InstanceBuffer : public NonCopyable
+{
+public:
+    // Binding that follows position, normal and texcoord streams
+    static constexpr uint32_t binding = 3;
+
+    InstanceBuffer(std::shared_ptr<magma::Device> device, uint32_t maxInstances);
+    ~InstanceBuffer();
+    InstancedScene::Transform *getTransforms() noexcept { return transforms; }
+    uint32_t getMaxInstances() const noexcept { return maxInstances; }
+    void bind(magma::CommandBuffer& cmdBuffer) const;
+    // Float streams of BezierPatchMesh/StaticMesh plus per-instance transform
+    static const magma::VertexInputState& getVertexInput();
+
+private:
+    const uint32_t maxInstances;
+    std::shared_ptr<magma::Buffer> buffer;
+    InstancedScene::Transform *transforms;
+};
@@ -0,0 +1,97 @@
+#include <cmath>
+#include <emmintrin.h>
+#include "instancedScene.h"
+
+static constexpr float pi = 3.14159265f;
+static constexpr float twoPi = 6.28318531f;
+
+static void push(std::vector<float, utilities::aligned_allocator<float>>& stream, float value, uint32_t count)
+{   // Keep stream padded, unused lanes are computed but not written
+    if (stream.size() < ((count + 4) & ~3))
+        stream.resize((count + 4) & ~3, 0.f);
+    stream[count] = value;
+}
+
+static float wrapAngle(float x) noexcept
+{
+    return x - twoPi * std::floor((x + pi) / twoPi);
+}
+
+uint32_t InstancedScene::addInstance(float x, float y, float z, float scale, float angle, float angularSpeed)
+{
+    push(positionX, x, count);
+    push(positionY, y, count);
+    push(positionZ, z, count);
+    push(this->scale, scale, count);
+    push(this->angle, wrapAngle(angle), count);
+    push(this->angularSpeed, angularSpeed, count);
+    return count++;
+}
+
+static __m128 wrapAngle(__m128 x) noexcept
+{   // x - 2pi * floor((x + pi) / 2pi), angles change little per frame
+    const __m128 t = _mm_mul_ps(_mm_add_ps(x, _mm_set1_ps(pi)), _mm_set1_ps(1.f / twoPi));
+    __m128 f = _mm_cvtepi32_ps(_mm_cvttps_epi32(t));
+    f = _mm_sub_ps(f, _mm_and_ps(_mm_cmplt_ps(t, f), _mm_set1_ps(1.f))); // Truncation to floor
+    return _mm_sub_ps(x, _mm_mul_ps(f, _mm_set1_ps(twoPi)));
+}
+
+static __m128 sinReduced(__m128 x) noexcept
+{   // Minimax polynomial on [-pi/2, pi/2], error is about 1e-6
+    const __m128 x2 = _mm_mul_ps(x, x);
+    __m128 p = _mm_set1_ps(-2.39e-8f);
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(2.7526e-6f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.98409e-4f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(8.3333315e-3f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.6666666e-1f));
+    return _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(p, x2), x));
+}
+
+static __m128 foldAngle(__m128 x) noexcept
+{   // sin(x) = sin(sign(x) * pi - x), maps [-pi, pi] to [-pi/2, pi/2]
+    const __m128 signMask = _mm_set1_ps(-0.f);
+    const __m128 sign = _mm_and_ps(x, signMask);
+    const __m128 absX = _mm_andnot_ps(signMask, x);
+    const __m128 folded = _mm_or_ps(_mm_sub_ps(_mm_set1_ps(pi), absX), sign);
+    const __m128 outside = _mm_cmpgt_ps(absX, _mm_set1_ps(pi * .5f));
+    return _mm_or_ps(_mm_and_ps(outside, folded), _mm_andnot_ps(outside, x));
+}
+
+static void sinCos(__m128 x, __m128& s, __m128& c) noexcept
+{   // x is in [-pi, pi)
+    s = sinReduced(foldAngle(x));
+    c = sinReduced(foldAngle(wrapAngle(_mm_add_ps(x, _mm_set1_ps(pi * .5f)))));
+}
+
+void InstancedScene::update(float dt, Transform *transforms)
+{
+    const __m128 delta = _mm_set1_ps(dt);
+    const __m128 zero = _mm_setzero_ps();
+    for (uint32_t i = 0; i < count; i += 4)
+    {
+        __m128 a = _mm_add_ps(_mm_load_ps(&angle[i]), _mm_mul_ps(_mm_load_ps(&angularSpeed[i]), delta));
+        a = wrapAngle(a);
+        _mm_store_ps(&angle[i], a);
+        __m128 sinA, cosA;
+        sinCos(a, sinA, cosA);
+        const __m128 s = _mm_load_ps(&scale[i]);
+        const __m128 sc = _mm_mul_ps(s, cosA);
+        const __m128 ss = _mm_mul_ps(s, sinA);
+        // world = scaling * rotationY * translation for row vectors, transposed
+        __m128 row0[4] = {sc, zero, ss, _mm_load_ps(&positionX[i])};
+        __m128 row1[4] = {zero, s, zero, _mm_load_ps(&positionY[i])};
+        __m128 row2[4] = {_mm_sub_ps(zero, ss), zero, sc, _mm_load_ps(&positionZ[i])};
+        // SoA to AoS, after transpose each register is a row of one instance
+        _MM_TRANSPOSE4_PS(row0[0], row0[1], row0[2], row0[3]);
+        _MM_TRANSPOSE4_PS(row1[0], row1[1], row1[2], row1[3]);
+        _MM_TRANSPOSE4_PS(row2[0], row2[1], row2[2], row2[3]);
+        const uint32_t lanes = count - i < 4 ? count - i : 4;
+        for (uint32_t lane = 0; lane < lanes; ++lane)
+        {   // Destination may be write-combined mapped memory, so write it sequentially
+            float *dst = transforms[i + lane].rows[0];
+            _mm_storeu_ps(dst, row0[lane]);
+            _mm_storeu_ps(dst + 4, row1[lane]);
+            _mm_storeu_ps(dst + 8, row2[lane]);
+        }
+    }
+}
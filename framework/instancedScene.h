@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "alignedAllocator.h"
+
+// Copies of one mesh, each spinning around its own vertical axis.
+// Instance state is kept in SoA streams padded to multiple of four,
+// and world matrices are computed for four instances at once.
+class InstancedScene
+{
+public:
+    // Rows of transposed affine world matrix, so that
+    // world position is (dot(row0, p), dot(row1, p), dot(row2, p))
+    struct Transform
+    {
+        float rows[3][4];
+    };
+
+    uint32_t addInstance(float x, float y, float z, float scale, float angle, float angularSpeed);
+    uint32_t getInstanceCount() const noexcept { return count; }
+    // Advances rotation by dt seconds and writes transform of every instance
+    void update(float dt, Transform *transforms);
+
+private:
+    typedef std::vector<float, utilities::aligned_allocator<float>> Stream;
+
+    uint32_t count = 0;
+    Stream positionX, positionY, positionZ;
+    Stream scale;
+    Stream angle; // Kept in [-pi, pi)
+    Stream angularSpeed;
+};
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <stdexcept>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "mappedFile.h"
+
+MappedFile::MappedFile(const std::string& filename, Access access):
+    access(access)
+{
+#ifdef _WIN32
+    const DWORD desiredAccess = (Access::ReadOnly == access) ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE;
+    file = CreateFileA(filename.c_str(), desiredAccess, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (INVALID_HANDLE_VALUE == file)
+        file = nullptr;
+    LARGE_INTEGER fileSize;
+    if (file && GetFileSizeEx(file, &fileSize))
+        length = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+    fd = open(filename.c_str(), (Access::ReadOnly == access) ? O_RDONLY : O_RDWR);
+    struct stat st;
+    if (fd >= 0 && 0 == fstat(fd, &st))
+        length = static_cast<uint64_t>(st.st_size);
+#endif
+    map(filename);
+}
+
+MappedFile::MappedFile(const std::string& filename, uint64_t size):
+    access(Access::ReadWrite),
+    length(size)
+{
+#ifdef _WIN32
+    file = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (INVALID_HANDLE_VALUE == file)
+        file = nullptr;
+#else
+    fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0 && ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+#endif
+    map(filename);
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (ptr)
+        UnmapViewOfFile(ptr);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+#else
+    if (ptr)
+        munmap(ptr, length);
+    if (fd >= 0)
+        close(fd);
+#endif
+}
+
+void MappedFile::advise(uint64_t offset, uint64_t size, Advice advice) const noexcept
+{
+#ifdef _WIN32
+    if (Advice::WillNeed == advice)
+    {
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = static_cast<uint8_t *>(ptr) + offset;
+        range.NumberOfBytes = static_cast<SIZE_T>(size);
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+    else if (Advice::DontNeed == advice)
+    {   // Trim pages from working set, they are still backed by file
+        VirtualUnlock(static_cast<uint8_t *>(ptr) + offset, static_cast<SIZE_T>(size));
+    }
+#else
+    // Address passed to madvise() should be page aligned
+    const uint64_t pageSize = getPageSize();
+    const uint64_t begin = (offset + pageSize - 1) & ~(pageSize - 1);
+    const uint64_t end = std::min(offset + size, length) & ~(pageSize - 1);
+    if (begin >= end)
+        return;
+    int flag;
+    switch (advice)
+    {
+    case Advice::Sequential: flag = MADV_SEQUENTIAL; break;
+    case Advice::Random: flag = MADV_RANDOM; break;
+    case Advice::WillNeed: flag = MADV_WILLNEED; break;
+    case Advice::DontNeed: flag = MADV_DONTNEED; break;
+    default: flag = MADV_NORMAL;
+    }
+    madvise(static_cast<uint8_t *>(ptr) + begin, end - begin, flag);
+#endif
+}
+
+void MappedFile::flush(uint64_t offset, uint64_t size) const
+{
+    if (!writable())
+        return;
+#ifdef _WIN32
+    FlushViewOfFile(static_cast<uint8_t *>(ptr) + offset, static_cast<SIZE_T>(size));
+#else
+    const uint64_t pageSize = getPageSize();
+    const uint64_t begin = offset & ~(pageSize - 1);
+    const uint64_t end = std::min(offset + size, length);
+    if (msync(static_cast<uint8_t *>(ptr) + begin, end - begin, MS_ASYNC) != 0)
+        throw std::runtime_error("failed to flush mapped file");
+#endif
+}
+
+uint64_t MappedFile::getPageSize() noexcept
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+void MappedFile::map(const std::string& filename)
+{
+#ifdef _WIN32
+    if (file && length)
+    {
+        const LARGE_INTEGER size = {{static_cast<DWORD>(length), static_cast<LONG>(length >> 32)}};
+        mapping = CreateFileMappingA(file, NULL, writable() ? PAGE_READWRITE : PAGE_READONLY,
+            size.HighPart, size.LowPart, NULL);
+        if (mapping)
+            ptr = MapViewOfFile(mapping, writable() ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    }
+#else
+    if (fd >= 0 && length)
+    {
+        ptr = mmap(nullptr, length, writable() ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (MAP_FAILED == ptr)
+            ptr = nullptr;
+    }
+#endif
+    if (!ptr)
+    {   // Destructor will not be called
+#ifdef _WIN32
+        if (mapping)
+            CloseHandle(mapping);
+        if (file)
+            CloseHandle(file);
+#else
+        if (fd >= 0)
+            close(fd);
+#endif
+        const std::string msg = "failed to map file \"" + filename + "\"";
+        throw std::runtime_error(msg.c_str());
+    }
+}
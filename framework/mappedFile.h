@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "nonCopyable.h"
+
+// Maps whole file into address space. Pages are loaded on demand by OS,
+// so resident memory depends on access pattern rather than file size.
+class MappedFile : public NonCopyable
+{
+public:
+    enum class Access { ReadOnly, ReadWrite };
+    enum class Advice { Normal, Sequential, Random, WillNeed, DontNeed };
+
+    // Opens existing file
+    MappedFile(const std::string& filename, Access access);
+    // Creates new file of given size
+    MappedFile(const std::string& filename, uint64_t size);
+    ~MappedFile();
+    uint8_t *data() noexcept { return static_cast<uint8_t *>(ptr); }
+    const uint8_t *data() const noexcept { return static_cast<const uint8_t *>(ptr); }
+    uint64_t size() const noexcept { return length; }
+    bool writable() const noexcept { return Access::ReadWrite == access; }
+    void advise(uint64_t offset, uint64_t size, Advice advice) const noexcept;
+    void flush(uint64_t offset, uint64_t size) const;
+    static uint64_t getPageSize() noexcept;
+
+private:
+    void map(const std::string& filename);
+
+    Access access;
+    uint64_t length = 0;
+    void *ptr = nullptr;
+#ifdef _WIN32
+    void *file = nullptr;
+    void *mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
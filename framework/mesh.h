@@ -1,9 +1,11 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include "nonCopyable.h"
 
 namespace magma
 {
+    class Device;
     class CommandBuffer;
     class VertexBuffer;
     class IndexBuffer;
@@ -14,6 +16,22 @@ namespace magma
 class Mesh : public NonCopyable
 {
 public:
-    virtual void draw(std::shared_ptr<magma::CommandBuffer> cmdBuffer) const = 0;
+    // Recording takes command buffer by reference, shared ownership is only needed at creation
+    virtual void draw(magma::CommandBuffer& cmdBuffer) const = 0;
+    void draw(const std::shared_ptr<magma::CommandBuffer>& cmdBuffer) const { draw(*cmdBuffer); }
+    // Number of draw calls recorded by draw()
+    virtual uint32_t getDrawCount() const noexcept { return 1; }
+    // Records draws [firstDraw, firstDraw + drawCount), so that list can be split between threads
+    virtual void draw(magma::CommandBuffer& cmdBuffer, uint32_t firstDraw, uint32_t drawCount) const
+    {
+        if (0 == firstDraw && drawCount > 0)
+            draw(cmdBuffer);
+    }
     virtual const magma::VertexInputState& getVertexInput() const = 0;
+    // Number of copies drawn, per-instance data is bound by the caller
+    void setInstanceCount(uint32_t count) noexcept { instanceCount = count; }
+    uint32_t getInstanceCount() const noexcept { return instanceCount; }
+
+protected:
+    uint32_t instanceCount = 1;
 };
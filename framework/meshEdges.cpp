@@ -0,0 +1,137 @@
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <emmintrin.h>
+#include "meshEdges.h"
+
+struct Plane
+{
+    float x, y, z, d;
+};
+
+static Plane facePlane(const rapid::float3& a, const rapid::float3& b, const rapid::float3& c) noexcept
+{   // Clockwise front face has outward normal (c - a) x (b - a)
+    const float e0[3] = {c.x - a.x, c.y - a.y, c.z - a.z};
+    const float e1[3] = {b.x - a.x, b.y - a.y, b.z - a.z};
+    Plane plane;
+    plane.x = e0[1] * e1[2] - e0[2] * e1[1];
+    plane.y = e0[2] * e1[0] - e0[0] * e1[2];
+    plane.z = e0[0] * e1[1] - e0[1] * e1[0];
+    const float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    if (length > 0.f)
+    {
+        plane.x /= length;
+        plane.y /= length;
+        plane.z /= length;
+    }
+    plane.d = plane.x * a.x + plane.y * a.y + plane.z * a.z;
+    return plane;
+}
+
+MeshEdges::MeshEdges(const IndexedMesh& mesh, float creaseAngleDegrees /* 45.f */):
+    positions(mesh.positions)
+{
+    struct Edge
+    {
+        uint32_t faces[2];
+        uint32_t faceCount;
+    };
+
+    const uint32_t faceCount = mesh.getTriangleCount();
+    std::vector<Plane> planes(faceCount);
+    std::vector<Edge> edges;
+    std::unordered_map<uint64_t, uint32_t> edgeMap;
+    edgeMap.reserve(faceCount * 3 / 2);
+    for (uint32_t f = 0; f < faceCount; ++f)
+    {
+        const uint32_t *face = &mesh.indices[f * 3];
+        planes[f] = facePlane(positions[face[0]], positions[face[1]], positions[face[2]]);
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            const uint32_t a = face[i], b = face[(i + 1) % 3];
+            const uint64_t key = (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+            auto it = edgeMap.find(key);
+            if (it == edgeMap.end())
+            {
+                edgeMap.emplace(key, static_cast<uint32_t>(edges.size()));
+                edges.push_back(Edge{{f, f}, 1});
+                vertices.push_back(a);
+                vertices.push_back(b);
+            }
+            else
+            {
+                Edge& edge = edges[it->second];
+                if (1 == edge.faceCount)
+                    edge.faces[1] = f;
+                ++edge.faceCount;
+            }
+        }
+    }
+    count = static_cast<uint32_t>(edges.size());
+    // Padding edges have both faces back-facing and are never visible
+    const size_t paddedCount = (count + 3) & ~3;
+    for (Stream *stream : {&normal0X, &normal0Y, &normal0Z, &normal1X, &normal1Y, &normal1Z})
+        stream->resize(paddedCount, 0.f);
+    distance0.resize(paddedCount, 1.f);
+    distance1.resize(paddedCount, 1.f);
+    crease.resize(paddedCount, 0);
+    const float cosCrease = std::cos(creaseAngleDegrees * 3.14159265f / 180.f);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const Edge& edge = edges[i];
+        const Plane& p0 = planes[edge.faces[0]];
+        const Plane& p1 = planes[edge.faces[1]];
+        normal0X[i] = p0.x; normal0Y[i] = p0.y; normal0Z[i] = p0.z; distance0[i] = p0.d;
+        normal1X[i] = p1.x; normal1Y[i] = p1.y; normal1Z[i] = p1.z; distance1[i] = p1.d;
+        const float cosAngle = p0.x * p1.x + p0.y * p1.y + p0.z * p1.z;
+        if (edge.faceCount != 2 || cosAngle < cosCrease)
+            crease[i] = 0xFFFFFFFF;
+    }
+}
+
+static int popCount4(int mask) noexcept
+{
+    return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+}
+
+uint32_t MeshEdges::extract(const float eye[3], rapid::float3 *lines, EdgeStats *stats /* nullptr */) const
+{
+    const __m128 eyeX = _mm_set1_ps(eye[0]);
+    const __m128 eyeY = _mm_set1_ps(eye[1]);
+    const __m128 eyeZ = _mm_set1_ps(eye[2]);
+    const __m128 zero = _mm_setzero_ps();
+    uint32_t lineCount = 0;
+    uint32_t silhouetteCount = 0;
+    for (uint32_t i = 0; i < count; i += 4)
+    {
+        __m128 side0 = _mm_mul_ps(_mm_load_ps(&normal0X[i]), eyeX);
+        side0 = _mm_add_ps(side0, _mm_mul_ps(_mm_load_ps(&normal0Y[i]), eyeY));
+        side0 = _mm_add_ps(side0, _mm_mul_ps(_mm_load_ps(&normal0Z[i]), eyeZ));
+        __m128 side1 = _mm_mul_ps(_mm_load_ps(&normal1X[i]), eyeX);
+        side1 = _mm_add_ps(side1, _mm_mul_ps(_mm_load_ps(&normal1Y[i]), eyeY));
+        side1 = _mm_add_ps(side1, _mm_mul_ps(_mm_load_ps(&normal1Z[i]), eyeZ));
+        const __m128 front0 = _mm_cmpgt_ps(_mm_sub_ps(side0, _mm_load_ps(&distance0[i])), zero);
+        const __m128 front1 = _mm_cmpgt_ps(_mm_sub_ps(side1, _mm_load_ps(&distance1[i])), zero);
+        const __m128 silhouette = _mm_xor_ps(front0, front1);
+        const __m128 creaseMask = _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i *>(&crease[i])));
+        const __m128 visibleCrease = _mm_and_ps(creaseMask, _mm_or_ps(front0, front1));
+        int visible = _mm_movemask_ps(_mm_or_ps(silhouette, visibleCrease));
+        silhouetteCount += popCount4(_mm_movemask_ps(silhouette));
+        while (visible)
+        {   // Append visible edges in order
+            const uint32_t lane = visible & 1 ? 0 : visible & 2 ? 1 : visible & 4 ? 2 : 3;
+            visible &= visible - 1;
+            const uint32_t *edge = &vertices[(i + lane) * 2];
+            *lines++ = positions[edge[0]];
+            *lines++ = positions[edge[1]];
+            ++lineCount;
+        }
+    }
+    if (stats)
+    {
+        stats->edgeCount += count;
+        stats->silhouetteEdges += silhouetteCount;
+        stats->creaseEdges += lineCount - silhouetteCount;
+    }
+    return lineCount;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "alignedAllocator.h"
+#include "indexedMesh.h"
+
+struct EdgeStats
+{
+    uint32_t edgeCount = 0;
+    uint32_t silhouetteEdges = 0;
+    uint32_t creaseEdges = 0;
+};
+
+// Edge-face adjacency of welded triangle mesh. For every edge the planes of
+// its two faces are kept in SoA streams, so that per-frame classification
+// tests four edges at once. Edge is silhouette if one of its faces is
+// front-facing and the other is not. Crease edges, which dihedral angle exceeds
+// threshold, as well as boundary and non-manifold ones are drawn if any
+// of their faces is front-facing.
+class MeshEdges
+{
+public:
+    // Triangles are expected to be clockwise when front-facing. Vertices on shared
+    // borders have to be welded, otherwise every patch border is a boundary.
+    MeshEdges(const IndexedMesh& mesh, float creaseAngleDegrees = 45.f);
+    uint32_t getEdgeCount() const noexcept { return count; }
+    // Writes two positions per visible edge, returns number of edges.
+    // Eye position is in object space of the mesh.
+    uint32_t extract(const float eye[3], rapid::float3 *lines, EdgeStats *stats = nullptr) const;
+
+private:
+    typedef std::vector<float, utilities::aligned_allocator<float>> Stream;
+    typedef std::vector<uint32_t, utilities::aligned_allocator<uint32_t>> MaskStream;
+
+    uint32_t count = 0;
+    VertexStream<rapid::float3> positions;
+    std::vector<uint32_t> vertices; // Pair per edge
+    // Face is front-facing if dot(normal, eye) > distance
+    Stream normal0X, normal0Y, normal0Z, distance0;
+    Stream normal1X, normal1Y, normal1Z, distance1;
+    MaskStream crease; // All bits set if crease, boundary or non-manifold
+};
@@ -0,0 +1,242 @@
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include "meshOptimizer.h"
+
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount, uint32_t vertexCount,
+    uint32_t cacheSize /* 16 */)
+{
+    VertexCacheStats stats;
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    uint32_t uniqueVertices = 0;
+    uint32_t time = cacheSize + 1;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        const uint32_t v = indices[i];
+        assert(v < vertexCount);
+        if (time - timestamps[v] > cacheSize)
+        {   // Vertex was pushed out by at least cacheSize newer ones
+            timestamps[v] = time++;
+            ++stats.transformedVertices;
+        }
+        if (!used[v])
+        {
+            used[v] = true;
+            ++uniqueVertices;
+        }
+    }
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount)
+        stats.acmr = stats.transformedVertices / (float)triangleCount;
+    if (uniqueVertices)
+        stats.atvr = stats.transformedVertices / (float)uniqueVertices;
+    return stats;
+}
+
+static float vertexScore(int32_t cachePosition, uint32_t activeTriangles, uint32_t cacheSize)
+{
+    constexpr float lastTriangleScore = 0.75f;
+    constexpr float cacheDecayPower = 1.5f;
+    constexpr float valenceBoostScale = 2.f;
+    constexpr float valenceBoostPower = 0.5f;
+    if (0 == activeTriangles)
+        return -1.f; // No triangles need this vertex
+    float score = 0.f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {   // Used by the last triangle, fixed score to discourage
+            // emitting the same triangle strip direction again
+            score = lastTriangleScore;
+        }
+        else
+        {
+            const float scaler = 1.f / (cacheSize - 3);
+            score = std::pow(1.f - (cachePosition - 3) * scaler, cacheDecayPower);
+        }
+    }
+    // Prefer vertices with few triangles left, so that they will not be left alone
+    score += valenceBoostScale * std::pow(static_cast<float>(activeTriangles), -valenceBoostPower);
+    return score;
+}
+
+void optimizeVertexCache(uint32_t *indices, size_t indexCount, uint32_t vertexCount,
+    uint32_t cacheSize /* 32 */)
+{
+    assert(cacheSize > 3);
+    const uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+    if (!triangleCount)
+        return;
+    // Build vertex to triangle adjacency, active triangles of each vertex are kept at front
+    std::vector<uint32_t> activeCount(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        ++activeCount[indices[i]];
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + activeCount[v];
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        for (uint32_t k = 0; k < 3; ++k)
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+    }
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+        vertexScores[v] = vertexScore(-1, activeCount[v], cacheSize);
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        const uint32_t *tri = indices + t * 3;
+        triangleScores[t] = vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+    }
+    std::vector<uint32_t> cache, newCache;
+    cache.reserve(cacheSize + 3);
+    newCache.reserve(cacheSize + 3);
+    std::vector<uint32_t> output(triangleCount * 3);
+    uint32_t bestTriangle = UINT32_MAX;
+    for (uint32_t n = 0; n < triangleCount; ++n)
+    {
+        if (UINT32_MAX == bestTriangle)
+        {   // Nothing in cache has triangles left, start from the best one overall
+            float bestScore = -1.f;
+            for (uint32_t t = 0; t < triangleCount; ++t)
+            {
+                if (!emitted[t] && triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+        const uint32_t *tri = indices + bestTriangle * 3;
+        std::copy(tri, tri + 3, output.begin() + n * 3);
+        emitted[bestTriangle] = true;
+        newCache.clear();
+        for (uint32_t k = 0; k < 3; ++k)
+        {   // Remove emitted triangle from active ones
+            const uint32_t v = tri[k];
+            uint32_t *first = adjacency.data() + offsets[v];
+            uint32_t *last = first + activeCount[v];
+            uint32_t *it = std::find(first, last, bestTriangle);
+            assert(it != last);
+            std::swap(*it, *(last - 1));
+            --activeCount[v];
+            if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+                newCache.push_back(v);
+        }
+        for (uint32_t v : cache)
+        {
+            if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+                newCache.push_back(v);
+        }
+        // Vertices past the cache size are dropped, their scores updated too
+        for (uint32_t i = 0; i < newCache.size(); ++i)
+        {
+            const uint32_t v = newCache[i];
+            cachePosition[v] = i < cacheSize ? static_cast<int32_t>(i) : -1;
+            vertexScores[v] = vertexScore(cachePosition[v], activeCount[v], cacheSize);
+        }
+        bestTriangle = UINT32_MAX;
+        float bestScore = -1.f;
+        for (uint32_t v : newCache)
+        {
+            for (uint32_t i = offsets[v], end = offsets[v] + activeCount[v]; i < end; ++i)
+            {
+                const uint32_t t = adjacency[i];
+                const uint32_t *adj = indices + t * 3;
+                const float score = vertexScores[adj[0]] + vertexScores[adj[1]] + vertexScores[adj[2]];
+                triangleScores[t] = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+        if (newCache.size() > cacheSize)
+            newCache.resize(cacheSize);
+        std::swap(cache, newCache);
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+template<typename Stream>
+static void remapVertices(Stream& attributes, const std::vector<uint32_t>& remap, uint32_t vertexCount)
+{
+    if (attributes.empty())
+        return;
+    Stream reordered(vertexCount);
+    for (size_t i = 0; i < remap.size(); ++i)
+    {
+        if (remap[i] != UINT32_MAX)
+            reordered[remap[i]] = attributes[i];
+    }
+    attributes.swap(reordered);
+}
+
+uint32_t optimizeVertexFetch(IndexedMesh& mesh)
+{
+    std::vector<uint32_t> remap(mesh.getVertexCount(), UINT32_MAX);
+    uint32_t vertexCount = 0;
+    for (uint32_t& index : mesh.indices)
+    {
+        if (UINT32_MAX == remap[index])
+            remap[index] = vertexCount++;
+        index = remap[index];
+    }
+    remapVertices(mesh.positions, remap, vertexCount);
+    remapVertices(mesh.normals, remap, vertexCount);
+    remapVertices(mesh.texCoords, remap, vertexCount);
+    return vertexCount;
+}
+
+MeshletList buildMeshlets(const uint32_t *indices, size_t indexCount, uint32_t vertexCount,
+    uint32_t maxVertices /* 64 */, uint32_t maxTriangles /* 124 */)
+{
+    assert(maxVertices >= 3 && maxVertices < 256);
+    assert(maxTriangles >= 1);
+    MeshletList list;
+    std::vector<uint8_t> localIndex(vertexCount, 0xFF);
+    Meshlet meshlet = {0, 0, 0, 0};
+    auto finish = [&]()
+    {
+        for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+            localIndex[list.vertices[meshlet.vertexOffset + i]] = 0xFF;
+        list.meshlets.push_back(meshlet);
+        meshlet.vertexOffset += meshlet.vertexCount;
+        meshlet.triangleOffset += meshlet.triangleCount;
+        meshlet.vertexCount = 0;
+        meshlet.triangleCount = 0;
+    };
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        const uint32_t *tri = indices + i;
+        uint32_t newVertices = 0;
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            if (0xFF == localIndex[tri[k]] &&
+                (k < 1 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1]))
+                ++newVertices;
+        }
+        if (meshlet.vertexCount + newVertices > maxVertices || meshlet.triangleCount >= maxTriangles)
+            finish();
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint32_t v = tri[k];
+            if (0xFF == localIndex[v])
+            {   // 0xFF is never valid local index as vertex count is less than 256
+                localIndex[v] = static_cast<uint8_t>(meshlet.vertexCount++);
+                list.vertices.push_back(v);
+            }
+            list.triangles.push_back(localIndex[v]);
+        }
+        ++meshlet.triangleCount;
+    }
+    if (meshlet.triangleCount)
+        finish();
+    return list;
+}
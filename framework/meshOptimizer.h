@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "indexedMesh.h"
+
+struct VertexCacheStats
+{
+    uint32_t transformedVertices = 0;
+    float acmr = 0.f; // Average cache miss ratio, transformed vertices per triangle
+    float atvr = 0.f; // Average transform to vertex ratio, 1.0 is ideal
+};
+
+// Cluster of triangles that reference limited set of vertices,
+// triangles store local indices into meshlet vertex list.
+struct Meshlet
+{
+    uint32_t vertexOffset;
+    uint32_t triangleOffset;
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+
+struct MeshletList
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> vertices;
+    std::vector<uint8_t> triangles; // Three local indices per triangle
+};
+
+// Simulates FIFO post-transform cache of given size
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount, uint32_t vertexCount,
+    uint32_t cacheSize = 16);
+// Reorders triangles for post-transform cache (Forsyth, "Linear-Speed Vertex Cache Optimisation").
+// Order doesn't depend much on actual cache size, so it is good for both FIFO and LRU hardware.
+void optimizeVertexCache(uint32_t *indices, size_t indexCount, uint32_t vertexCount,
+    uint32_t cacheSize = 32);
+// Reorders vertices in order of first use by index buffer, so that vertex fetch
+// is mostly sequential. Unreferenced vertices are removed. Returns new vertex count.
+uint32_t optimizeVertexFetch(IndexedMesh& mesh);
+// Greedily splits triangle list into meshlets, index order is kept,
+// so the list should be optimized for vertex cache first.
+MeshletList buildMeshlets(const uint32_t *indices, size_t indexCount, uint32_t vertexCount,
+    uint32_t maxVertices = 64, uint32_t maxTriangles = 124);
@@ -0,0 +1,162 @@
+#include <cmath>
+#include <cassert>
+#include <unordered_map>
+#include "meshWeld.h"
+
+static uint64_t cellKey(int32_t x, int32_t y, int32_t z) noexcept
+{   // 21 bits per coordinate
+    return (uint64_t(x & 0x1FFFFF) << 42) | (uint64_t(y & 0x1FFFFF) << 21) | uint64_t(z & 0x1FFFFF);
+}
+
+static bool isFinite(const rapid::float3& v) noexcept
+{
+    return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+}
+
+static float normalize(rapid::float3& n) noexcept
+{
+    const float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+    const float scale = length > 0.f ? 1.f / length : 0.f;
+    n = {n.x * scale, n.y * scale, n.z * scale};
+    return length;
+}
+
+static void fixUndefinedNormals(const VertexStream<rapid::float3>& positions,
+    const std::vector<uint32_t>& indices, VertexStream<rapid::float3>& normals)
+{   // If all merged normals were undefined (pole shared by all patches),
+    // take face normals of adjacent triangles, oriented like their other vertices
+    std::vector<rapid::float3> faceSum(normals.size(), {0.f, 0.f, 0.f});
+    std::vector<bool> undefined(normals.size());
+    bool any = false;
+    for (size_t i = 0; i < normals.size(); ++i)
+    {
+        const rapid::float3& n = normals[i];
+        undefined[i] = (0.f == n.x && 0.f == n.y && 0.f == n.z);
+        any |= undefined[i];
+    }
+    if (!any)
+        return;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const uint32_t tri[3] = {indices[i], indices[i + 1], indices[i + 2]};
+        const rapid::float3& a = positions[tri[0]], &b = positions[tri[1]], &c = positions[tri[2]];
+        const float e1[3] = {b.x - a.x, b.y - a.y, b.z - a.z};
+        const float e2[3] = {c.x - a.x, c.y - a.y, c.z - a.z};
+        rapid::float3 face = {
+            e1[1] * e2[2] - e1[2] * e2[1],
+            e1[2] * e2[0] - e1[0] * e2[2],
+            e1[0] * e2[1] - e1[1] * e2[0]};
+        float orientation = 0.f;
+        for (uint32_t v : tri)
+        {
+            if (!undefined[v])
+                orientation += face.x * normals[v].x + face.y * normals[v].y + face.z * normals[v].z;
+        }
+        if (orientation < 0.f)
+            face = {-face.x, -face.y, -face.z};
+        for (uint32_t v : tri)
+        {
+            if (undefined[v])
+            {
+                faceSum[v].x += face.x;
+                faceSum[v].y += face.y;
+                faceSum[v].z += face.z;
+            }
+        }
+    }
+    for (size_t i = 0; i < normals.size(); ++i)
+    {
+        if (undefined[i])
+        {
+            normals[i] = faceSum[i];
+            normalize(normals[i]);
+        }
+    }
+}
+
+WeldStats weldVertices(IndexedMesh& mesh, float tolerance /* 1e-4f */)
+{
+    assert(tolerance > 0.f);
+    WeldStats stats;
+    stats.vertexCountBefore = mesh.getVertexCount();
+    stats.bytesBefore = mesh.getMemorySize();
+    const bool hasNormals = !mesh.normals.empty();
+    const bool hasTexCoords = !mesh.texCoords.empty();
+    const float invCellSize = 1.f / tolerance;
+    const float toleranceSq = tolerance * tolerance;
+    std::unordered_multimap<uint64_t, uint32_t> grid;
+    grid.reserve(mesh.positions.size());
+    std::vector<uint32_t> remap(mesh.positions.size());
+    IndexedMesh welded;
+    welded.positions.reserve(mesh.positions.size());
+    VertexStream<rapid::float3> normalSum;
+    for (uint32_t i = 0; i < mesh.getVertexCount(); ++i)
+    {
+        const rapid::float3& p = mesh.positions[i];
+        const int32_t cx = static_cast<int32_t>(std::floor(p.x * invCellSize));
+        const int32_t cy = static_cast<int32_t>(std::floor(p.y * invCellSize));
+        const int32_t cz = static_cast<int32_t>(std::floor(p.z * invCellSize));
+        uint32_t match = UINT32_MAX;
+        // Coincident vertex may fall into neighbour cell
+        for (int32_t z = cz - 1; z <= cz + 1 && UINT32_MAX == match; ++z)
+        for (int32_t y = cy - 1; y <= cy + 1 && UINT32_MAX == match; ++y)
+        for (int32_t x = cx - 1; x <= cx + 1 && UINT32_MAX == match; ++x)
+        {
+            auto range = grid.equal_range(cellKey(x, y, z));
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                const rapid::float3& q = welded.positions[it->second];
+                const float dx = p.x - q.x, dy = p.y - q.y, dz = p.z - q.z;
+                if (dx * dx + dy * dy + dz * dz <= toleranceSq)
+                {
+                    match = it->second;
+                    break;
+                }
+            }
+        }
+        if (UINT32_MAX == match)
+        {
+            match = welded.getVertexCount();
+            grid.emplace(cellKey(cx, cy, cz), match);
+            welded.positions.push_back(p);
+            if (hasTexCoords)
+                welded.texCoords.push_back(mesh.texCoords[i]);
+            if (hasNormals)
+                normalSum.push_back({0.f, 0.f, 0.f});
+        }
+        if (hasNormals && isFinite(mesh.normals[i]))
+        {   // Derivatives vanish at poles, so such normals are skipped
+            rapid::float3& n = normalSum[match];
+            n.x += mesh.normals[i].x;
+            n.y += mesh.normals[i].y;
+            n.z += mesh.normals[i].z;
+        }
+        remap[i] = match;
+    }
+    welded.indices.reserve(mesh.indices.size());
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        const uint32_t a = remap[mesh.indices[i]];
+        const uint32_t b = remap[mesh.indices[i + 1]];
+        const uint32_t c = remap[mesh.indices[i + 2]];
+        if (a == b || b == c || c == a)
+            ++stats.degenerateTriangles;
+        else
+        {
+            welded.indices.push_back(a);
+            welded.indices.push_back(b);
+            welded.indices.push_back(c);
+        }
+    }
+    if (hasNormals)
+    {
+        for (size_t i = 0; i < normalSum.size(); ++i)
+            normalize(normalSum[i]);
+        fixUndefinedNormals(welded.positions, welded.indices, normalSum);
+        welded.normals = std::move(normalSum);
+    }
+    mesh = std::move(welded);
+    stats.vertexCountAfter = mesh.getVertexCount();
+    stats.bytesAfter = mesh.getMemorySize();
+    return stats;
+}
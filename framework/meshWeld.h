@@ -0,0 +1,18 @@
+#pragma once
+#include "indexedMesh.h"
+
+struct WeldStats
+{
+    uint32_t vertexCountBefore = 0;
+    uint32_t vertexCountAfter = 0;
+    uint32_t degenerateTriangles = 0;
+    uint64_t bytesBefore = 0;
+    uint64_t bytesAfter = 0;
+};
+
+// Merges vertices which positions are closer than tolerance, using spatial hash
+// with cell size equal to tolerance. Normals of merged vertices are averaged
+// (undefined ones at patch poles are rebuilt from adjacent faces), texture
+// coordinates of the first vertex are kept. Triangles that collapsed to
+// a line or point are removed.
+WeldStats weldVertices(IndexedMesh& mesh, float tolerance = 1e-4f);
@@ -0,0 +1,217 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "packedMesh.h"
+
+uint32_t VertexFormat::getPositionSize() const noexcept
+{
+    return PositionFormat::Unorm16 == position ? 4 * sizeof(uint16_t) : 3 * sizeof(float);
+}
+
+uint32_t VertexFormat::getNormalSize() const noexcept
+{
+    return NormalFormat::Float32 == normal ? 3 * sizeof(float) : sizeof(uint32_t);
+}
+
+uint32_t VertexFormat::getTexCoordSize() const noexcept
+{
+    switch (texCoord)
+    {
+    case TexCoordFormat::Float32: return 2 * sizeof(float);
+    case TexCoordFormat::Unorm16: return 2 * sizeof(uint16_t);
+    default: return 0;
+    }
+}
+
+static uint16_t quantizeUnorm16(float x) noexcept
+{
+    return static_cast<uint16_t>(std::lround(std::min(std::max(x, 0.f), 1.f) * 65535.f));
+}
+
+static int16_t quantizeSnorm16(float x) noexcept
+{
+    return static_cast<int16_t>(std::lround(std::min(std::max(x, -1.f), 1.f) * 32767.f));
+}
+
+static uint32_t quantizeUnorm10(float x) noexcept
+{
+    return static_cast<uint32_t>(std::lround(std::min(std::max(x, 0.f), 1.f) * 1023.f));
+}
+
+static float signNotZero(float x) noexcept
+{
+    return x >= 0.f ? 1.f : -1.f;
+}
+
+static rapid::float3 normalized(float x, float y, float z) noexcept
+{
+    const float length = std::sqrt(x * x + y * y + z * z);
+    const float scale = length > 0.f ? 1.f / length : 0.f;
+    return {x * scale, y * scale, z * scale};
+}
+
+// A Survey of Efficient Representations for Independent Unit Vectors, Cigolle et al.
+static void encodeOctahedral(const rapid::float3& n, int16_t oct[2]) noexcept
+{
+    const float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    const float scale = l1 > 0.f ? 1.f / l1 : 0.f;
+    float u = n.x * scale;
+    float v = n.y * scale;
+    if (n.z < 0.f)
+    {   // Fold lower hemisphere over diagonals
+        const float fu = (1.f - std::fabs(v)) * signNotZero(u);
+        const float fv = (1.f - std::fabs(u)) * signNotZero(v);
+        u = fu;
+        v = fv;
+    }
+    oct[0] = quantizeSnorm16(u);
+    oct[1] = quantizeSnorm16(v);
+}
+
+static rapid::float3 decodeOctahedral(const int16_t oct[2]) noexcept
+{   // Same as in shader
+    const float u = std::max(oct[0] / 32767.f, -1.f);
+    const float v = std::max(oct[1] / 32767.f, -1.f);
+    const float z = 1.f - std::fabs(u) - std::fabs(v);
+    if (z < 0.f)
+        return normalized((1.f - std::fabs(v)) * signNotZero(u), (1.f - std::fabs(u)) * signNotZero(v), z);
+    return normalized(u, v, z);
+}
+
+static uint32_t encode1010102(const rapid::float3& n) noexcept
+{   // VK_FORMAT_A2B10G10R10_UNORM_PACK32, x in low bits
+    return quantizeUnorm10(n.x * .5f + .5f) |
+        (quantizeUnorm10(n.y * .5f + .5f) << 10) |
+        (quantizeUnorm10(n.z * .5f + .5f) << 20);
+}
+
+static rapid::float3 decode1010102(uint32_t packed) noexcept
+{
+    return normalized(
+        (packed & 0x3FF) / 1023.f * 2.f - 1.f,
+        ((packed >> 10) & 0x3FF) / 1023.f * 2.f - 1.f,
+        ((packed >> 20) & 0x3FF) / 1023.f * 2.f - 1.f);
+}
+
+template<typename Type>
+static void append(std::vector<uint8_t>& stream, const Type& value)
+{
+    const size_t size = stream.size();
+    stream.resize(size + sizeof(Type));
+    memcpy(stream.data() + size, &value, sizeof(Type));
+}
+
+static void packPositions(const IndexedMesh& mesh, PackedMesh& packed)
+{
+    if (PositionFormat::Float32 == packed.format.position)
+    {
+        for (const rapid::float3& p : mesh.positions)
+            append(packed.positions, p);
+        return;
+    }
+    rapid::float3 boundsMax = {-INFINITY, -INFINITY, -INFINITY};
+    packed.boundsMin = {INFINITY, INFINITY, INFINITY};
+    for (const rapid::float3& p : mesh.positions)
+    {
+        packed.boundsMin = {std::min(packed.boundsMin.x, p.x), std::min(packed.boundsMin.y, p.y), std::min(packed.boundsMin.z, p.z)};
+        boundsMax = {std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z)};
+    }
+    // Avoid division by zero for flat meshes
+    packed.boundsExtent = {
+        std::max(boundsMax.x - packed.boundsMin.x, 1e-6f),
+        std::max(boundsMax.y - packed.boundsMin.y, 1e-6f),
+        std::max(boundsMax.z - packed.boundsMin.z, 1e-6f)};
+    const rapid::float3& lo = packed.boundsMin;
+    const rapid::float3& ext = packed.boundsExtent;
+    for (const rapid::float3& p : mesh.positions)
+    {
+        const uint16_t q[4] = {
+            quantizeUnorm16((p.x - lo.x) / ext.x),
+            quantizeUnorm16((p.y - lo.y) / ext.y),
+            quantizeUnorm16((p.z - lo.z) / ext.z),
+            65535};
+        append(packed.positions, q);
+        const float dx = lo.x + q[0] / 65535.f * ext.x - p.x;
+        const float dy = lo.y + q[1] / 65535.f * ext.y - p.y;
+        const float dz = lo.z + q[2] / 65535.f * ext.z - p.z;
+        packed.maxPositionError = std::max(packed.maxPositionError, std::sqrt(dx * dx + dy * dy + dz * dz));
+    }
+}
+
+static void packNormals(const IndexedMesh& mesh, PackedMesh& packed)
+{
+    for (const rapid::float3& n : mesh.normals)
+    {
+        rapid::float3 decoded;
+        switch (packed.format.normal)
+        {
+        case NormalFormat::Float32:
+            append(packed.normals, n);
+            continue;
+        case NormalFormat::Octahedral16:
+            {
+                int16_t oct[2];
+                encodeOctahedral(n, oct);
+                append(packed.normals, oct);
+                decoded = decodeOctahedral(oct);
+            }
+            break;
+        case NormalFormat::Unorm1010102:
+            {
+                const uint32_t value = encode1010102(n);
+                append(packed.normals, value);
+                decoded = decode1010102(value);
+            }
+            break;
+        }
+        const float cosAngle = std::min(std::max(n.x * decoded.x + n.y * decoded.y + n.z * decoded.z, -1.f), 1.f);
+        packed.maxNormalErrorDegrees = std::max(packed.maxNormalErrorDegrees, std::acos(cosAngle) * 57.29578f);
+    }
+}
+
+static void packTexCoords(const IndexedMesh& mesh, PackedMesh& packed)
+{
+    for (const rapid::float2& st : mesh.texCoords)
+    {
+        switch (packed.format.texCoord)
+        {
+        case TexCoordFormat::Float32:
+            append(packed.texCoords, st);
+            break;
+        case TexCoordFormat::Unorm16:
+            {
+                const uint16_t q[2] = {quantizeUnorm16(st.x), quantizeUnorm16(st.y)};
+                append(packed.texCoords, q);
+            }
+            break;
+        case TexCoordFormat::Implicit:
+            return;
+        }
+    }
+}
+
+PackedMesh packMesh(const IndexedMesh& mesh, const VertexFormat& format)
+{
+    PackedMesh packed;
+    packed.format = format;
+    packed.vertexCount = mesh.getVertexCount();
+    packed.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    packed.positions.reserve(mesh.positions.size() * format.getPositionSize());
+    packed.normals.reserve(mesh.normals.size() * format.getNormalSize());
+    packed.texCoords.reserve(mesh.texCoords.size() * format.getTexCoordSize());
+    packPositions(mesh, packed);
+    packNormals(mesh, packed);
+    packTexCoords(mesh, packed);
+    // 0xFFFF is left for primitive restart
+    packed.indexSize = packed.vertexCount < 0xFFFF ? sizeof(uint16_t) : sizeof(uint32_t);
+    packed.indices.resize(packed.indexCount * packed.indexSize);
+    if (sizeof(uint16_t) == packed.indexSize)
+    {
+        uint16_t *indices = reinterpret_cast<uint16_t *>(packed.indices.data());
+        for (uint32_t index : mesh.indices)
+            *indices++ = static_cast<uint16_t>(index);
+    }
+    else
+        memcpy(packed.indices.data(), mesh.indices.data(), packed.indices.size());
+    return packed;
+}
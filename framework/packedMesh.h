@@ -0,0 +1,61 @@
+#pragma once
+#include "indexedMesh.h"
+
+enum class PositionFormat
+{
+    Float32, // 12 bytes
+    Unorm16  // 8 bytes, relative to mesh bounds, w is always 1
+};
+
+enum class NormalFormat
+{
+    Float32,      // 12 bytes
+    Octahedral16, // 4 bytes, two snorm16 components of octahedral mapping
+    Unorm1010102  // 4 bytes, xyz biased to [0,1], 2-bit w is 0
+};
+
+enum class TexCoordFormat
+{
+    Float32, // 8 bytes
+    Unorm16, // 4 bytes
+    Implicit // Not stored, on patch grid UV is a function of vertex index
+};
+
+struct VertexFormat
+{
+    PositionFormat position = PositionFormat::Float32;
+    NormalFormat normal = NormalFormat::Float32;
+    TexCoordFormat texCoord = TexCoordFormat::Float32;
+
+    uint32_t getPositionSize() const noexcept;
+    uint32_t getNormalSize() const noexcept;
+    uint32_t getTexCoordSize() const noexcept;
+    uint32_t getVertexSize() const noexcept { return getPositionSize() + getNormalSize() + getTexCoordSize(); }
+};
+
+// Vertex streams encoded to given format and index buffer that is 16-bit
+// when vertex count allows. Quantized positions are decoded as
+// boundsMin + unorm * boundsExtent, which is left to the world transform.
+struct PackedMesh
+{
+    VertexFormat format;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    uint32_t indexSize = 0; // 2 or 4 bytes
+    std::vector<uint8_t> positions;
+    std::vector<uint8_t> normals;
+    std::vector<uint8_t> texCoords;
+    std::vector<uint8_t> indices;
+    rapid::float3 boundsMin = {0.f, 0.f, 0.f};
+    rapid::float3 boundsExtent = {1.f, 1.f, 1.f};
+    // Measured after encoding
+    float maxPositionError = 0.f;
+    float maxNormalErrorDegrees = 0.f;
+
+    uint64_t getMemorySize() const noexcept
+    {
+        return positions.size() + normals.size() + texCoords.size() + indices.size();
+    }
+};
+
+PackedMesh packMesh(const IndexedMesh& mesh, const VertexFormat& format);
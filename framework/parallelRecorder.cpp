@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <stdexcept>
+#include "parallelRecorder.h"
+#include "threadPool.h"
+#include "../magma/magma.h"
+
+ParallelRecorder::ParallelRecorder(std::shared_ptr<magma::Device> device,
+    uint32_t queueFamilyIndex,
+    ThreadPool& threadPool,
+    uint32_t minDrawsPerSlice /* 32 */):
+    threadPool(threadPool),
+    minDrawsPerSlice(std::max(minDrawsPerSlice, 1U)),
+    contexts(threadPool.getThreadCount())
+{
+    for (ThreadContext& context : contexts)
+        context.commandPool = std::make_shared<magma::CommandPool>(device, queueFamilyIndex);
+}
+
+ParallelRecorder::~ParallelRecorder()
+{}
+
+void ParallelRecorder::recordRenderPass(magma::CommandBuffer& primary,
+    const magma::RenderPass& renderPass,
+    const magma::Framebuffer& framebuffer,
+    const std::vector<VkClearValue>& clearValues,
+    uint32_t drawCount,
+    const RecordSlice& recordSlice)
+{
+    const uint32_t sliceCount = getSliceCount(drawCount);
+    for (ThreadContext& context : contexts)
+        context.usedCount = 0;
+    slices.resize(sliceCount);
+    VkCommandBufferInheritanceInfo inheritanceInfo;
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.pNext = nullptr;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = framebuffer;
+    inheritanceInfo.occlusionQueryEnable = VK_FALSE;
+    inheritanceInfo.queryFlags = 0;
+    inheritanceInfo.pipelineStatistics = 0;
+    threadPool.parallelFor(sliceCount, [&](uint32_t slice, uint32_t threadIndex)
+    {   // Only this thread touches its pool and buffers
+        ThreadContext& context = contexts[threadIndex];
+        if (context.usedCount == context.cmdBuffers.size())
+            context.cmdBuffers.push_back(context.commandPool->allocateCommandBuffer(false));
+        magma::CommandBuffer& cmdBuffer = *context.cmdBuffers[context.usedCount++];
+        const VkCommandBuffer handle = cmdBuffer;
+        VkCommandBufferBeginInfo beginInfo;
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.pNext = nullptr;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        if (vkBeginCommandBuffer(handle, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("failed to begin secondary command buffer");
+        // Even split, slices differ by one draw at most
+        const uint32_t first = static_cast<uint32_t>(uint64_t(drawCount) * slice / sliceCount);
+        const uint32_t last = static_cast<uint32_t>(uint64_t(drawCount) * (slice + 1) / sliceCount);
+        recordSlice(cmdBuffer, first, last - first);
+        if (vkEndCommandBuffer(handle) != VK_SUCCESS)
+            throw std::runtime_error("failed to end secondary command buffer");
+        slices[slice] = handle;
+    });
+    VkRenderPassBeginInfo beginInfo;
+    beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    beginInfo.pNext = nullptr;
+    beginInfo.renderPass = renderPass;
+    beginInfo.framebuffer = framebuffer;
+    beginInfo.renderArea.offset = {0, 0};
+    beginInfo.renderArea.extent = framebuffer.getExtent();
+    beginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    beginInfo.pClearValues = clearValues.data();
+    const VkCommandBuffer handle = primary;
+    vkCmdBeginRenderPass(handle, &beginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    vkCmdExecuteCommands(handle, sliceCount, slices.data());
+    vkCmdEndRenderPass(handle);
+}
+
+uint32_t ParallelRecorder::getSliceCount(uint32_t drawCount) const noexcept
+{   // Two slices per thread even out uneven ones, but each should be large
+    // enough to amortize state setup. Empty list still gets one slice.
+    const uint32_t maxSliceCount = getThreadCount() * 2;
+    return std::max(1U, std::min(maxSliceCount, drawCount / minDrawsPerSlice));
+}
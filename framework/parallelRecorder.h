@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <functional>
+#include <vulkan/vulkan.h>
+#include "nonCopyable.h"
+
+namespace magma
+{
+    class Device;
+    class CommandPool;
+    class CommandBuffer;
+    class RenderPass;
+    class Framebuffer;
+}
+
+class ThreadPool;
+
+// Splits draw list into slices which are recorded into secondary command buffers
+// on pool threads, then executed from primary command buffer in slice order.
+// Command pools are externally synchronized, so each thread allocates from its own.
+// Secondary buffers are reused on next recording, so primary that executes them
+// should not be pending at that time.
+class ParallelRecorder : public NonCopyable
+{
+public:
+    // Secondary command buffer inherits nothing but render pass, so slice
+    // has to bind pipeline, descriptor sets and dynamic state itself.
+    typedef std::function<void(magma::CommandBuffer& cmdBuffer, uint32_t firstDraw, uint32_t drawCount)> RecordSlice;
+
+    ParallelRecorder(std::shared_ptr<magma::Device> device,
+        uint32_t queueFamilyIndex,
+        ThreadPool& threadPool,
+        uint32_t minDrawsPerSlice = 32);
+    ~ParallelRecorder();
+    // Begins render pass with secondary contents, records slices in parallel and executes them.
+    // Render pass is ended, so the rest of primary can be recorded as usual.
+    void recordRenderPass(magma::CommandBuffer& primary,
+        const magma::RenderPass& renderPass,
+        const magma::Framebuffer& framebuffer,
+        const std::vector<VkClearValue>& clearValues,
+        uint32_t drawCount,
+        const RecordSlice& recordSlice);
+    uint32_t getSliceCount(uint32_t drawCount) const noexcept;
+    uint32_t getThreadCount() const noexcept { return static_cast<uint32_t>(contexts.size()); }
+
+private:
+    struct ThreadContext
+    {
+        std::shared_ptr<magma::CommandPool> commandPool;
+        std::vector<std::shared_ptr<magma::CommandBuffer>> cmdBuffers;
+        uint32_t usedCount = 0;
+    };
+
+    ThreadPool& threadPool;
+    const uint32_t minDrawsPerSlice;
+    std::vector<ThreadContext> contexts;
+    std::vector<VkCommandBuffer> slices;
+};
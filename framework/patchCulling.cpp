@@ -0,0 +1,204 @@
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <emmintrin.h>
+#include "patchCulling.h"
+
+static void push(PatchBounds::Stream& stream, float value, uint32_t count)
+{   // Keep stream padded, unused lanes are never visible
+    if (stream.size() < ((count + 4) & ~3))
+        stream.resize((count + 4) & ~3, 0.f);
+    stream[count] = value;
+}
+
+void PatchBounds::addPatch(const rapid::float3 *positions, uint32_t vertexCount,
+    const uint32_t *indices, uint32_t indexCount)
+{
+    assert(vertexCount > 0);
+    // Sphere around center of AABB
+    rapid::float3 lo = positions[0], hi = positions[0];
+    for (uint32_t i = 1; i < vertexCount; ++i)
+    {
+        const rapid::float3& p = positions[i];
+        lo = {std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z)};
+        hi = {std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z)};
+    }
+    const rapid::float3 center = {(lo.x + hi.x) * .5f, (lo.y + hi.y) * .5f, (lo.z + hi.z) * .5f};
+    float radiusSq = 0.f;
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        const float dx = positions[i].x - center.x, dy = positions[i].y - center.y, dz = positions[i].z - center.z;
+        radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+    }
+    // Normal cone of front faces
+    std::vector<rapid::float3> normals;
+    normals.reserve(indexCount / 3);
+    rapid::float3 axis = {0.f, 0.f, 0.f};
+    for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        const rapid::float3& a = positions[indices[i]];
+        const rapid::float3& b = positions[indices[i + 1]];
+        const rapid::float3& c = positions[indices[i + 2]];
+        const float e1[3] = {c.x - a.x, c.y - a.y, c.z - a.z};
+        const float e2[3] = {b.x - a.x, b.y - a.y, b.z - a.z};
+        rapid::float3 n = {
+            e1[1] * e2[2] - e1[2] * e2[1],
+            e1[2] * e2[0] - e1[0] * e2[2],
+            e1[0] * e2[1] - e1[1] * e2[0]};
+        const float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+        if (length < 1e-12f)
+            continue; // Degenerate triangle at pole
+        n = {n.x / length, n.y / length, n.z / length};
+        normals.push_back(n);
+        axis = {axis.x + n.x, axis.y + n.y, axis.z + n.z};
+    }
+    const float axisLength = std::sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+    float coneCutoff = 2.f; // Never culled
+    if (axisLength > 0.f)
+    {
+        axis = {axis.x / axisLength, axis.y / axisLength, axis.z / axisLength};
+        float minDot = 1.f;
+        for (const rapid::float3& n : normals)
+            minDot = std::min(minDot, n.x * axis.x + n.y * axis.y + n.z * axis.z);
+        if (minDot > 0.f) // Cone is narrower than hemisphere
+            coneCutoff = std::sqrt(1.f - minDot * minDot);
+    }
+    push(centerX, center.x, count);
+    push(centerY, center.y, count);
+    push(centerZ, center.z, count);
+    push(radius, std::sqrt(radiusSq), count);
+    push(axisX, axis.x, count);
+    push(axisY, axis.y, count);
+    push(axisZ, axis.z, count);
+    push(cutoff, coneCutoff, count);
+    ++count;
+}
+
+void PatchBounds::addPatch(const float packed[8])
+{
+    push(centerX, packed[0], count);
+    push(centerY, packed[1], count);
+    push(centerZ, packed[2], count);
+    push(radius, packed[3], count);
+    push(axisX, packed[4], count);
+    push(axisY, packed[5], count);
+    push(axisZ, packed[6], count);
+    push(cutoff, packed[7], count);
+    ++count;
+}
+
+std::vector<float> PatchBounds::pack() const
+{
+    std::vector<float> data;
+    data.reserve(count * 8);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const float patch[8] = {
+            centerX[i], centerY[i], centerZ[i], radius[i],
+            axisX[i], axisY[i], axisZ[i], cutoff[i]};
+        data.insert(data.end(), patch, patch + 8);
+    }
+    return data;
+}
+
+void PatchCuller::setWorldViewProj(const float m[16]) noexcept
+{   // Gribb/Hartmann plane extraction, clip = (x, y, z, 1) * m
+    for (int i = 0; i < 4; ++i)
+    {
+        const float x = m[i * 4], y = m[i * 4 + 1], z = m[i * 4 + 2], w = m[i * 4 + 3];
+        planes[0][i] = w + x; // Left
+        planes[1][i] = w - x; // Right
+        planes[2][i] = w + y; // Bottom
+        planes[3][i] = w - y; // Top
+        planes[4][i] = w + z; // Near, conservative for [0, 1] depth range
+        planes[5][i] = w - z; // Far
+    }
+    for (auto& plane : planes)
+    {
+        const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        for (float& c : plane)
+            c /= length;
+    }
+    // Eye is projection center, where clip x, y and w are all zero
+    const float a[3][3] = {
+        {m[0], m[4], m[8]},
+        {m[1], m[5], m[9]},
+        {m[3], m[7], m[11]}};
+    const float b[3] = {-m[12], -m[13], -m[15]};
+    const float det =
+        a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+        a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+        a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    eyeValid = std::fabs(det) > 1e-12f; // Not for orthographic projection
+    if (eyeValid)
+    {   // Cramer's rule
+        for (int k = 0; k < 3; ++k)
+        {
+            float c[3][3];
+            for (int r = 0; r < 3; ++r)
+                for (int col = 0; col < 3; ++col)
+                    c[r][col] = (col == k) ? b[r] : a[r][col];
+            eye[k] = (c[0][0] * (c[1][1] * c[2][2] - c[1][2] * c[2][1]) -
+                c[0][1] * (c[1][0] * c[2][2] - c[1][2] * c[2][0]) +
+                c[0][2] * (c[1][0] * c[2][1] - c[1][1] * c[2][0])) / det;
+        }
+    }
+}
+
+uint32_t PatchCuller::cull(const PatchBounds& bounds, uint32_t *visible, CullStats *stats /* nullptr */) const
+{
+    const __m128 eyeX = _mm_set1_ps(eye[0]);
+    const __m128 eyeY = _mm_set1_ps(eye[1]);
+    const __m128 eyeZ = _mm_set1_ps(eye[2]);
+    const int backfaceMask = eyeValid ? 0xF : 0;
+    uint32_t visibleCount = 0;
+    uint32_t frustumCulled = 0;
+    uint32_t backfaceCulled = 0;
+    for (uint32_t i = 0; i < bounds.count; i += 4)
+    {
+        const __m128 cx = _mm_load_ps(&bounds.centerX[i]);
+        const __m128 cy = _mm_load_ps(&bounds.centerY[i]);
+        const __m128 cz = _mm_load_ps(&bounds.centerZ[i]);
+        const __m128 r = _mm_load_ps(&bounds.radius[i]);
+        const __m128 minusR = _mm_sub_ps(_mm_setzero_ps(), r);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto& plane : planes)
+        {
+            const __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane[0])), _mm_mul_ps(cy, _mm_set1_ps(plane[1]))),
+                _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane[2])), _mm_set1_ps(plane[3])));
+            inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, minusR));
+        }
+        // Normal cone test
+        const __m128 dx = _mm_sub_ps(cx, eyeX);
+        const __m128 dy = _mm_sub_ps(cy, eyeY);
+        const __m128 dz = _mm_sub_ps(cz, eyeZ);
+        const __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+        const __m128 projection = _mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(dx, _mm_load_ps(&bounds.axisX[i])),
+            _mm_mul_ps(dy, _mm_load_ps(&bounds.axisY[i]))),
+            _mm_mul_ps(dz, _mm_load_ps(&bounds.axisZ[i])));
+        const __m128 back = _mm_cmpge_ps(projection,
+            _mm_add_ps(_mm_mul_ps(_mm_load_ps(&bounds.cutoff[i]), distance), r));
+        const int insideMask = _mm_movemask_ps(inside);
+        const int backMask = _mm_movemask_ps(back) & backfaceMask;
+        const uint32_t lanes = std::min(4U, bounds.count - i);
+        for (uint32_t lane = 0; lane < lanes; ++lane)
+        {
+            const int bit = 1 << lane;
+            if (!(insideMask & bit))
+                ++frustumCulled;
+            else if (backMask & bit)
+                ++backfaceCulled;
+            else
+                visible[visibleCount++] = i + lane;
+        }
+    }
+    if (stats)
+    {
+        stats->patchCount += bounds.count;
+        stats->frustumCulled += frustumCulled;
+        stats->backfaceCulled += backfaceCulled;
+    }
+    return visibleCount;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "alignedAllocator.h"
+#include "indexedMesh.h"
+
+// Bounding spheres and normal cones of patches in SoA layout,
+// padded to multiple of four so that culling processes four patches at once.
+class PatchBounds
+{
+public:
+    typedef std::vector<float, utilities::aligned_allocator<float>> Stream;
+
+    // Triangles are expected to be clockwise when front-facing
+    void addPatch(const rapid::float3 *positions, uint32_t vertexCount,
+        const uint32_t *indices, uint32_t indexCount);
+    // Patch in layout of pack(), e.g. baked at compile time by staticPatchBounds()
+    void addPatch(const float packed[8]);
+    uint32_t getPatchCount() const noexcept { return count; }
+    // Two vec4 per patch for shader: (center, radius) and (axis, cutoff)
+    std::vector<float> pack() const;
+
+private:
+    friend class PatchCuller;
+    uint32_t count = 0;
+    Stream centerX, centerY, centerZ, radius;
+    // Patch is back-facing if dot(center - eye, axis) >= cutoff * |center - eye| + radius
+    Stream axisX, axisY, axisZ, cutoff;
+};
+
+struct CullStats
+{
+    uint32_t patchCount = 0;
+    uint32_t frustumCulled = 0;
+    uint32_t backfaceCulled = 0;
+};
+
+class PatchCuller
+{
+public:
+    // Matrix is row-major and transforms row vectors, as rapid::matrix.
+    // Frustum planes and eye position in object space are derived from it.
+    void setWorldViewProj(const float worldViewProj[16]) noexcept;
+    // Writes indices of visible patches, returns their count
+    uint32_t cull(const PatchBounds& bounds, uint32_t *visible, CullStats *stats = nullptr) const;
+    const float *getPlane(uint32_t index) const noexcept { return planes[index]; }
+    const float *getEye() const noexcept { return eye; }
+    bool hasEye() const noexcept { return eyeValid; }
+
+private:
+    float planes[6][4];
+    float eye[3];
+    bool eyeValid = false;
+};
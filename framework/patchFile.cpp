@@ -0,0 +1,256 @@
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "patchFile.h"
+#include "mappedFile.h"
+#include "threadPool.h"
+
+static inline bool isDigit(char c) noexcept
+{
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+static inline bool isSeparator(char c) noexcept
+{
+    return ' ' == c || ',' == c || '\n' == c || '\r' == c || '\t' == c;
+}
+
+static inline uint32_t countTrailingZeros(uint32_t mask) noexcept
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+}
+
+// Length of digit run at the beginning, up to 16
+static inline uint32_t countDigits(const char *p, const char *limit) noexcept
+{
+    if (limit - p >= 16)
+    {   // Bytes outside of '0'..'9' are cleared in mask, non-ASCII bytes compare as negative
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i digits = _mm_and_si128(
+            _mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+            _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(digits));
+        return countTrailingZeros(~mask); // Bits above 15 are set
+    }
+    uint32_t count = 0;
+    while (count < 16 && p + count < limit && isDigit(p[count]))
+        ++count;
+    return count;
+}
+
+// Converts eight ASCII digits at once, byte order is little-endian
+static inline uint32_t parseEightDigits(const char *p) noexcept
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    value -= 0x3030303030303030ull;
+    value = value * 10 + (value >> 8); // Pairs
+    value = (((value & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+        (((value >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+    return static_cast<uint32_t>(value);
+}
+
+static const char *readDigits(const char *p, const char *limit, uint64_t& mantissa, uint32_t& digitCount) noexcept
+{
+    for (;;)
+    {   // Mantissa may wrap around after 19 digits, then result is discarded
+        const uint32_t run = countDigits(p, limit);
+        uint32_t n = run;
+        for (; n >= 8; n -= 8, p += 8)
+            mantissa = mantissa * 100000000 + parseEightDigits(p);
+        for (; n > 0; --n, ++p)
+            mantissa = mantissa * 10 + (*p - '0');
+        digitCount += run;
+        if (run < 16)
+            return p;
+    }
+}
+
+// Fast path is exact when both mantissa and power of ten are representable in double,
+// other numbers are rare and go to strtod().
+static const char *parseNumber(const char *p, const char *limit, double& value)
+{
+    static const double powersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *start = p;
+    const bool negative = ('-' == *p);
+    if (negative || '+' == *p)
+        ++p;
+    uint64_t mantissa = 0;
+    uint32_t digitCount = 0;
+    int32_t exponent = 0;
+    p = readDigits(p, limit, mantissa, digitCount);
+    if (p < limit && '.' == *p)
+    {
+        const uint32_t integerDigits = digitCount;
+        p = readDigits(p + 1, limit, mantissa, digitCount);
+        exponent = -static_cast<int32_t>(digitCount - integerDigits);
+    }
+    if (!digitCount)
+        throw std::runtime_error("invalid number in patch file");
+    if (p < limit && ('e' == *p || 'E' == *p))
+    {
+        ++p;
+        const bool negativeExponent = (p < limit && '-' == *p);
+        if (p < limit && ('-' == *p || '+' == *p))
+            ++p;
+        if (p >= limit || !isDigit(*p))
+            throw std::runtime_error("invalid number in patch file");
+        int32_t e = 0;
+        for (; p < limit && isDigit(*p); ++p)
+            e = std::min(e * 10 + (*p - '0'), 100000);
+        exponent += negativeExponent ? -e : e;
+    }
+    if (digitCount <= 19 && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+    {
+        const double m = static_cast<double>(mantissa);
+        value = (exponent < 0) ? m / powersOfTen[-exponent] : m * powersOfTen[exponent];
+        if (negative)
+            value = -value;
+    }
+    else
+    {   // Text is not null-terminated
+        const std::string number(start, p);
+        value = strtod(number.c_str(), nullptr);
+    }
+    return p;
+}
+
+static void parseChunk(const char *p, const char *end, const char *limit, std::vector<double>& numbers)
+{
+    numbers.reserve((end - p) / 4);
+    while (p < end)
+    {
+        if (isSeparator(*p))
+        {
+            ++p;
+            continue;
+        }
+        double value;
+        p = parseNumber(p, limit, value);
+        if (p < end && !isSeparator(*p))
+            throw std::runtime_error("unexpected character in patch file");
+        numbers.push_back(value);
+    }
+}
+
+static bool isCount(double value) noexcept
+{
+    return value >= 0. && value <= 4294967295. && value == std::floor(value);
+}
+
+static uint32_t toCount(double value)
+{
+    if (!isCount(value))
+        throw std::runtime_error("invalid count or index in patch file");
+    return static_cast<uint32_t>(value);
+}
+
+PatchSet parsePatchFile(const char *text, size_t size,
+    ThreadPool *pool /* nullptr */, PatchFileStats *stats /* nullptr */)
+{
+    constexpr size_t minChunkSize = 256 * 1024;
+    const uint32_t threadCount = pool ? pool->getThreadCount() : 1;
+    // Several chunks per thread to even out load
+    const uint32_t chunkCount = static_cast<uint32_t>(std::max(size_t(1),
+        std::min(size / minChunkSize, size_t(threadCount) * 4)));
+    std::vector<size_t> bounds(chunkCount + 1);
+    bounds[chunkCount] = size;
+    for (uint32_t i = 1; i < chunkCount; ++i)
+    {   // Move boundary to separator, so that numbers are not cut
+        size_t pos = std::max(size * i / chunkCount, bounds[i - 1]);
+        while (pos < size && !isSeparator(text[pos]))
+            ++pos;
+        bounds[i] = pos;
+    }
+    std::vector<std::vector<double>> chunks(chunkCount);
+    const ThreadPool::Task parse = [&](uint32_t chunk, uint32_t /* threadIndex */)
+    {
+        parseChunk(text + bounds[chunk], text + bounds[chunk + 1], text + size, chunks[chunk]);
+    };
+    if (pool && chunkCount > 1)
+        pool->parallelFor(chunkCount, parse);
+    else
+    {
+        for (uint32_t i = 0; i < chunkCount; ++i)
+            parse(i, 0);
+    }
+    std::vector<double> numbers;
+    size_t numberCount = 0;
+    for (const std::vector<double>& chunk : chunks)
+        numberCount += chunk.size();
+    numbers.reserve(numberCount);
+    for (std::vector<double>& chunk : chunks)
+    {
+        numbers.insert(numbers.end(), chunk.begin(), chunk.end());
+        std::vector<double>().swap(chunk);
+    }
+    if (stats)
+    {
+        stats->fileSize = size;
+        stats->numberCount = numberCount;
+        stats->chunkCount = chunkCount;
+    }
+    if (numbers.empty())
+        throw std::runtime_error("patch file is empty");
+    PatchSet set;
+    const uint64_t patchCount = toCount(numbers[0]);
+    const uint64_t vertexCountPos = 1 + patchCount * 16;
+    if (vertexCountPos < numberCount && isCount(numbers[vertexCountPos]) &&
+        numberCount == vertexCountPos + 1 + uint64_t(numbers[vertexCountPos]) * 3)
+    {   // Indexed control points
+        const uint32_t vertexCount = toCount(numbers[vertexCountPos]);
+        set.patches.resize(patchCount * 16);
+        for (size_t i = 0; i < set.patches.size(); ++i)
+        {
+            const uint32_t index = toCount(numbers[1 + i]);
+            if (index < 1 || index > vertexCount)
+                throw std::runtime_error("patch refers to missing vertex");
+            set.patches[i] = index;
+        }
+        set.vertices.resize(vertexCount * 3);
+        for (size_t i = 0; i < set.vertices.size(); ++i)
+            set.vertices[i] = static_cast<float>(numbers[vertexCountPos + 1 + i]);
+    }
+    else if (numberCount == 1 + patchCount * (2 + 16 * 3))
+    {   // Control points of each patch are listed in place
+        set.patches.resize(patchCount * 16);
+        set.vertices.resize(patchCount * 16 * 3);
+        for (uint32_t np = 0; np < patchCount; ++np)
+        {
+            const double *patch = &numbers[1 + size_t(np) * (2 + 16 * 3)];
+            if (patch[0] != 3. || patch[1] != 3.)
+                throw std::runtime_error("only bicubic patches are supported");
+            for (uint32_t i = 0; i < 16; ++i)
+                set.patches[np * 16 + i] = np * 16 + i + 1;
+            for (uint32_t i = 0; i < 16 * 3; ++i)
+                set.vertices[size_t(np) * 16 * 3 + i] = static_cast<float>(patch[2 + i]);
+        }
+    }
+    else
+        throw std::runtime_error("unrecognized patch file layout");
+    return set;
+}
+
+PatchSet loadPatchFile(const std::string& filename,
+    ThreadPool *pool /* nullptr */, PatchFileStats *stats /* nullptr */)
+{
+    const MappedFile file(filename, MappedFile::Access::ReadOnly);
+    // Chunks are read concurrently, so ask for all pages ahead
+    file.advise(0, file.size(), MappedFile::Advice::WillNeed);
+    return parsePatchFile(reinterpret_cast<const char *>(file.data()),
+        static_cast<size_t>(file.size()), pool, stats);
+}
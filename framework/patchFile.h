@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Bicubic patches with shared control points, same layout as teapot.h,
+// so that arrays can be passed to BezierPatchMesh as they are.
+struct PatchSet
+{
+    std::vector<uint32_t> patches; // 16 one-based vertex indices per patch
+    std::vector<float> vertices; // XYZ per control point
+
+    uint32_t getPatchCount() const noexcept { return static_cast<uint32_t>(patches.size() / 16); }
+    uint32_t getVertexCount() const noexcept { return static_cast<uint32_t>(vertices.size() / 3); }
+    const uint32_t (*getPatches() const noexcept)[16]
+        { return reinterpret_cast<const uint32_t (*)[16]>(patches.data()); }
+    const float (*getVertices() const noexcept)[3]
+        { return reinterpret_cast<const float (*)[3]>(vertices.data()); }
+};
+
+struct PatchFileStats
+{
+    uint64_t fileSize = 0;
+    uint64_t numberCount = 0;
+    uint32_t chunkCount = 0;
+};
+
+// Text patch files are recognized by number count:
+// - indexed (Newell teaset): patch count, 16 one-based indices per patch,
+//   vertex count, then XYZ per vertex;
+// - .bpt: patch count, then "3 3" degree pair and 16 XYZ points per patch.
+// Numbers may be separated by whitespace or commas. Text is split into chunks
+// at separators, chunks are parsed in parallel if thread pool is provided.
+// Throws std::runtime_error on malformed input.
+PatchSet parsePatchFile(const char *text, size_t size,
+    ThreadPool *pool = nullptr, PatchFileStats *stats = nullptr);
+// Memory-maps file and parses it in place
+PatchSet loadPatchFile(const std::string& filename,
+    ThreadPool *pool = nullptr, PatchFileStats *stats = nullptr);
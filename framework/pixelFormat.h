@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+
+enum class PixelFormat : uint32_t
+{
+    R8 = 1, R16, R32F
+};
+
+inline uint32_t getPixelSize(PixelFormat format) noexcept
+{
+    switch (format)
+    {
+    case PixelFormat::R8: return 1;
+    case PixelFormat::R16: return 2;
+    case PixelFormat::R32F: return 4;
+    default: return 0;
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
-#include <xmmintrin.h>
+#include <new>
 #include <string>
+#include "hostMemory.h"
 
 template<size_t alignment>
 class alignas(alignment) AlignAs
@@ -8,15 +9,15 @@ class alignas(alignment) AlignAs
 public:
     void *operator new(size_t size)
     {
-        void *ptr = _mm_malloc(size, alignment);
+        void *ptr = utilities::alignedAlloc(size, alignment);
         if (!ptr)
             throw std::bad_alloc();
         return ptr;
     }
 
-    void operator delete(void *ptr) noexcept
-    {
-        _mm_free(ptr);
+    void operator delete(void *ptr, size_t size) noexcept
+    {   // Size selects the same path as in operator new
+        utilities::alignedFree(ptr, size);
     }
 };
 
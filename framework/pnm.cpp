@@ -0,0 +1,97 @@
+#include <cctype>
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+#include "pnm.h"
+
+static uint32_t parseHeaderValue(const uint8_t *data, size_t size, size_t& pos)
+{
+    for (;;)
+    {   // Skip whitespace and comments
+        while (pos < size && isspace(data[pos]))
+            ++pos;
+        if (pos < size && '#' == data[pos])
+        {
+            while (pos < size && data[pos] != '\n')
+                ++pos;
+        }
+        else
+            break;
+    }
+    if (pos >= size || !isdigit(data[pos]))
+        throw std::runtime_error("invalid PNM header");
+    uint32_t value = 0;
+    while (pos < size && isdigit(data[pos]))
+        value = value * 10 + (data[pos++] - '0');
+    return value;
+}
+
+Image decodePnm(const uint8_t *data, size_t size)
+{
+    if (size < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6'))
+        throw std::runtime_error("unsupported PNM format");
+    const uint32_t components = ('6' == data[1]) ? 3 : 1;
+    size_t pos = 2;
+    Image image;
+    image.width = parseHeaderValue(data, size, pos);
+    image.height = parseHeaderValue(data, size, pos);
+    const uint32_t maxValue = parseHeaderValue(data, size, pos);
+    ++pos; // Single whitespace before raster
+    if (!image.width || !image.height || !maxValue || maxValue > 65535)
+        throw std::runtime_error("invalid PNM header");
+    const uint32_t sampleSize = (maxValue > 255) ? 2 : 1;
+    const size_t pixelCount = size_t(image.width) * image.height;
+    if (pos + pixelCount * components * sampleSize > size)
+        throw std::runtime_error("PNM raster is truncated");
+    image.format = (2 == sampleSize) ? PixelFormat::R16 : PixelFormat::R8;
+    image.pixels.resize(pixelCount * sampleSize);
+    const uint8_t *raster = data + pos;
+    if (1 == components && 255 == maxValue)
+    {   // Most common case, no conversion
+        std::copy(raster, raster + pixelCount, image.pixels.begin());
+        return image;
+    }
+    // Rescale to full range of the sample type
+    const float scale = ((2 == sampleSize) ? 65535.f : 255.f) / maxValue;
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        float value;
+        if (1 == sampleSize)
+        {
+            const uint8_t *p = raster + i * components;
+            value = (3 == components) ? 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2] : p[0];
+        }
+        else
+        {   // Samples are big-endian
+            const uint8_t *p = raster + i * components * 2;
+            if (3 == components)
+            {
+                value = 0.299f * ((p[0] << 8) | p[1]) +
+                    0.587f * ((p[2] << 8) | p[3]) +
+                    0.114f * ((p[4] << 8) | p[5]);
+            }
+            else
+                value = static_cast<float>((p[0] << 8) | p[1]);
+        }
+        value = value * scale + 0.5f;
+        if (1 == sampleSize)
+            image.pixels[i] = static_cast<uint8_t>(std::min(value, 255.f));
+        else
+            reinterpret_cast<uint16_t *>(image.pixels.data())[i] = static_cast<uint16_t>(std::min(value, 65535.f));
+    }
+    return image;
+}
+
+Image decodeRaw(const uint8_t *data, size_t size,
+    uint32_t width, uint32_t height, PixelFormat format)
+{
+    const size_t imageSize = size_t(width) * height * getPixelSize(format);
+    if (!imageSize || size < imageSize)
+        throw std::runtime_error("raw image is truncated");
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.format = format;
+    image.pixels.assign(data, data + imageSize);
+    return image;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <vector>
+#include "pixelFormat.h"
+#include "alignedAllocator.h"
+
+// Planes are cache-line aligned, large ones go to huge pages if enabled
+typedef std::vector<uint8_t, utilities::aligned_allocator<uint8_t, utilities::cacheLineSize>> PixelBuffer;
+
+// Single-channel image in host memory
+struct Image
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    PixelFormat format = PixelFormat::R8;
+    PixelBuffer pixels;
+};
+
+// Decodes binary PGM (P5) and PPM (P6) images. 16-bit samples are
+// converted to host byte order, color is converted to luminance.
+Image decodePnm(const uint8_t *data, size_t size);
+// Wraps headerless pixel data of known dimensions
+Image decodeRaw(const uint8_t *data, size_t size,
+    uint32_t width, uint32_t height, PixelFormat format);
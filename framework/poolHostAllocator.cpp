@@ -0,0 +1,230 @@
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include "poolHostAllocator.h"
+
+// Precedes each block, so that free() knows where block came from
+struct BlockHeader
+{
+    uint64_t size;
+    uint32_t offset; // From malloc() result if not pooled
+    uint8_t sizeClass;
+    uint8_t scope;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(BlockHeader) == 16, "header should keep blocks 16-byte aligned");
+
+constexpr size_t chunkSize = 64 * 1024;
+constexpr size_t minBlockSize = 16;
+constexpr size_t maxPooledAlignment = sizeof(BlockHeader);
+constexpr uint8_t notPooled = 0xFF;
+
+static uint32_t sizeClassIndex(size_t size) noexcept
+{
+    uint32_t index = 0;
+    for (size_t blockSize = minBlockSize; blockSize < size; blockSize <<= 1)
+        ++index;
+    return index;
+}
+
+static BlockHeader *getHeader(void *p) noexcept
+{
+    return reinterpret_cast<BlockHeader *>(p) - 1;
+}
+
+PoolHostAllocator::PoolHostAllocator()
+{
+    callbacks.pUserData = this;
+    callbacks.pfnAllocation = allocationFunction;
+    callbacks.pfnReallocation = reallocationFunction;
+    callbacks.pfnFree = freeFunction;
+    callbacks.pfnInternalAllocation = internalAllocationNotification;
+    callbacks.pfnInternalFree = internalFreeNotification;
+    for (Counters& scope : counters)
+    {
+        scope.allocations = 0;
+        scope.liveBytes = 0;
+        scope.peakBytes = 0;
+        scope.internalBytes = 0;
+    }
+}
+
+PoolHostAllocator::~PoolHostAllocator()
+{
+    for (SizeClass& sizeClass : sizeClasses)
+    {
+        for (void *chunk : sizeClass.chunks)
+            ::free(chunk);
+    }
+}
+
+PoolHostAllocator::ScopeStats PoolHostAllocator::getStats(VkSystemAllocationScope scope) const noexcept
+{
+    const Counters& counter = counters[scope];
+    return {counter.allocations, counter.liveBytes, counter.peakBytes, counter.internalBytes};
+}
+
+void PoolHostAllocator::printStatistics() const
+{
+    static const char *scopeNames[scopeCount] = {"command", "object", "cache", "device", "instance"};
+    for (uint32_t i = 0; i < scopeCount; ++i)
+    {
+        const ScopeStats stats = getStats(static_cast<VkSystemAllocationScope>(i));
+        if (!stats.allocations && !stats.internalBytes)
+            continue;
+        std::cout << "Host allocations in " << scopeNames[i] << " scope: " << stats.allocations
+            << ", " << stats.liveBytes << " bytes live, " << stats.peakBytes << " bytes peak";
+        if (stats.internalBytes)
+            std::cout << ", " << stats.internalBytes << " bytes internal";
+        std::cout << "\n";
+    }
+}
+
+void *PoolHostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope) noexcept
+{
+    if (!size)
+        return nullptr;
+    void *p;
+    const uint32_t sizeClass = sizeClassIndex(size);
+    if (sizeClass < sizeClassCount && alignment <= maxPooledAlignment)
+    {
+        p = allocateBlock(sizeClass);
+        if (!p)
+            return nullptr;
+        getHeader(p)->offset = 0;
+        getHeader(p)->sizeClass = static_cast<uint8_t>(sizeClass);
+    }
+    else
+    {   // Leave room for header in front of aligned block
+        alignment = std::max(alignment, maxPooledAlignment);
+        char *base = reinterpret_cast<char *>(malloc(size + alignment + sizeof(BlockHeader)));
+        if (!base)
+            return nullptr;
+        const uintptr_t address = reinterpret_cast<uintptr_t>(base + sizeof(BlockHeader));
+        p = reinterpret_cast<void *>((address + alignment - 1) & ~(alignment - 1));
+        getHeader(p)->offset = static_cast<uint32_t>(reinterpret_cast<char *>(p) - base);
+        getHeader(p)->sizeClass = notPooled;
+    }
+    getHeader(p)->size = size;
+    getHeader(p)->scope = static_cast<uint8_t>(scope);
+    ++counters[scope].allocations;
+    addLiveBytes(scope, size);
+    return p;
+}
+
+void *PoolHostAllocator::reallocate(void *original, size_t size, size_t alignment, VkSystemAllocationScope scope) noexcept
+{
+    if (!original)
+        return allocate(size, alignment, scope);
+    if (!size)
+    {
+        free(original);
+        return nullptr;
+    }
+    BlockHeader *header = getHeader(original);
+    if (header->sizeClass != notPooled &&
+        header->scope == scope &&
+        alignment <= maxPooledAlignment &&
+        size <= (minBlockSize << header->sizeClass))
+    {   // Still fits into the same block
+        counters[scope].liveBytes -= header->size;
+        addLiveBytes(scope, size);
+        header->size = size;
+        return original;
+    }
+    void *p = allocate(size, alignment, scope);
+    if (p)
+    {   // Original stays intact on failure
+        memcpy(p, original, std::min(static_cast<size_t>(header->size), size));
+        free(original);
+    }
+    return p;
+}
+
+void PoolHostAllocator::free(void *p) noexcept
+{
+    if (!p)
+        return;
+    BlockHeader *header = getHeader(p);
+    counters[header->scope].liveBytes -= header->size;
+    if (header->sizeClass != notPooled)
+    {
+        SizeClass& sizeClass = sizeClasses[header->sizeClass];
+        std::lock_guard<std::mutex> guard(sizeClass.lock);
+        *reinterpret_cast<void **>(header) = sizeClass.freeList;
+        sizeClass.freeList = header;
+    }
+    else
+    {
+        ::free(reinterpret_cast<char *>(p) - header->offset);
+    }
+}
+
+void *PoolHostAllocator::allocateBlock(uint32_t index) noexcept
+{
+    SizeClass& sizeClass = sizeClasses[index];
+    std::lock_guard<std::mutex> guard(sizeClass.lock);
+    if (!sizeClass.freeList)
+    {   // Carve new chunk into blocks, header is stored in front of each one
+        const size_t blockSize = sizeof(BlockHeader) + (minBlockSize << index);
+        char *chunk = reinterpret_cast<char *>(malloc(chunkSize));
+        if (!chunk)
+            return nullptr;
+        try
+        {
+            sizeClass.chunks.push_back(chunk);
+        }
+        catch (...)
+        {
+            ::free(chunk);
+            return nullptr;
+        }
+        for (size_t offset = 0; offset + blockSize <= chunkSize; offset += blockSize)
+        {
+            *reinterpret_cast<void **>(chunk + offset) = sizeClass.freeList;
+            sizeClass.freeList = chunk + offset;
+        }
+    }
+    BlockHeader *header = reinterpret_cast<BlockHeader *>(sizeClass.freeList);
+    sizeClass.freeList = *reinterpret_cast<void **>(header);
+    return header + 1;
+}
+
+void PoolHostAllocator::addLiveBytes(VkSystemAllocationScope scope, size_t size) noexcept
+{
+    Counters& counter = counters[scope];
+    const uint64_t live = (counter.liveBytes += size);
+    uint64_t peak = counter.peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !counter.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+}
+
+VKAPI_ATTR void *VKAPI_CALL PoolHostAllocator::allocationFunction(void *userData,
+    size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    return reinterpret_cast<PoolHostAllocator *>(userData)->allocate(size, alignment, scope);
+}
+
+VKAPI_ATTR void *VKAPI_CALL PoolHostAllocator::reallocationFunction(void *userData,
+    void *original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    return reinterpret_cast<PoolHostAllocator *>(userData)->reallocate(original, size, alignment, scope);
+}
+
+VKAPI_ATTR void VKAPI_CALL PoolHostAllocator::freeFunction(void *userData, void *memory)
+{
+    reinterpret_cast<PoolHostAllocator *>(userData)->free(memory);
+}
+
+VKAPI_ATTR void VKAPI_CALL PoolHostAllocator::internalAllocationNotification(void *userData,
+    size_t size, VkInternalAllocationType /* type */, VkSystemAllocationScope scope)
+{
+    reinterpret_cast<PoolHostAllocator *>(userData)->counters[scope].internalBytes += size;
+}
+
+VKAPI_ATTR void VKAPI_CALL PoolHostAllocator::internalFreeNotification(void *userData,
+    size_t size, VkInternalAllocationType /* type */, VkSystemAllocationScope scope)
+{
+    reinterpret_cast<PoolHostAllocator *>(userData)->counters[scope].internalBytes -= size;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <vulkan/vulkan.h>
+#include "nonCopyable.h"
+
+// Host allocator for Vulkan driver, passed as VkAllocationCallbacks.
+// Small allocations are served from per-size-class free lists carved from
+// 64K chunks, each class has its own lock so that threads creating objects
+// in parallel rarely contend. Allocations larger than 4K or aligned to
+// more than 16 bytes go to malloc(). Live and peak bytes are tracked per
+// allocation scope, including internal allocations reported by driver.
+class PoolHostAllocator : public NonCopyable
+{
+public:
+    struct ScopeStats
+    {
+        uint64_t allocations;
+        uint64_t liveBytes;
+        uint64_t peakBytes;
+        uint64_t internalBytes;
+    };
+
+    PoolHostAllocator();
+    ~PoolHostAllocator();
+    operator const VkAllocationCallbacks *() const noexcept
+        { return &callbacks; }
+    ScopeStats getStats(VkSystemAllocationScope scope) const noexcept;
+    void printStatistics() const;
+
+private:
+    struct SizeClass
+    {
+        std::mutex lock;
+        void *freeList = nullptr;
+        std::vector<void *> chunks;
+    };
+
+    struct Counters
+    {
+        std::atomic<uint64_t> allocations;
+        std::atomic<uint64_t> liveBytes;
+        std::atomic<uint64_t> peakBytes;
+        std::atomic<uint64_t> internalBytes;
+    };
+
+    void *allocate(size_t size, size_t alignment, VkSystemAllocationScope scope) noexcept;
+    void *reallocate(void *original, size_t size, size_t alignment, VkSystemAllocationScope scope) noexcept;
+    void free(void *p) noexcept;
+    void *allocateBlock(uint32_t sizeClass) noexcept;
+    void addLiveBytes(VkSystemAllocationScope scope, size_t size) noexcept;
+
+    static VKAPI_ATTR void *VKAPI_CALL allocationFunction(void *userData,
+        size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void *VKAPI_CALL reallocationFunction(void *userData,
+        void *original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void VKAPI_CALL freeFunction(void *userData, void *memory);
+    static VKAPI_ATTR void VKAPI_CALL internalAllocationNotification(void *userData,
+        size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void VKAPI_CALL internalFreeNotification(void *userData,
+        size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+    static constexpr uint32_t sizeClassCount = 9; // 16 to 4096 bytes
+    static constexpr uint32_t scopeCount = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+    VkAllocationCallbacks callbacks;
+    SizeClass sizeClasses[sizeClassCount];
+    Counters counters[scopeCount];
+};
@@ -0,0 +1,302 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <emmintrin.h>
+#include "softRasterizer.h"
+#include "threadPool.h"
+
+static constexpr int32_t subpixelScale = 1 << SoftRasterizer::subpixelBits;
+static constexpr int32_t halfPixel = subpixelScale / 2;
+static constexpr uint32_t vertexChunk = 4096;
+static constexpr uint32_t triangleChunk = 1024;
+static constexpr float nearW = 1e-5f;
+// Beyond this distance from viewport vertices are not representable in fixed point
+static constexpr float guardBand = 32768.f;
+
+SoftRasterizer::SoftRasterizer(uint32_t width, uint32_t height, ThreadPool *pool /* nullptr */):
+    width(width),
+    height(height),
+    pitch((width + 3) & ~3),
+    tilesX((width + tileSize - 1) / tileSize),
+    tilesY((height + tileSize - 1) / tileSize),
+    pool(pool),
+    mask(size_t(pitch) * height),
+    depth(size_t(pitch) * height)
+{
+    const uint32_t threadCount = pool ? pool->getThreadCount() : 1;
+    bins.resize(threadCount * tilesX * tilesY);
+    culled.resize(threadCount);
+    clear();
+}
+
+void SoftRasterizer::clear()
+{
+    std::fill(mask.begin(), mask.end(), uint8_t(0));
+    std::fill(depth.begin(), depth.end(), 1.f);
+}
+
+template<typename Task>
+void SoftRasterizer::forEach(uint32_t count, const Task& task)
+{
+    if (pool)
+        pool->parallelFor(count, task);
+    else
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            task(i, 0);
+    }
+}
+
+void SoftRasterizer::draw(const IndexedMesh& mesh, const float worldViewProj[16], RasterStats *stats /* nullptr */)
+{
+    const uint32_t vertexCount = mesh.getVertexCount();
+    const uint32_t triangleCount = mesh.getTriangleCount();
+    const size_t paddedCount = (vertexCount + 3) & ~3;
+    if (screenX.size() < paddedCount)
+    {
+        screenX.resize(paddedCount);
+        screenY.resize(paddedCount);
+        screenZ.resize(paddedCount);
+        clipW.resize(paddedCount);
+    }
+    forEach((vertexCount + vertexChunk - 1) / vertexChunk, [&](uint32_t chunk, uint32_t)
+    {
+        const uint32_t first = chunk * vertexChunk;
+        transformVertices(mesh.positions.data(), first, std::min(vertexChunk, vertexCount - first), worldViewProj);
+    });
+    triangles.resize(triangleCount);
+    valid.resize(triangleCount);
+    for (auto& bin : bins)
+        bin.clear();
+    std::fill(culled.begin(), culled.end(), 0);
+    const uint32_t tileCount = tilesX * tilesY;
+    forEach((triangleCount + triangleChunk - 1) / triangleChunk, [&](uint32_t chunk, uint32_t threadIndex)
+    {   // Every thread has its own set of bins, so no locking is needed
+        std::vector<uint32_t> *threadBins = &bins[threadIndex * tileCount];
+        const uint32_t last = std::min((chunk + 1) * triangleChunk, triangleCount);
+        for (uint32_t i = chunk * triangleChunk; i < last; ++i)
+        {
+            Triangle& triangle = triangles[i];
+            valid[i] = setupTriangle(&mesh.indices[i * 3], triangle);
+            if (!valid[i])
+            {
+                ++culled[threadIndex];
+                continue;
+            }
+            const uint32_t tileMinX = triangle.minX / tileSize, tileMaxX = triangle.maxX / tileSize;
+            const uint32_t tileMinY = triangle.minY / tileSize, tileMaxY = triangle.maxY / tileSize;
+            for (uint32_t ty = tileMinY; ty <= tileMaxY; ++ty)
+            {
+                for (uint32_t tx = tileMinX; tx <= tileMaxX; ++tx)
+                    threadBins[ty * tilesX + tx].push_back(i);
+            }
+        }
+    });
+    forEach(tileCount, [this](uint32_t tile, uint32_t)
+    {
+        rasterizeTile(tile);
+    });
+    if (stats)
+    {
+        stats->triangleCount += triangleCount;
+        for (uint32_t count : culled)
+            stats->culledTriangles += count;
+        for (const auto& bin : bins)
+            stats->binnedTriangles += static_cast<uint32_t>(bin.size());
+    }
+}
+
+void SoftRasterizer::copyMask(uint8_t *dst) const
+{
+    for (uint32_t y = 0; y < height; ++y)
+        memcpy(dst + size_t(y) * width, mask.data() + size_t(y) * pitch, width);
+}
+
+void SoftRasterizer::transformVertices(const rapid::float3 *positions, uint32_t first, uint32_t count, const float m[16])
+{
+    const __m128 halfWidth = _mm_set1_ps(width * .5f);
+    const __m128 halfHeight = _mm_set1_ps(height * .5f);
+    const __m128 minW = _mm_set1_ps(nearW);
+    for (uint32_t i = first; i < first + count; i += 4)
+    {   // Gather four positions, last group may read less
+        float x[4] = {0.f}, y[4] = {0.f}, z[4] = {0.f};
+        for (uint32_t j = 0; j < 4 && i + j < first + count; ++j)
+        {
+            x[j] = positions[i + j].x;
+            y[j] = positions[i + j].y;
+            z[j] = positions[i + j].z;
+        }
+        const __m128 px = _mm_loadu_ps(x), py = _mm_loadu_ps(y), pz = _mm_loadu_ps(z);
+        __m128 clip[4];
+        for (uint32_t c = 0; c < 4; ++c)
+        {   // Column c of row-major matrix
+            clip[c] = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(px, _mm_set1_ps(m[c])),
+                _mm_mul_ps(py, _mm_set1_ps(m[4 + c]))), _mm_add_ps(
+                _mm_mul_ps(pz, _mm_set1_ps(m[8 + c])),
+                _mm_set1_ps(m[12 + c])));
+        }
+        // Vertices behind near plane get garbage, their triangles are dropped by W test
+        const __m128 invW = _mm_div_ps(_mm_set1_ps(1.f), _mm_max_ps(clip[3], minW));
+        const __m128 sx = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(clip[0], invW), _mm_set1_ps(1.f)), halfWidth);
+        const __m128 sy = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.f), _mm_mul_ps(clip[1], invW)), halfHeight);
+        _mm_store_ps(&screenX[i], sx);
+        _mm_store_ps(&screenY[i], sy);
+        _mm_store_ps(&screenZ[i], _mm_mul_ps(clip[2], invW));
+        _mm_store_ps(&clipW[i], clip[3]);
+    }
+}
+
+bool SoftRasterizer::setupTriangle(const uint32_t *face, Triangle& triangle) const
+{
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const uint32_t v = face[i];
+        if (clipW[v] <= nearW || screenZ[v] < 0.f)
+            return false;
+        if (std::fabs(screenX[v]) > guardBand || std::fabs(screenY[v]) > guardBand)
+            return false;
+        triangle.x[i] = static_cast<int32_t>(std::lround(screenX[v] * subpixelScale));
+        triangle.y[i] = static_cast<int32_t>(std::lround(screenY[v] * subpixelScale));
+    }
+    const int64_t dx1 = triangle.x[1] - triangle.x[0], dy1 = triangle.y[1] - triangle.y[0];
+    const int64_t dx2 = triangle.x[2] - triangle.x[0], dy2 = triangle.y[2] - triangle.y[0];
+    const int64_t area = dx1 * dy2 - dx2 * dy1;
+    if (area <= 0)
+        return false; // Back-facing or degenerate
+    // Range of pixels which centers are inside of bounding box
+    const int32_t minX = std::min({triangle.x[0], triangle.x[1], triangle.x[2]});
+    const int32_t minY = std::min({triangle.y[0], triangle.y[1], triangle.y[2]});
+    const int32_t maxX = std::max({triangle.x[0], triangle.x[1], triangle.x[2]});
+    const int32_t maxY = std::max({triangle.y[0], triangle.y[1], triangle.y[2]});
+    triangle.minX = std::max(0, (minX - halfPixel + subpixelScale - 1) >> subpixelBits);
+    triangle.minY = std::max(0, (minY - halfPixel + subpixelScale - 1) >> subpixelBits);
+    triangle.maxX = std::min(int32_t(width) - 1, (maxX - halfPixel) >> subpixelBits);
+    triangle.maxY = std::min(int32_t(height) - 1, (maxY - halfPixel) >> subpixelBits);
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return false;
+    // Z/W is linear in screen space
+    const float z0 = screenZ[face[0]];
+    const float dz1 = screenZ[face[1]] - z0, dz2 = screenZ[face[2]] - z0;
+    const float scale = float(subpixelScale) / float(area);
+    triangle.z0 = z0;
+    triangle.dzdx = (dz1 * dy2 - dz2 * dy1) * scale;
+    triangle.dzdy = (dx1 * dz2 - dx2 * dz1) * scale;
+    return true;
+}
+
+void SoftRasterizer::rasterizeTile(uint32_t tile)
+{
+    const int32_t tileX = (tile % tilesX) * tileSize;
+    const int32_t tileY = (tile / tilesX) * tileSize;
+    const int32_t tileMaxX = std::min(tileX + int32_t(tileSize), int32_t(width)) - 1;
+    const int32_t tileMaxY = std::min(tileY + int32_t(tileSize), int32_t(height)) - 1;
+    const uint32_t tileCount = tilesX * tilesY;
+    for (uint32_t t = 0; t < bins.size() / tileCount; ++t)
+    {
+        for (uint32_t i : bins[t * tileCount + tile])
+        {
+            const Triangle& triangle = triangles[i];
+            rasterizeTriangle(triangle,
+                std::max(triangle.minX, tileX), std::max(triangle.minY, tileY),
+                std::min(triangle.maxX, tileMaxX), std::min(triangle.maxY, tileMaxY));
+        }
+    }
+}
+
+void SoftRasterizer::rasterizeTriangle(const Triangle& triangle, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY)
+{   // Start at multiple of four, so that vectors never cross tile or row boundary
+    const int32_t startX = minX & ~3;
+    const int64_t sampleX = int64_t(startX) * subpixelScale + halfPixel;
+    const int64_t sampleY = int64_t(minY) * subpixelScale + halfPixel;
+    int64_t edgeRow[3];
+    int32_t stepX[3], stepY[3];
+    int64_t range = 0;
+    for (uint32_t e = 0; e < 3; ++e)
+    {   // Inside is positive, ties belong to top and left edges
+        const uint32_t next = (e + 1) % 3;
+        const int32_t dx = triangle.x[next] - triangle.x[e];
+        const int32_t dy = triangle.y[next] - triangle.y[e];
+        const bool topLeft = dy < 0 || (0 == dy && dx > 0);
+        edgeRow[e] = int64_t(dx) * (sampleY - triangle.y[e]) - int64_t(dy) * (sampleX - triangle.x[e]) - (topLeft ? 0 : 1);
+        stepX[e] = -dy * subpixelScale;
+        stepY[e] = dx * subpixelScale;
+        const int64_t e0 = std::abs(edgeRow[e]);
+        const int64_t delta = std::abs(int64_t(stepX[e])) * (maxX - startX + 4) + std::abs(int64_t(stepY[e])) * (maxY - minY + 1);
+        range = std::max(range, e0 + delta);
+    }
+    const float zRow = triangle.z0 +
+        triangle.dzdx * (float(sampleX - triangle.x[0]) / subpixelScale) +
+        triangle.dzdy * (float(sampleY - triangle.y[0]) / subpixelScale);
+    if (range >= INT32_MAX)
+    {   // Huge triangle, evaluate scalar in 64 bits
+        for (int32_t y = minY; y <= maxY; ++y)
+        {
+            const int32_t dy = y - minY;
+            uint8_t *maskRow = &mask[size_t(y) * pitch];
+            float *depthRow = &depth[size_t(y) * pitch];
+            for (int32_t x = minX; x <= maxX; ++x)
+            {
+                const int32_t dx = x - startX;
+                bool inside = true;
+                for (uint32_t e = 0; e < 3; ++e)
+                    inside &= edgeRow[e] + int64_t(stepX[e]) * dx + int64_t(stepY[e]) * dy >= 0;
+                const float z = zRow + triangle.dzdx * dx + triangle.dzdy * dy;
+                if (inside && z <= depthRow[x])
+                {
+                    depthRow[x] = z;
+                    maskRow[x] = 255;
+                }
+            }
+        }
+        return;
+    }
+    const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i edgeStart[3], edgeStep[3];
+    for (uint32_t e = 0; e < 3; ++e)
+    {
+        const __m128i step = _mm_set1_epi32(stepX[e]);
+        // Multiplication by 0..3 without SSE4.1
+        const __m128i offsets = _mm_setr_epi32(0, stepX[e], stepX[e] * 2, stepX[e] * 3);
+        edgeStart[e] = _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(edgeRow[e])), offsets);
+        edgeStep[e] = _mm_slli_epi32(step, 2);
+    }
+    const __m128 zOffsets = _mm_mul_ps(_mm_set1_ps(triangle.dzdx), _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+    const __m128 zStep = _mm_set1_ps(triangle.dzdx * 4.f);
+    const __m128i firstX = _mm_set1_epi32(minX - 1);
+    const __m128i lastX = _mm_set1_epi32(maxX + 1);
+    for (int32_t y = minY; y <= maxY; ++y)
+    {
+        const int32_t dy = y - minY;
+        __m128i e0 = _mm_add_epi32(edgeStart[0], _mm_set1_epi32(stepY[0] * dy));
+        __m128i e1 = _mm_add_epi32(edgeStart[1], _mm_set1_epi32(stepY[1] * dy));
+        __m128i e2 = _mm_add_epi32(edgeStart[2], _mm_set1_epi32(stepY[2] * dy));
+        __m128 z = _mm_add_ps(_mm_set1_ps(zRow + triangle.dzdy * dy), zOffsets);
+        uint8_t *maskRow = &mask[size_t(y) * pitch];
+        float *depthRow = &depth[size_t(y) * pitch];
+        for (int32_t x = startX; x <= maxX; x += 4)
+        {
+            const __m128i px = _mm_add_epi32(_mm_set1_epi32(x), lane);
+            const __m128i inRange = _mm_and_si128(_mm_cmpgt_epi32(px, firstX), _mm_cmplt_epi32(px, lastX));
+            // Sign bit is set if any edge function is negative
+            const __m128i outside = _mm_srai_epi32(_mm_or_si128(_mm_or_si128(e0, e1), e2), 31);
+            const __m128 oldZ = _mm_load_ps(depthRow + x);
+            const __m128 pass = _mm_and_ps(_mm_cmple_ps(z, oldZ), _mm_castsi128_ps(_mm_andnot_si128(outside, inRange)));
+            if (_mm_movemask_ps(pass))
+            {
+                _mm_store_ps(depthRow + x, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, oldZ)));
+                // 32-bit lanes to bytes, 0xFF where covered
+                const __m128i words = _mm_packs_epi32(_mm_castps_si128(pass), _mm_castps_si128(pass));
+                const uint32_t bytes = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packs_epi16(words, words)));
+                uint32_t pixels;
+                memcpy(&pixels, maskRow + x, sizeof(pixels));
+                pixels |= bytes;
+                memcpy(maskRow + x, &pixels, sizeof(pixels));
+            }
+            e0 = _mm_add_epi32(e0, edgeStep[0]);
+            e1 = _mm_add_epi32(e1, edgeStep[1]);
+            e2 = _mm_add_epi32(e2, edgeStep[2]);
+            z = _mm_add_ps(z, zStep);
+        }
+    }
+}
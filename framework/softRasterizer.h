@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "alignedAllocator.h"
+#include "indexedMesh.h"
+#include "nonCopyable.h"
+
+class ThreadPool;
+
+struct RasterStats
+{
+    uint32_t triangleCount = 0;
+    uint32_t culledTriangles = 0; // Back-facing, degenerate, off-screen or crossing near plane
+    uint32_t binnedTriangles = 0; // Sum of triangles over all tiles
+};
+
+// CPU replacement of the mask pass for nodes without Vulkan. Vertices are
+// transformed four at a time, triangles are set up in 28.4 fixed point and
+// binned into screen tiles, then tiles are rasterized in parallel with
+// half-space edge functions, top-left fill rule and LessOrEqual depth test.
+// Covered pixels of the R8 mask are set to 255, as fill.frag writes 1.0.
+class SoftRasterizer : public NonCopyable
+{
+public:
+    static constexpr uint32_t tileSize = 64;
+    static constexpr uint32_t subpixelBits = 4;
+
+    SoftRasterizer(uint32_t width, uint32_t height, ThreadPool *pool = nullptr);
+    // Sets mask to zero and depth to one
+    void clear();
+    // Matrix is row-major and transforms row vectors, as rapid::matrix, clip space Y
+    // is flipped as in transform.vert. Triangles are expected to be clockwise when
+    // front-facing, back faces are culled. Triangles crossing near plane are dropped.
+    void draw(const IndexedMesh& mesh, const float worldViewProj[16], RasterStats *stats = nullptr);
+    uint32_t getWidth() const noexcept { return width; }
+    uint32_t getHeight() const noexcept { return height; }
+    // Rows are padded to multiple of four pixels
+    uint32_t getPitch() const noexcept { return pitch; }
+    const uint8_t *getMask() const noexcept { return mask.data(); }
+    const float *getDepth() const noexcept { return depth.data(); }
+    // Writes tightly packed mask
+    void copyMask(uint8_t *dst) const;
+
+private:
+    struct Triangle
+    {
+        int32_t x[3], y[3]; // Fixed point
+        float z0, dzdx, dzdy; // Depth plane in pixel units relative to first vertex
+        int32_t minX, minY, maxX, maxY; // Pixels which centers may be covered
+    };
+
+    typedef std::vector<float, utilities::aligned_allocator<float>> Stream;
+
+    template<typename Task>
+    void forEach(uint32_t count, const Task& task);
+    void transformVertices(const rapid::float3 *positions, uint32_t first, uint32_t count, const float m[16]);
+    bool setupTriangle(const uint32_t *face, Triangle& triangle) const;
+    void rasterizeTile(uint32_t tile);
+    void rasterizeTriangle(const Triangle& triangle, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY);
+
+    const uint32_t width;
+    const uint32_t height;
+    const uint32_t pitch;
+    const uint32_t tilesX;
+    const uint32_t tilesY;
+    ThreadPool *pool;
+    std::vector<uint8_t, utilities::aligned_allocator<uint8_t>> mask;
+    Stream depth;
+    Stream screenX, screenY, screenZ, clipW;
+    std::vector<Triangle> triangles;
+    std::vector<uint8_t> valid;
+    std::vector<std::vector<uint32_t>> bins; // Per thread, per tile
+    std::vector<uint32_t> culled; // Per thread
+};
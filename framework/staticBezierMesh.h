@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+
+// Compile-time counterpart of tessellateBezierPatches() for built-in patch tables.
+// Declare result as constexpr variable, so that vertex data is placed in read-only
+// section and can be copied to staging buffers without any evaluation at startup:
+//
+// alignas(16) static constexpr StaticPatchMesh<kTeapotNumPatches, 8> teapotMesh =
+//     tessellateStaticPatches<8>(teapotPatches, teapotVertices);
+//
+// Vertex cache order and culling bounds are baked as well, so that startup does no
+// work per patch. Evaluation cost grows with square of degree, MSVC may need larger
+// /constexpr:steps.
+template<uint32_t NumPatches, uint32_t Degree>
+struct StaticPatchMesh
+{
+    static_assert(Degree >= 2 && Degree <= 32, "subdivision degree is out of range");
+    static constexpr uint32_t numPatches = NumPatches;
+    static constexpr uint32_t subdivisionDegree = Degree;
+    static constexpr uint32_t gridVertexCount = (Degree + 1) * (Degree + 1);
+    static constexpr uint32_t vertexCount = NumPatches * gridVertexCount;
+    static constexpr uint32_t indexCount = Degree * Degree * 6;
+
+    // Same layout as evalPatchGrid() writes, patch after patch
+    alignas(16) float positions[vertexCount][3];
+    alignas(16) float normals[vertexCount][3];
+    alignas(16) float texCoords[vertexCount][2];
+    // Grid topology shared by all patches, as in triangulatePatchGrid(),
+    // with triangles reordered as optimizeVertexCache() does
+    alignas(16) uint16_t indices[indexCount];
+    // Culling bounds of each patch in layout of PatchBounds::pack()
+    alignas(16) float bounds[NumPatches][8];
+};
+
+// Non-template view of static mesh to pass it to BezierPatchMesh
+struct PatchMeshData
+{
+    const float (*positions)[3];
+    const float (*normals)[3];
+    const float (*texCoords)[2];
+    const uint16_t *indices;
+    const float (*bounds)[8];
+    uint32_t numPatches;
+    uint32_t subdivisionDegree;
+};
+
+template<uint32_t NumPatches, uint32_t Degree>
+inline PatchMeshData getPatchMeshData(const StaticPatchMesh<NumPatches, Degree>& mesh) noexcept
+{
+    return PatchMeshData{mesh.positions, mesh.normals, mesh.texCoords, mesh.indices, mesh.bounds, NumPatches, Degree};
+}
+
+#include "staticBezierMesh.inl"
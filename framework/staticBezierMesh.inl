@@ -0,0 +1,373 @@
+// Helpers have to be constexpr, so neither rapid nor <cmath> can be used here
+struct StaticBezier
+{
+    struct Vec3
+    {
+        float x, y, z;
+    };
+
+    static constexpr Vec3 madd(const Vec3& a, float s, const Vec3& b) noexcept
+    {
+        return Vec3{a.x + s * b.x, a.y + s * b.y, a.z + s * b.z};
+    }
+
+    static constexpr Vec3 cross(const Vec3& a, const Vec3& b) noexcept
+    {
+        return Vec3{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    }
+
+    static constexpr float dot(const Vec3& a, const Vec3& b) noexcept
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    static constexpr float sqrt(float x) noexcept
+    {   // Scale to [1, 4) by powers of four, so that few Newton iterations are needed,
+        // they decrease monotonically from (1 + m) / 2 which is not less than root
+        if (x <= 0.f)
+            return 0.f;
+        double m = x, scale = 1.;
+        for (; m >= 4.; m *= .25)
+            scale *= 2.;
+        for (; m < 1.; m *= 4.)
+            scale *= .5;
+        double y = .5 * (1. + m);
+        for (int i = 0; i < 16; ++i)
+        {
+            const double next = .5 * (y + m / y);
+            if (next >= y)
+                break;
+            y = next;
+        }
+        return static_cast<float>(y * scale);
+    }
+
+    // Cubic Bernstein basis and its derivative, as in bezier.inl
+    static constexpr void basis(float t, float b[4], float d[4]) noexcept
+    {
+        const float s = 1.f - t;
+        b[0] = s * s * s;
+        b[1] = 3.f * t * s * s;
+        b[2] = 3.f * t * t * s;
+        b[3] = t * t * t;
+        d[0] = -3.f * s * s;
+        d[1] = 3.f * s * s - 6.f * t * s;
+        d[2] = 6.f * t * s - 3.f * t * t;
+        d[3] = 3.f * t * t;
+    }
+
+    static constexpr float min(float a, float b) noexcept { return a < b ? a : b; }
+    static constexpr float max(float a, float b) noexcept { return a > b ? a : b; }
+
+    // Partial derivatives at (u, v), points are in row-major order along u
+    static constexpr void tangents(const Vec3 cp[16], float u, float v, Vec3& dU, Vec3& dV) noexcept
+    {
+        float bu[4] = {}, du[4] = {}, bv[4] = {}, dv[4] = {};
+        basis(u, bu, du);
+        basis(v, bv, dv);
+        dU = dV = Vec3{0.f, 0.f, 0.f};
+        for (int j = 0; j < 4; ++j)
+        {
+            for (int k = 0; k < 4; ++k)
+            {
+                dU = madd(dU, du[k] * bv[j], cp[j * 4 + k]);
+                dV = madd(dV, bu[k] * dv[j], cp[j * 4 + k]);
+            }
+        }
+    }
+};
+
+// Same weights and cache size as optimizeVertexCache() defaults, scores are
+// tabulated once as pow() is not constexpr and this runs for every triangle
+struct StaticVertexCache
+{
+    static constexpr uint32_t cacheSize = 32;
+    static constexpr uint32_t maxValence = 8; // Grid vertex has at most 6 triangles
+
+    float decay[cacheSize] = {};
+    float valenceBoost[maxValence + 1] = {};
+
+    constexpr StaticVertexCache() noexcept
+    {
+        for (uint32_t i = 0; i < cacheSize; ++i)
+        {   // Used by the last triangle has fixed score, otherwise decay power is 1.5
+            const float x = 1.f - (i - 3.f) / float(cacheSize - 3);
+            decay[i] = i < 3 ? .75f : x * StaticBezier::sqrt(x);
+        }
+        for (uint32_t i = 1; i <= maxValence; ++i)
+            valenceBoost[i] = 2.f / StaticBezier::sqrt(static_cast<float>(i)); // Power 0.5
+    }
+
+    constexpr float score(int32_t cachePosition, uint32_t activeTriangles) const noexcept
+    {
+        if (0 == activeTriangles)
+            return -1.f;
+        return (cachePosition >= 0 ? decay[cachePosition] : 0.f) + valenceBoost[activeTriangles];
+    }
+};
+
+// Compile-time counterpart of optimizeVertexCache() for patch grid
+template<uint32_t Degree>
+constexpr void optimizeStaticGrid(uint16_t *indices)
+{
+    constexpr uint32_t vertexCount = (Degree + 1) * (Degree + 1);
+    constexpr uint32_t triangleCount = Degree * Degree * 2;
+    constexpr uint32_t cacheSize = StaticVertexCache::cacheSize;
+    const StaticVertexCache scores;
+    uint32_t activeCount[vertexCount] = {};
+    for (uint32_t i = 0; i < triangleCount * 3; ++i)
+        ++activeCount[indices[i]];
+    uint32_t offsets[vertexCount + 1] = {};
+    uint32_t fill[vertexCount] = {};
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        offsets[v + 1] = offsets[v] + activeCount[v];
+        fill[v] = offsets[v];
+    }
+    uint32_t adjacency[triangleCount * 3] = {};
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        for (uint32_t k = 0; k < 3; ++k)
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+    }
+    int32_t cachePosition[vertexCount] = {};
+    float vertexScores[vertexCount] = {};
+    uint32_t visited[vertexCount] = {}; // Step at which vertex was put to new cache, plus one
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        cachePosition[v] = -1;
+        vertexScores[v] = scores.score(-1, activeCount[v]);
+    }
+    float triangleScores[triangleCount] = {};
+    bool emitted[triangleCount] = {};
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        const uint16_t *tri = indices + t * 3;
+        triangleScores[t] = vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+    }
+    uint32_t cache[cacheSize + 3] = {}, newCache[cacheSize + 3] = {};
+    uint32_t cacheCount = 0;
+    uint16_t output[triangleCount * 3] = {};
+    uint32_t bestTriangle = UINT32_MAX;
+    for (uint32_t n = 0; n < triangleCount; ++n)
+    {
+        if (UINT32_MAX == bestTriangle)
+        {   // Nothing in cache has triangles left, start from the best one overall
+            float bestScore = -1.f;
+            for (uint32_t t = 0; t < triangleCount; ++t)
+            {
+                if (!emitted[t] && triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+        const uint16_t *tri = indices + bestTriangle * 3;
+        for (uint32_t k = 0; k < 3; ++k)
+            output[n * 3 + k] = tri[k];
+        emitted[bestTriangle] = true;
+        uint32_t newCount = 0;
+        for (uint32_t k = 0; k < 3; ++k)
+        {   // Remove emitted triangle from active ones
+            const uint32_t v = tri[k];
+            const uint32_t last = offsets[v] + activeCount[v] - 1;
+            uint32_t i = offsets[v];
+            while (adjacency[i] != bestTriangle)
+                ++i;
+            adjacency[i] = adjacency[last];
+            adjacency[last] = bestTriangle;
+            --activeCount[v];
+            if (visited[v] != n + 1)
+            {
+                visited[v] = n + 1;
+                newCache[newCount++] = v;
+            }
+        }
+        for (uint32_t c = 0; c < cacheCount; ++c)
+        {
+            if (visited[cache[c]] != n + 1)
+            {
+                visited[cache[c]] = n + 1;
+                newCache[newCount++] = cache[c];
+            }
+        }
+        // Vertices past the cache size are dropped, their scores updated too
+        for (uint32_t i = 0; i < newCount; ++i)
+        {
+            const uint32_t v = newCache[i];
+            cachePosition[v] = i < cacheSize ? static_cast<int32_t>(i) : -1;
+            vertexScores[v] = scores.score(cachePosition[v], activeCount[v]);
+        }
+        bestTriangle = UINT32_MAX;
+        float bestScore = -1.f;
+        for (uint32_t c = 0; c < newCount; ++c)
+        {
+            const uint32_t v = newCache[c];
+            for (uint32_t i = offsets[v], end = offsets[v] + activeCount[v]; i < end; ++i)
+            {
+                const uint32_t t = adjacency[i];
+                const uint16_t *adj = indices + t * 3;
+                const float score = vertexScores[adj[0]] + vertexScores[adj[1]] + vertexScores[adj[2]];
+                triangleScores[t] = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+        cacheCount = newCount < cacheSize ? newCount : cacheSize;
+        for (uint32_t c = 0; c < cacheCount; ++c)
+            cache[c] = newCache[c];
+    }
+    for (uint32_t i = 0; i < triangleCount * 3; ++i)
+        indices[i] = output[i];
+}
+
+// Compile-time counterpart of PatchBounds::addPatch(), writes bounds as PatchBounds::pack() does
+template<uint32_t Degree>
+constexpr void staticPatchBounds(const float (*positions)[3], const uint16_t *indices, float *bounds)
+{
+    typedef StaticBezier::Vec3 Vec3;
+    constexpr uint32_t vertexCount = (Degree + 1) * (Degree + 1);
+    constexpr uint32_t indexCount = Degree * Degree * 6;
+    // Sphere around center of AABB
+    Vec3 lo{positions[0][0], positions[0][1], positions[0][2]}, hi = lo;
+    for (uint32_t i = 1; i < vertexCount; ++i)
+    {
+        const float *p = positions[i];
+        lo = Vec3{StaticBezier::min(lo.x, p[0]), StaticBezier::min(lo.y, p[1]), StaticBezier::min(lo.z, p[2])};
+        hi = Vec3{StaticBezier::max(hi.x, p[0]), StaticBezier::max(hi.y, p[1]), StaticBezier::max(hi.z, p[2])};
+    }
+    const Vec3 center{(lo.x + hi.x) * .5f, (lo.y + hi.y) * .5f, (lo.z + hi.z) * .5f};
+    float radiusSq = 0.f;
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        const Vec3 d{positions[i][0] - center.x, positions[i][1] - center.y, positions[i][2] - center.z};
+        radiusSq = StaticBezier::max(radiusSq, StaticBezier::dot(d, d));
+    }
+    // Normal cone of front faces
+    Vec3 normals[indexCount / 3] = {};
+    uint32_t normalCount = 0;
+    Vec3 axis{0.f, 0.f, 0.f};
+    for (uint32_t i = 0; i < indexCount; i += 3)
+    {
+        const float *a = positions[indices[i]];
+        const float *b = positions[indices[i + 1]];
+        const float *c = positions[indices[i + 2]];
+        const Vec3 e1{c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        const Vec3 e2{b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        const Vec3 n = StaticBezier::cross(e1, e2);
+        const float length = StaticBezier::sqrt(StaticBezier::dot(n, n));
+        if (length < 1e-12f)
+            continue; // Degenerate triangle at pole
+        normals[normalCount++] = Vec3{n.x / length, n.y / length, n.z / length};
+        axis = StaticBezier::madd(axis, 1.f, normals[normalCount - 1]);
+    }
+    const float axisLength = StaticBezier::sqrt(StaticBezier::dot(axis, axis));
+    float coneCutoff = 2.f; // Never culled
+    if (axisLength > 0.f)
+    {
+        axis = Vec3{axis.x / axisLength, axis.y / axisLength, axis.z / axisLength};
+        float minDot = 1.f;
+        for (uint32_t i = 0; i < normalCount; ++i)
+            minDot = StaticBezier::min(minDot, StaticBezier::dot(normals[i], axis));
+        if (minDot > 0.f) // Cone is narrower than hemisphere
+            coneCutoff = StaticBezier::sqrt(1.f - minDot * minDot);
+    }
+    bounds[0] = center.x;
+    bounds[1] = center.y;
+    bounds[2] = center.z;
+    bounds[3] = StaticBezier::sqrt(radiusSq);
+    bounds[4] = axis.x;
+    bounds[5] = axis.y;
+    bounds[6] = axis.z;
+    bounds[7] = coneCutoff;
+}
+
+template<uint32_t Degree, uint32_t NumPatches, uint32_t NumVertices>
+constexpr StaticPatchMesh<NumPatches, Degree> tessellateStaticPatches(
+    const uint32_t (&patches)[NumPatches][16],
+    const float (&patchVertices)[NumVertices][3])
+{
+    typedef StaticBezier::Vec3 Vec3;
+    StaticPatchMesh<NumPatches, Degree> mesh{};
+    uint32_t k = 0;
+    for (uint32_t np = 0; np < NumPatches; ++np)
+    {
+        Vec3 cp[16] = {};
+        for (uint32_t i = 0; i < 16; ++i)
+        {   // Patch indices are one-based
+            const float *p = patchVertices[patches[np][i] - 1];
+            cp[i] = Vec3{p[0], p[1], p[2]};
+        }
+        for (uint32_t j = 0; j <= Degree; ++j)
+        {
+            const float v = j / (float)Degree;
+            float bv[4] = {}, dv[4] = {};
+            StaticBezier::basis(v, bv, dv);
+            // Collapse rows into curve along u and its derivative along v
+            Vec3 curve[4] = {}, dCurve[4] = {};
+            for (int c = 0; c < 4; ++c)
+            {
+                for (int r = 0; r < 4; ++r)
+                {
+                    curve[c] = StaticBezier::madd(curve[c], bv[r], cp[r * 4 + c]);
+                    dCurve[c] = StaticBezier::madd(dCurve[c], dv[r], cp[r * 4 + c]);
+                }
+            }
+            for (uint32_t i = 0; i <= Degree; ++i, ++k)
+            {
+                const float u = i / (float)Degree;
+                float bu[4] = {}, du[4] = {};
+                StaticBezier::basis(u, bu, du);
+                Vec3 P{0.f, 0.f, 0.f}, dU{0.f, 0.f, 0.f}, dV{0.f, 0.f, 0.f};
+                for (int c = 0; c < 4; ++c)
+                {
+                    P = StaticBezier::madd(P, bu[c], curve[c]);
+                    dU = StaticBezier::madd(dU, du[c], curve[c]);
+                    dV = StaticBezier::madd(dV, bu[c], dCurve[c]);
+                }
+                Vec3 N = StaticBezier::cross(dU, dV);
+                if (StaticBezier::dot(N, N) < 1e-12f)
+                {   // Collapsed edge at pole, take normal slightly inside the patch
+                    StaticBezier::tangents(cp, u + (.5f - u) * 1e-3f, v + (.5f - v) * 1e-3f, dU, dV);
+                    N = StaticBezier::cross(dU, dV);
+                }
+                const float length = StaticBezier::sqrt(StaticBezier::dot(N, N));
+                // Swap Y and Z component to match coordinate system
+                mesh.positions[k][0] = P.x;
+                mesh.positions[k][1] = P.z;
+                mesh.positions[k][2] = P.y;
+                mesh.normals[k][0] = N.x / length;
+                mesh.normals[k][1] = N.z / length;
+                mesh.normals[k][2] = N.y / length;
+                mesh.texCoords[k][0] = u;
+                mesh.texCoords[k][1] = v;
+            }
+        }
+    }
+    uint32_t n = 0;
+    for (uint32_t j = 0; j < Degree; ++j)
+    {
+        for (uint32_t i = 0; i < Degree; ++i)
+        {
+            const uint16_t quad[4] = {
+                static_cast<uint16_t>((Degree + 1) * j + i),
+                static_cast<uint16_t>((Degree + 1) * j + i + 1),
+                static_cast<uint16_t>((Degree + 1) * (j + 1) + i + 1),
+                static_cast<uint16_t>((Degree + 1) * (j + 1) + i)};
+            for (uint32_t t = 0; t < 2; ++t)
+            {
+                mesh.indices[n++] = quad[0];
+                mesh.indices[n++] = quad[t + 1];
+                mesh.indices[n++] = quad[t + 2];
+            }
+        }
+    }
+    optimizeStaticGrid<Degree>(mesh.indices);
+    for (uint32_t np = 0; np < NumPatches; ++np)
+        staticPatchBounds<Degree>(mesh.positions + np * mesh.gridVertexCount, mesh.indices, mesh.bounds[np]);
+    return mesh;
+}
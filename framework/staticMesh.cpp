@@ -0,0 +1,81 @@
+#include <cstring>
+#include "staticMesh.h"
+#include "../magma/magma.h"
+
+static std::shared_ptr<magma::SrcTransferBuffer> copyToTransferBuffer(std::shared_ptr<magma::Device> device,
+    const std::vector<uint8_t>& data)
+{
+    std::shared_ptr<magma::SrcTransferBuffer> srcBuffer(std::make_shared<magma::SrcTransferBuffer>(device, data.size()));
+    magma::helpers::mapScoped<uint8_t>(srcBuffer, [&data](uint8_t *dst)
+    {
+        memcpy(dst, data.data(), data.size());
+    });
+    return srcBuffer;
+}
+
+static VkFormat getPositionFormat(PositionFormat format)
+{
+    return PositionFormat::Unorm16 == format ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT;
+}
+
+static VkFormat getNormalFormat(NormalFormat format)
+{
+    switch (format)
+    {
+    case NormalFormat::Octahedral16: return VK_FORMAT_R16G16_SNORM;
+    case NormalFormat::Unorm1010102: return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+    default: return VK_FORMAT_R32G32B32_SFLOAT;
+    }
+}
+
+static VkFormat getTexCoordFormat(TexCoordFormat format)
+{
+    return TexCoordFormat::Unorm16 == format ? VK_FORMAT_R16G16_UNORM : VK_FORMAT_R32G32_SFLOAT;
+}
+
+StaticMesh::StaticMesh(const IndexedMesh& mesh,
+    std::shared_ptr<magma::CommandBuffer> cmdBuffer):
+    StaticMesh(packMesh(mesh, VertexFormat()), cmdBuffer)
+{}
+
+StaticMesh::StaticMesh(const PackedMesh& mesh,
+    std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+{
+    std::shared_ptr<magma::Device> device = cmdBuffer->getDevice();
+    const VertexFormat& format = mesh.format;
+    std::vector<magma::VertexInputBinding> bindings;
+    std::vector<magma::VertexInputAttribute> attributes;
+    vertexBuffer = std::make_shared<magma::VertexBuffer>(cmdBuffer, copyToTransferBuffer(device, mesh.positions));
+    bindings.push_back(magma::VertexInputBinding(0, format.getPositionSize()));
+    attributes.push_back(magma::VertexInputAttribute(0, 0, getPositionFormat(format.position), 0));
+    normalBuffer = std::make_shared<magma::VertexBuffer>(cmdBuffer, copyToTransferBuffer(device, mesh.normals));
+    bindings.push_back(magma::VertexInputBinding(1, format.getNormalSize()));
+    attributes.push_back(magma::VertexInputAttribute(1, 1, getNormalFormat(format.normal), 0));
+    if (format.texCoord != TexCoordFormat::Implicit)
+    {   // Without this attribute mesh may only be drawn with shaders that don't declare location 2
+        texCoordBuffer = std::make_shared<magma::VertexBuffer>(cmdBuffer, copyToTransferBuffer(device, mesh.texCoords));
+        bindings.push_back(magma::VertexInputBinding(2, format.getTexCoordSize()));
+        attributes.push_back(magma::VertexInputAttribute(2, 2, getTexCoordFormat(format.texCoord), 0));
+    }
+    vertexInput = std::make_unique<magma::VertexInputState>(bindings, attributes);
+    indexBuffer = std::make_shared<magma::IndexBuffer>(cmdBuffer, copyToTransferBuffer(device, mesh.indices),
+        sizeof(uint16_t) == mesh.indexSize ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+}
+
+StaticMesh::~StaticMesh()
+{}
+
+void StaticMesh::draw(magma::CommandBuffer& cmdBuffer) const
+{
+    cmdBuffer.bindVertexBuffer(0, vertexBuffer);
+    cmdBuffer.bindVertexBuffer(1, normalBuffer);
+    if (texCoordBuffer)
+        cmdBuffer.bindVertexBuffer(2, texCoordBuffer);
+    cmdBuffer.bindIndexBuffer(indexBuffer);
+    cmdBuffer.drawIndexedInstanced(indexBuffer->getIndexCount(), instanceCount, 0, 0, 0);
+}
+
+const magma::VertexInputState& StaticMesh::getVertexInput() const
+{
+    return *vertexInput;
+}
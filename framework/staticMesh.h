@@ -0,0 +1,25 @@
+#pragma once
+#include "mesh.h"
+#include "packedMesh.h"
+
+// Uploads indexed mesh as single set of vertex buffers and draws it with one call.
+// With default float format vertex layout matches BezierPatchMesh, so the same shaders can be used.
+class StaticMesh : public Mesh
+{
+public:
+    StaticMesh(const IndexedMesh& mesh,
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer);
+    StaticMesh(const PackedMesh& mesh,
+        std::shared_ptr<magma::CommandBuffer> cmdBuffer);
+    ~StaticMesh();
+    using Mesh::draw;
+    virtual void draw(magma::CommandBuffer& cmdBuffer) const override;
+    virtual const magma::VertexInputState& getVertexInput() const override;
+
+private:
+    std::shared_ptr<magma::VertexBuffer> vertexBuffer;
+    std::shared_ptr<magma::VertexBuffer> normalBuffer;
+    std::shared_ptr<magma::VertexBuffer> texCoordBuffer;
+    std::shared_ptr<magma::IndexBuffer> indexBuffer;
+    std::unique_ptr<magma::VertexInputState> vertexInput;
+};
@@ -0,0 +1,142 @@
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "threadPool.h"
+#include "cpuTopology.h"
+
+static void pinThread(std::thread& thread, uint32_t cpu)
+{
+#ifdef _WIN32
+    SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << cpu);
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#endif
+}
+
+ThreadPool::ThreadPool(uint32_t numThreads /* 0 */):
+    partitions(1)
+{
+    if (!numThreads)
+        numThreads = std::max(1U, std::thread::hardware_concurrency());
+    threadNodes.resize(numThreads, 0);
+    for (uint32_t i = 0; i < numThreads; ++i)
+        threads.emplace_back(&ThreadPool::worker, this, i);
+}
+
+ThreadPool::ThreadPool(const CpuTopology& topology, uint32_t numThreads /* 0 */):
+    partitions(topology.getNodeCount())
+{
+    if (!numThreads)
+        numThreads = topology.getCpuCount();
+    const auto& nodes = topology.getNodes();
+    threads.reserve(numThreads);
+    threadNodes.reserve(numThreads);
+    for (uint32_t i = 0; i < numThreads; ++i)
+    {   // Round-robin over nodes, so that smaller pool still spans all of them
+        const uint32_t node = i % topology.getNodeCount();
+        const auto& cpus = nodes[node].cpus;
+        threadNodes.push_back(node);
+        threads.emplace_back(&ThreadPool::worker, this, i);
+        pinThread(threads.back(), cpus[(i / topology.getNodeCount()) % cpus.size()]);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void ThreadPool::parallelFor(uint32_t count, const Task& task)
+{
+    if (!count)
+        return;
+    std::unique_lock<std::mutex> lock(mtx);
+    partitions[0].next = 0;
+    partitions[0].end = count;
+    lock.unlock();
+    run(task, false);
+}
+
+void ThreadPool::parallelForNodes(uint32_t count, const Task& task)
+{
+    if (!count)
+        return;
+    std::vector<uint32_t> nodeThreads(partitions.size(), 0);
+    for (uint32_t node : threadNodes)
+        ++nodeThreads[node];
+    std::unique_lock<std::mutex> lock(mtx);
+    uint32_t threadsBefore = 0;
+    for (size_t node = 0; node < partitions.size(); ++node)
+    {   // Same count gives the same split
+        partitions[node].next = static_cast<uint32_t>(uint64_t(count) * threadsBefore / getThreadCount());
+        threadsBefore += nodeThreads[node];
+        partitions[node].end = static_cast<uint32_t>(uint64_t(count) * threadsBefore / getThreadCount());
+    }
+    lock.unlock();
+    run(task, true);
+}
+
+void ThreadPool::run(const Task& task, bool partitioned)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    this->task = &task;
+    this->partitioned = partitioned;
+    busy = getThreadCount();
+    ++generation;
+    wake.notify_all();
+    done.wait(lock, [this] { return 0 == busy; });
+    this->task = nullptr;
+    if (exception)
+    {   // Propagate first failure to the caller
+        std::exception_ptr exc = exception;
+        exception = nullptr;
+        std::rethrow_exception(exc);
+    }
+}
+
+void ThreadPool::worker(uint32_t threadIndex)
+{
+    uint64_t lastGeneration = 0;
+    for (;;)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        wake.wait(lock, [this, lastGeneration] { return stop || generation != lastGeneration; });
+        if (stop)
+            break;
+        lastGeneration = generation;
+        const Task *task = this->task;
+        Partition& partition = partitions[partitioned ? threadNodes[threadIndex] : 0];
+        const uint32_t end = partition.end;
+        lock.unlock();
+        try
+        {
+            for (uint32_t i = partition.next++; i < end; i = partition.next++)
+                (*task)(i, threadIndex);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            if (!exception)
+                exception = std::current_exception();
+            for (Partition& part : partitions)
+                part.next = part.end; // Cancel remaining work
+        }
+        lock.lock();
+        if (0 == --busy)
+            done.notify_one();
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include "nonCopyable.h"
+
+class CpuTopology;
+
+// Fixed set of workers that execute indexed tasks in parallel.
+// Thread index is passed to the task to address per-thread scratch memory.
+class ThreadPool : public NonCopyable
+{
+public:
+    typedef std::function<void(uint32_t index, uint32_t threadIndex)> Task;
+
+    explicit ThreadPool(uint32_t numThreads = 0);
+    // Pins each worker to its own CPU, workers are interleaved across NUMA nodes
+    ThreadPool(const CpuTopology& topology, uint32_t numThreads = 0);
+    ~ThreadPool();
+    void parallelFor(uint32_t count, const Task& task);
+    // Splits range into contiguous part per node, proportional to its workers,
+    // and runs each part only on workers of that node. Memory first touched
+    // by one call stays local to the workers of the next call with the same count.
+    void parallelForNodes(uint32_t count, const Task& task);
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(threads.size()); }
+    uint32_t getNodeCount() const { return static_cast<uint32_t>(partitions.size()); }
+    uint32_t getThreadNode(uint32_t threadIndex) const { return threadNodes[threadIndex]; }
+
+private:
+    struct Partition
+    {
+        std::atomic<uint32_t> next;
+        uint32_t end = 0;
+    };
+
+    void run(const Task& task, bool partitioned);
+    void worker(uint32_t threadIndex);
+
+    std::vector<std::thread> threads;
+    std::vector<uint32_t> threadNodes;
+    std::vector<Partition> partitions;
+    std::mutex mtx;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const Task *task = nullptr;
+    bool partitioned = false;
+    uint32_t busy = 0;
+    uint64_t generation = 0;
+    std::exception_ptr exception;
+    bool stop = false;
+};
@@ -0,0 +1,118 @@
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "tiledEdgeFilter.h"
+#include "edgeFilter.h"
+#include "threadPool.h"
+#include "timer.h"
+
+template<typename T>
+struct TileContext
+{
+    TileContext(uint32_t tileWidth, uint32_t tileHeight):
+        row(tileWidth + 2),
+        filter(tileWidth + 2, tileHeight + 2,
+            [this, tileWidth, tileHeight](uint32_t y, const uint8_t *edges)
+            {   // Drop halo rows and columns
+                if (y > 0 && y <= tileHeight)
+                    memcpy(dstTile + (y - 1) * tileWidth, edges + 1, tileWidth);
+            })
+    {}
+
+    std::vector<T> row;
+    ScanlineEdgeFilter<T> filter;
+    uint8_t *dstTile = nullptr;
+};
+
+template<typename T>
+static const T *tileRow(const TiledImage& image, uint32_t tx, uint32_t ty, uint32_t y)
+{
+    return reinterpret_cast<const T *>(image.getTile(tx, ty)) + y * image.getTileWidth();
+}
+
+template<typename T>
+static void filterTile(const TiledImage& src, TiledImage& dst, uint32_t tx, uint32_t ty,
+    TileContext<T>& context)
+{
+    const uint32_t width = src.getWidth();
+    const uint32_t height = src.getHeight();
+    const uint32_t tileWidth = src.getTileWidth();
+    const uint32_t tileHeight = src.getTileHeight();
+    const uint32_t x0 = tx * tileWidth;
+    const uint32_t validWidth = std::min(tileWidth, width - x0);
+    const bool hasLeft = tx > 0;
+    const bool hasRight = x0 + tileWidth < width;
+    T *row = context.row.data();
+    context.dstTile = dst.getTile(tx, ty);
+    context.filter.reset();
+    for (uint32_t ly = 0; ly < tileHeight + 2; ++ly)
+    {   // Clamp to image edge
+        const int64_t gy = int64_t(ty) * tileHeight + ly - 1;
+        const uint32_t y = static_cast<uint32_t>(std::min(std::max(gy, int64_t(0)), int64_t(height - 1)));
+        const uint32_t sy = y / tileHeight;
+        const uint32_t iy = y % tileHeight;
+        const T *srcRow = tileRow<T>(src, tx, sy, iy);
+        memcpy(row + 1, srcRow, validWidth * sizeof(T));
+        std::fill(row + 1 + validWidth, row + 1 + tileWidth, srcRow[validWidth - 1]);
+        // Exchange halo with neighbour tiles
+        row[0] = hasLeft ? tileRow<T>(src, tx - 1, sy, iy)[tileWidth - 1] : srcRow[0];
+        row[tileWidth + 1] = hasRight ? tileRow<T>(src, tx + 1, sy, iy)[0] : srcRow[validWidth - 1];
+        context.filter.pushRow(row);
+    }
+}
+
+template<typename T>
+static void filterTiles(const TiledImage& src, TiledImage& dst, ThreadPool& pool)
+{
+    std::vector<std::unique_ptr<TileContext<T>>> contexts;
+    for (uint32_t i = 0; i < pool.getThreadCount(); ++i)
+        contexts.push_back(std::make_unique<TileContext<T>>(src.getTileWidth(), src.getTileHeight()));
+    const MappedFile& srcFile = src.getFile();
+    MappedFile& dstFile = dst.getFile();
+    srcFile.advise(src.getTileRowOffset(0), src.getTileRowSize() * src.getTileCountY(), MappedFile::Advice::Sequential);
+    for (uint32_t ty = 0; ty < src.getTileCountY(); ++ty)
+    {
+        if (ty + 1 < src.getTileCountY())
+        {   // Prefetch next row while this one is processed
+            srcFile.advise(src.getTileRowOffset(ty + 1), src.getTileRowSize(), MappedFile::Advice::WillNeed);
+        }
+        pool.parallelFor(src.getTileCountX(),
+            [&src, &dst, &contexts, ty](uint32_t tx, uint32_t threadIndex)
+            {
+                filterTile<T>(src, dst, tx, ty, *contexts[threadIndex]);
+            });
+        // Write back finished row and drop it from working set
+        dstFile.flush(dst.getTileRowOffset(ty), dst.getTileRowSize());
+        dstFile.advise(dst.getTileRowOffset(ty), dst.getTileRowSize(), MappedFile::Advice::DontNeed);
+        if (ty > 0)
+        {   // Previous row is not needed as halo anymore
+            srcFile.advise(src.getTileRowOffset(ty - 1), src.getTileRowSize(), MappedFile::Advice::DontNeed);
+        }
+    }
+}
+
+TiledFilterStats detectEdgesTiled(const TiledImage& src, TiledImage& dst, ThreadPool& pool)
+{
+    if (dst.getWidth() != src.getWidth() ||
+        dst.getHeight() != src.getHeight() ||
+        dst.getTileWidth() != src.getTileWidth() ||
+        dst.getTileHeight() != src.getTileHeight() ||
+        dst.getFormat() != PixelFormat::R8)
+    {
+        throw std::runtime_error("incompatible destination image");
+    }
+    Timer timer;
+    timer.run();
+    switch (src.getFormat())
+    {
+    case PixelFormat::R8: filterTiles<uint8_t>(src, dst, pool); break;
+    case PixelFormat::R16: filterTiles<uint16_t>(src, dst, pool); break;
+    case PixelFormat::R32F: filterTiles<float>(src, dst, pool); break;
+    }
+    TiledFilterStats stats;
+    stats.tileCount = src.getTileCountX() * src.getTileCountY();
+    stats.bytesRead = stats.tileCount * src.getTileSize();
+    stats.bytesWritten = stats.tileCount * dst.getTileSize();
+    stats.milliseconds = timer.millisecondsElapsed();
+    return stats;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "tiledImage.h"
+
+class ThreadPool;
+
+struct TiledFilterStats
+{
+    uint32_t tileCount = 0;
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+    float milliseconds = 0.f;
+};
+
+// Runs Sobel filter over image that does not have to fit into memory.
+// Tiles of one row are processed in parallel, each one with one pixel halo
+// gathered from its neighbours. Pages of finished tile rows are released,
+// so resident memory is bounded by a few tile rows regardless of image size.
+// Destination should have the same dimensions and tiling, and R8 format.
+TiledFilterStats detectEdgesTiled(const TiledImage& src, TiledImage& dst, ThreadPool& pool);
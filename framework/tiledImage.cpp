@@ -0,0 +1,78 @@
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "tiledImage.h"
+
+static const char tiledImageMagic[4] = {'T', 'I', 'L', 'E'};
+static const uint32_t tiledImageVersion = 1;
+
+static uint64_t multiply(uint64_t a, uint64_t b)
+{   // Sizes of opened image come from disk, so any of them may be huge
+    if (a && b > UINT64_MAX / a)
+        throw std::runtime_error("tiled image is too large");
+    return a * b;
+}
+
+TiledImage::TiledImage(const std::string& filename, MappedFile::Access access):
+    file(std::make_unique<MappedFile>(filename, access))
+{
+    if (file->size() < sizeof(Header))
+        throw std::runtime_error("invalid tiled image");
+    header = reinterpret_cast<Header *>(file->data());
+    if (memcmp(header->magic, tiledImageMagic, sizeof(tiledImageMagic)) ||
+        header->version != tiledImageVersion ||
+        !getPixelSize(header->format) ||
+        !header->tileWidth || !header->tileHeight ||
+        header->dataOffset < sizeof(Header))
+    {
+        throw std::runtime_error("invalid tiled image");
+    }
+    setup();
+    if (header->dataOffset > file->size() ||
+        multiply(multiply(tilesX, tilesY), tileSize) > file->size() - header->dataOffset)
+    {
+        throw std::runtime_error("tiled image is truncated");
+    }
+}
+
+TiledImage::TiledImage(const std::string& filename, uint32_t width, uint32_t height,
+    uint32_t tileWidth, uint32_t tileHeight, PixelFormat format)
+{
+    const uint64_t tilesX = (uint64_t(width) + tileWidth - 1) / tileWidth;
+    const uint64_t tilesY = (uint64_t(height) + tileHeight - 1) / tileHeight;
+    const uint64_t tileSize = multiply(uint64_t(tileWidth) * tileHeight, getPixelSize(format));
+    // Align pixel data to page, so that tile rows can be released independently
+    const uint64_t dataOffset = MappedFile::getPageSize();
+    const uint64_t dataSize = multiply(multiply(tilesX, tilesY), tileSize);
+    if (dataSize > UINT64_MAX - dataOffset)
+        throw std::runtime_error("tiled image is too large");
+    file = std::make_unique<MappedFile>(filename, dataOffset + dataSize);
+    header = reinterpret_cast<Header *>(file->data());
+    memcpy(header->magic, tiledImageMagic, sizeof(tiledImageMagic));
+    header->version = tiledImageVersion;
+    header->width = width;
+    header->height = height;
+    header->tileWidth = tileWidth;
+    header->tileHeight = tileHeight;
+    header->format = format;
+    header->reserved = 0;
+    header->dataOffset = dataOffset;
+    setup();
+}
+
+uint8_t *TiledImage::getTile(uint32_t tx, uint32_t ty) noexcept
+{
+    return file->data() + header->dataOffset + (uint64_t(ty) * tilesX + tx) * tileSize;
+}
+
+const uint8_t *TiledImage::getTile(uint32_t tx, uint32_t ty) const noexcept
+{
+    return file->data() + header->dataOffset + (uint64_t(ty) * tilesX + tx) * tileSize;
+}
+
+void TiledImage::setup()
+{
+    tilesX = static_cast<uint32_t>((uint64_t(header->width) + header->tileWidth - 1) / header->tileWidth);
+    tilesY = static_cast<uint32_t>((uint64_t(header->height) + header->tileHeight - 1) / header->tileHeight);
+    tileSize = multiply(uint64_t(header->tileWidth) * header->tileHeight, getPixelSize(header->format));
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <memory>
+#include "mappedFile.h"
+#include "pixelFormat.h"
+
+// Single-channel image file stored as grid of fixed-size tiles.
+// Tiles are laid out in row-major order, pixels of each tile too,
+// so every row of tiles occupies contiguous range of the file.
+// Border tiles are padded to full size to keep addressing trivial.
+class TiledImage : public NonCopyable
+{
+public:
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t tileWidth;
+        uint32_t tileHeight;
+        PixelFormat format;
+        uint32_t reserved;
+        uint64_t dataOffset;
+    };
+
+    // Opens existing image
+    TiledImage(const std::string& filename, MappedFile::Access access);
+    // Creates new image
+    TiledImage(const std::string& filename, uint32_t width, uint32_t height,
+        uint32_t tileWidth, uint32_t tileHeight, PixelFormat format);
+    uint32_t getWidth() const noexcept { return header->width; }
+    uint32_t getHeight() const noexcept { return header->height; }
+    uint32_t getTileWidth() const noexcept { return header->tileWidth; }
+    uint32_t getTileHeight() const noexcept { return header->tileHeight; }
+    uint32_t getTileCountX() const noexcept { return tilesX; }
+    uint32_t getTileCountY() const noexcept { return tilesY; }
+    PixelFormat getFormat() const noexcept { return header->format; }
+    uint64_t getTileSize() const noexcept { return tileSize; }
+    uint64_t getTileRowOffset(uint32_t ty) const noexcept { return header->dataOffset + uint64_t(ty) * tilesX * tileSize; }
+    uint64_t getTileRowSize() const noexcept { return tilesX * tileSize; }
+    uint8_t *getTile(uint32_t tx, uint32_t ty) noexcept;
+    const uint8_t *getTile(uint32_t tx, uint32_t ty) const noexcept;
+    MappedFile& getFile() noexcept { return *file; }
+    const MappedFile& getFile() const noexcept { return *file; }
+
+private:
+    void setup();
+
+    std::unique_ptr<MappedFile> file;
+    Header *header = nullptr;
+    uint32_t tilesX = 0;
+    uint32_t tilesY = 0;
+    uint64_t tileSize = 0;
+};
@@ -0,0 +1,168 @@
+#include <cstring>
+#include "turntableBatch.h"
+#include "mesh.h"
+#include "shader.h"
+#include "../magma/magma.h"
+
+// Array of R8 layers that is rendered to and then sampled or copied
+class LayeredColorAttachment : public magma::Image
+{
+public:
+    LayeredColorAttachment(std::shared_ptr<magma::Device> device, VkFormat format,
+        uint32_t width, uint32_t height, uint32_t layers):
+        magma::Image(device, VK_IMAGE_TYPE_2D, format, VkExtent3D{width, height, 1},
+            1, // Mip levels
+            layers,
+            1, // Samples
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            0)
+    {}
+};
+
+TurntableBatch::TurntableBatch(std::shared_ptr<magma::Device> device,
+    std::shared_ptr<magma::PipelineCache> pipelineCache,
+    const magma::VertexInputState& vertexInput,
+    uint32_t width,
+    uint32_t height,
+    uint32_t viewCount):
+    width(width),
+    height(height),
+    viewCount(viewCount)
+{
+    assert(viewCount > 0 && viewCount <= maxViews);
+    maskTarget = createTarget(device, magma::AttachmentDescription(VK_FORMAT_R8_UNORM, 1,
+        magma::attachments::colorClearStoreReadOnly));
+    // Every pixel is overwritten by edge pass, layers end up ready to be copied
+    edgeTarget = createTarget(device, magma::AttachmentDescription(VK_FORMAT_R8_UNORM, 1,
+        magma::op::dontCareStore, // Don't care, store
+        magma::op::dontCareDontCare, // Stencil don't care
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+    views = std::make_shared<magma::UniformBuffer<Views>>(device);
+    sampler = std::make_shared<magma::Sampler>(device, magma::samplers::magMinLinearMipNearestClampToEdge);
+    // Setup descriptor sets
+    const magma::Descriptor uniformBufferDesc = magma::descriptors::UniformBuffer(1);
+    const magma::Descriptor imageSamplerDesc = magma::descriptors::CombinedImageSampler(1);
+    descriptorPool = std::make_shared<magma::DescriptorPool>(device, 2,
+        std::vector<magma::Descriptor>{uniformBufferDesc, imageSamplerDesc});
+    drawSetLayout = std::make_shared<magma::DescriptorSetLayout>(device,
+        magma::bindings::VertexStageBinding(0, uniformBufferDesc));
+    edgeSetLayout = std::make_shared<magma::DescriptorSetLayout>(device,
+        magma::bindings::FragmentStageBinding(0, imageSamplerDesc));
+    drawSet = descriptorPool->allocateDescriptorSet(drawSetLayout);
+    drawSet->update(0, views);
+    edgeSet = descriptorPool->allocateDescriptorSet(edgeSetLayout);
+    edgeSet->update(0, maskTarget.colorView, sampler);
+    // Setup pipelines
+    drawPipelineLayout = std::make_shared<magma::PipelineLayout>(drawSetLayout);
+    drawPipeline = std::make_shared<magma::GraphicsPipeline>(device, pipelineCache,
+        std::vector<magma::PipelineShaderStage>
+        {
+            VertexShader(device, "turntable.o"),
+            FragmentShader(device, "fill.o")
+        },
+        vertexInput,
+        magma::renderstates::triangleList,
+        magma::renderstates::fillCullBackCW,
+        magma::renderstates::noMultisample,
+        magma::renderstates::depthLessOrEqual,
+        magma::renderstates::dontBlendWriteRGB,
+        std::initializer_list<VkDynamicState>{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR},
+        drawPipelineLayout,
+        maskTarget.renderPass);
+    edgePipelineLayout = std::make_shared<magma::PipelineLayout>(edgeSetLayout);
+    edgePipeline = std::make_shared<magma::GraphicsPipeline>(device, pipelineCache,
+        std::vector<magma::PipelineShaderStage>
+        {
+            VertexShader(device, "quadLayered.o"),
+            FragmentShader(device, "sobelLayered.o")
+        },
+        magma::renderstates::nullVertexInput,
+        magma::renderstates::triangleStrip,
+        magma::renderstates::fillCullNoneCW,
+        magma::renderstates::noMultisample,
+        magma::renderstates::depthAlwaysDontWrite,
+        magma::renderstates::dontBlendWriteRGB,
+        std::initializer_list<VkDynamicState>{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR},
+        edgePipelineLayout,
+        edgeTarget.renderPass);
+    // All layers are copied at once, so buffer stays mapped
+    edgeBuffer = std::make_shared<magma::DstTransferBuffer>(device, VkDeviceSize(width) * height * viewCount);
+    edgePixels = static_cast<const uint8_t *>(edgeBuffer->getMemory()->map());
+}
+
+TurntableBatch::~TurntableBatch()
+{
+    edgeBuffer->getMemory()->unmap();
+}
+
+void TurntableBatch::setViews(const float *viewProj)
+{
+    magma::helpers::mapScoped<Views>(views, true, [this, viewProj](Views *data)
+    {
+        memcpy(data->viewProj, viewProj, sizeof(float) * 16 * viewCount);
+    });
+}
+
+void TurntableBatch::record(magma::CommandBuffer& cmdBuffer, Mesh& mesh) const
+{
+    const uint32_t instanceCount = mesh.getInstanceCount();
+    mesh.setInstanceCount(viewCount);
+    const VkExtent2D extent{width, height};
+    cmdBuffer.setRenderArea(0, 0, extent);
+    cmdBuffer.beginRenderPass(maskTarget.renderPass, maskTarget.framebuffer, {magma::clears::blackColor});
+    {   // Each instance goes to its own layer
+        cmdBuffer.setViewport(0, 0, width, height);
+        cmdBuffer.setScissor(magma::Scissor(0, 0, extent));
+        cmdBuffer.bindDescriptorSet(drawPipelineLayout, drawSet);
+        cmdBuffer.bindPipeline(drawPipeline);
+        mesh.draw(cmdBuffer);
+    }
+    cmdBuffer.endRenderPass();
+    mesh.setInstanceCount(instanceCount);
+    // Render pass leaves mask layers in shader read-only layout
+    cmdBuffer.pipelineBarrier(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        magma::MemoryBarrier(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+    cmdBuffer.beginRenderPass(edgeTarget.renderPass, edgeTarget.framebuffer, {magma::clears::blackColor});
+    {   // Fullscreen quad per layer
+        cmdBuffer.setViewport(0, 0, width, height);
+        cmdBuffer.setScissor(magma::Scissor(0, 0, extent));
+        cmdBuffer.bindDescriptorSet(edgePipelineLayout, edgeSet);
+        cmdBuffer.bindPipeline(edgePipeline);
+        cmdBuffer.draw(4, viewCount, 0, 0);
+    }
+    cmdBuffer.endRenderPass();
+}
+
+void TurntableBatch::recordReadback(magma::CommandBuffer& cmdBuffer) const
+{
+    cmdBuffer.pipelineBarrier(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        magma::MemoryBarrier(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT));
+    VkBufferImageCopy region;
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0; // Tightly packed, layers follow each other
+    region.bufferImageHeight = 0;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, viewCount};
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {width, height, 1};
+    cmdBuffer.copyImageToBuffer(edgeTarget.color, edgeBuffer, region);
+    cmdBuffer.pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        magma::MemoryBarrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT));
+}
+
+const uint8_t *TurntableBatch::getEdgeLayer(uint32_t view) const noexcept
+{
+    return edgePixels + size_t(width) * height * view;
+}
+
+TurntableBatch::LayeredTarget TurntableBatch::createTarget(std::shared_ptr<magma::Device> device,
+    const magma::AttachmentDescription& colorAttachment) const
+{
+    LayeredTarget target;
+    target.color = std::make_shared<LayeredColorAttachment>(device, colorAttachment.format, width, height, viewCount);
+    target.colorView = std::make_shared<magma::ImageView>(target.color); // 2D array view of all layers
+    target.renderPass = std::make_shared<magma::RenderPass>(device, colorAttachment);
+    target.framebuffer = std::make_shared<magma::Framebuffer>(target.renderPass, target.colorView);
+    return target;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include "nonCopyable.h"
+
+class Mesh;
+
+namespace magma
+{
+    class Device;
+    class Image;
+    class ImageView;
+    class Sampler;
+    class RenderPass;
+    struct AttachmentDescription;
+    class Framebuffer;
+    class DstTransferBuffer;
+    class CommandBuffer;
+    class PipelineCache;
+    class PipelineLayout;
+    class GraphicsPipeline;
+    class DescriptorPool;
+    class DescriptorSetLayout;
+    class DescriptorSet;
+    class VertexInputState;
+    template<typename Type> class UniformBuffer;
+}
+
+// Renders the same mesh from many cameras into layers of 2D array attachment
+// with single instanced draw, then filters edges of all layers in one pass.
+// Vertex shaders select layer by gl_InstanceIndex, which requires
+// VK_EXT_shader_viewport_index_layer.
+class TurntableBatch : public NonCopyable
+{
+public:
+    static constexpr uint32_t maxViews = 64;
+
+    TurntableBatch(std::shared_ptr<magma::Device> device,
+        std::shared_ptr<magma::PipelineCache> pipelineCache,
+        const magma::VertexInputState& vertexInput,
+        uint32_t width,
+        uint32_t height,
+        uint32_t viewCount);
+    ~TurntableBatch();
+    uint32_t getViewCount() const noexcept { return viewCount; }
+    // Takes viewCount row-major matrices
+    void setViews(const float *viewProj);
+    // Mesh is drawn with instance count equal to number of views
+    void record(magma::CommandBuffer& cmdBuffer, Mesh& mesh) const;
+    // Copies edges of all layers to host, result is valid when submission completes
+    void recordReadback(magma::CommandBuffer& cmdBuffer) const;
+    const uint8_t *getEdgeLayer(uint32_t view) const noexcept;
+
+private:
+    struct Views
+    {
+        float viewProj[maxViews][16];
+    };
+
+    struct LayeredTarget
+    {
+        std::shared_ptr<magma::Image> color;
+        std::shared_ptr<magma::ImageView> colorView;
+        std::shared_ptr<magma::RenderPass> renderPass;
+        std::shared_ptr<magma::Framebuffer> framebuffer;
+    };
+
+    LayeredTarget createTarget(std::shared_ptr<magma::Device> device,
+        const magma::AttachmentDescription& colorAttachment) const;
+
+    const uint32_t width;
+    const uint32_t height;
+    const uint32_t viewCount;
+    LayeredTarget maskTarget;
+    LayeredTarget edgeTarget;
+    std::shared_ptr<magma::UniformBuffer<Views>> views;
+    std::shared_ptr<magma::Sampler> sampler;
+    std::shared_ptr<magma::DescriptorPool> descriptorPool;
+    std::shared_ptr<magma::DescriptorSetLayout> drawSetLayout;
+    std::shared_ptr<magma::DescriptorSetLayout> edgeSetLayout;
+    std::shared_ptr<magma::DescriptorSet> drawSet;
+    std::shared_ptr<magma::DescriptorSet> edgeSet;
+    std::shared_ptr<magma::PipelineLayout> drawPipelineLayout;
+    std::shared_ptr<magma::PipelineLayout> edgePipelineLayout;
+    std::shared_ptr<magma::GraphicsPipeline> drawPipeline;
+    std::shared_ptr<magma::GraphicsPipeline> edgePipeline;
+    std::shared_ptr<magma::DstTransferBuffer> edgeBuffer;
+    const uint8_t *edgePixels;
+};
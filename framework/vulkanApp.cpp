@@ -3,6 +3,9 @@
 #include <sstream>
 #include "vulkanApp.h"
 #include "linearAllocator.h"
+#include "auditObjectAllocator.h"
+#include "allocationAudit.h"
+#include "commandLine.h"
 
 VulkanApp::VulkanApp(const AppEntry& entry, const std::tstring& caption, uint32_t width, uint32_t height,
     bool depthBuffer /* false */):
@@ -10,11 +13,23 @@ VulkanApp::VulkanApp(const AppEntry& entry, const std::tstring& caption, uint32_
     timer(std::make_unique<Timer>()),
     depthBuffer(depthBuffer)
 {
-    magma::Object::setAllocator(std::make_shared<LinearAllocator>());
+    std::shared_ptr<magma::IObjectAllocator> allocator = std::make_shared<LinearAllocator>();
+    const CommandLine cmdLine(entry);
+    asyncCompute = cmdLine.hasOption("--async-compute");
+    if (cmdLine.hasOption("--alloc-audit"))
+    {   // Count heap allocations of each frame, steady state begins after warm-up
+        AllocationAudit::enable(cmdLine.getValue("--alloc-audit-warmup", 10U),
+            cmdLine.hasOption("--alloc-audit-assert"));
+        allocator = std::make_shared<AuditObjectAllocator>(allocator);
+    }
+    magma::Object::setAllocator(allocator);
 }
 
 VulkanApp::~VulkanApp()
-{}
+{
+    if (AllocationAudit::isEnabled())
+        AllocationAudit::printReport();
+}
 
 void VulkanApp::onIdle()
 {
@@ -23,14 +38,38 @@ void VulkanApp::onIdle()
 
 void VulkanApp::onPaint()
 {
-    const uint32_t bufferIndex = swapchain->acquireNextImage(presentFinished, nullptr);
-    waitFences[bufferIndex]->wait();
-    waitFences[bufferIndex]->reset();
+    AllocationAudit::beginFrame();
+    uint32_t bufferIndex;
+    {
+        AllocationZone zone("acquire");
+        uint32_t acquireSlot = 0;
+        if (asyncCompute)
+        {   // Semaphore may be signaled again only after the wait for its previous signal has executed
+            acquireSlot = acquireIndex++ % static_cast<uint32_t>(acquireSemaphores.size());
+            if (acquireFences[acquireSlot])
+                acquireFences[acquireSlot]->wait();
+            presentFinished = acquireSemaphores[acquireSlot];
+        }
+        bufferIndex = swapchain->acquireNextImage(presentFinished, nullptr);
+        waitFences[bufferIndex]->wait();
+        waitFences[bufferIndex]->reset();
+        if (asyncCompute)
+        {   // Once image is acquired again, previous present of it has waited for its semaphore
+            acquireFences[acquireSlot] = waitFences[bufferIndex];
+            renderFinished = presentSemaphores[bufferIndex];
+        }
+    }
     {
+        AllocationZone zone("render");
         render(bufferIndex);
     }
-    queue->present(swapchain, bufferIndex, renderFinished);
-    device->waitIdle(); // Flush
+    {
+        AllocationZone zone("present");
+        queue->present(swapchain, bufferIndex, renderFinished);
+        if (!asyncCompute)
+            device->waitIdle(); // Flush
+    }
+    AllocationAudit::endFrame();
 }
 
 void VulkanApp::onKeyDown(char key, int repeat, uint32_t flags)
@@ -109,6 +148,13 @@ void VulkanApp::createLogicalDevice()
     queueDescriptors.push_back(graphicsQueue);
     if (transferQueue.queueFamilyIndex != graphicsQueue.queueFamilyIndex)
         queueDescriptors.push_back(transferQueue);
+    if (asyncCompute)
+    {   // Dedicated compute family runs alongside graphics, otherwise compute goes to graphics family
+        const magma::DeviceQueueDescriptor asyncComputeQueue(VK_QUEUE_COMPUTE_BIT, physicalDevice, defaultQueuePriorities);
+        if (asyncComputeQueue.queueFamilyIndex != graphicsQueue.queueFamilyIndex &&
+            asyncComputeQueue.queueFamilyIndex != transferQueue.queueFamilyIndex)
+            queueDescriptors.push_back(asyncComputeQueue);
+    }
 
     // Enable some widely used features
     VkPhysicalDeviceFeatures features = {0};
@@ -123,6 +169,8 @@ void VulkanApp::createLogicalDevice()
         enabledExtensions.push_back(VK_AMD_NEGATIVE_VIEWPORT_HEIGHT_EXTENSION_NAME);
     else if (extensions->KHR_maintenance1)
         enabledExtensions.push_back(VK_KHR_MAINTENANCE1_EXTENSION_NAME);
+    if (extensions->EXT_shader_viewport_index_layer)
+        enabledExtensions.push_back(VK_EXT_SHADER_VIEWPORT_INDEX_LAYER_EXTENSION_NAME); // Layered rendering from vertex shader
 
     const std::vector<const char*> noLayers;
     device = physicalDevice->createDevice(queueDescriptors, noLayers, enabledExtensions, features);
@@ -268,6 +316,19 @@ void VulkanApp::createCommandBuffers()
     {
         std::cout << "Transfer queue not present\n";
     }
+    if (asyncCompute)
+    {
+        try
+        {
+            computeQueue = device->getQueue(VK_QUEUE_COMPUTE_BIT, 0);
+            computeCommandPool = std::make_shared<magma::CommandPool>(device, computeQueue->getFamilyIndex());
+        }
+        catch (...)
+        {
+            std::cout << "Compute queue not present\n";
+            asyncCompute = false;
+        }
+    }
 }
 
 void VulkanApp::createSyncPrimitives()
@@ -279,6 +340,15 @@ void VulkanApp::createSyncPrimitives()
         constexpr bool signaled = true; // Don't wait on first render of each command buffer
         waitFences.push_back(std::make_shared<magma::Fence>(device, signaled));
     }
+    if (asyncCompute)
+    {   // Frames aren't flushed, so single pair of semaphores would be signaled while still pending
+        for (int i = 0; i < (int)commandBuffers.size(); ++i)
+        {
+            acquireSemaphores.push_back(std::make_shared<magma::Semaphore>(device));
+            presentSemaphores.push_back(std::make_shared<magma::Semaphore>(device));
+        }
+        acquireFences.resize(acquireSemaphores.size());
+    }
 }
 
 bool VulkanApp::submitCmdBuffer(uint32_t bufferIndex)
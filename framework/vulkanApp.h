@@ -60,12 +60,22 @@ protected:
     std::shared_ptr<magma::RenderPass> renderPass;
     std::vector<std::shared_ptr<magma::Framebuffer>> framebuffers;
     std::shared_ptr<magma::Queue> queue;
+    std::shared_ptr<magma::Queue> computeQueue;
+    std::shared_ptr<magma::CommandPool> computeCommandPool;
     std::shared_ptr<magma::Semaphore> presentFinished;
     std::shared_ptr<magma::Semaphore> renderFinished;
     std::vector<std::shared_ptr<magma::Fence>> waitFences;
+    // Without flush semaphores of current frame are picked from these
+    std::vector<std::shared_ptr<magma::Semaphore>> acquireSemaphores; // Per frame in flight
+    std::vector<std::shared_ptr<magma::Fence>> acquireFences; // Of submission that waited for acquire
+    std::vector<std::shared_ptr<magma::Semaphore>> presentSemaphores; // Per swapchain image
+    uint32_t acquireIndex = 0;
 
     std::shared_ptr<magma::PipelineCache> pipelineCache;
 
     std::unique_ptr<Timer> timer;
     bool depthBuffer;
+    // With --async-compute frames stay in flight instead of being flushed,
+    // app should reset it if it can't synchronize them itself
+    bool asyncCompute;
 };
@@ -0,0 +1,68 @@
+#version 450
+
+layout(location = 0) in vec2 uv;
+
+layout(binding = 0) uniform Transforms
+{
+    mat4 worldViewProj;
+};
+
+// 16 control points per patch, row-major in u
+layout(binding = 1) readonly buffer ControlPoints
+{
+    vec4 controlPoints[];
+};
+
+// Maps instance to patch, written by culling pass
+layout(binding = 2) readonly buffer PatchIndices
+{
+    uint patchIndices[];
+};
+
+layout(location = 0) out vec3 oNormal;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+vec4 bernstein(float t)
+{
+    float s = 1. - t;
+    return vec4(s * s * s, 3. * t * s * s, 3. * t * t * s, t * t * t);
+}
+
+vec4 bernsteinDerivative(float t)
+{
+    float s = 1. - t;
+    return vec4(-3. * s * s, 3. * s * s - 6. * t * s, 6. * t * s - 3. * t * t, 3. * t * t);
+}
+
+void main()
+{
+    const int first = int(patchIndices[gl_InstanceIndex]) * 16;
+    const vec4 bu = bernstein(uv.x);
+    const vec4 bv = bernstein(uv.y);
+    const vec4 du = bernsteinDerivative(uv.x);
+    const vec4 dv = bernsteinDerivative(uv.y);
+    vec3 position = vec3(0.);
+    vec3 dPdu = vec3(0.);
+    vec3 dPdv = vec3(0.);
+    for (int j = 0; j < 4; ++j)
+    {
+        vec3 row = vec3(0.), dRow = vec3(0.);
+        for (int i = 0; i < 4; ++i)
+        {
+            vec3 p = controlPoints[first + j * 4 + i].xyz;
+            row += p * bu[i];
+            dRow += p * du[i];
+        }
+        position += row * bv[j];
+        dPdu += dRow * bv[j];
+        dPdv += row * dv[j];
+    }
+    // Control points have Y and Z swapped, which flips handedness of cross product
+    oNormal = normalize(cross(dPdv, dPdu));
+    gl_Position = worldViewProj * vec4(position, 1.);
+    gl_Position.y = -gl_Position.y;
+}
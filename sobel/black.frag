@@ -0,0 +1,9 @@
+#version 450
+
+layout(location = 0) in vec3 normal;
+layout(location = 0) out vec4 oColor;
+
+void main()
+{   // Fills depth only, so that hidden edges are occluded
+    oColor = vec4(0., 0., 0., 0.);
+}
@@ -0,0 +1,11 @@
+#version 450
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 oColor;
+layout(binding = 0) uniform sampler2D mask;
+
+void main()
+{   // Edges are already drawn, present them as is
+    float edge = texture(mask, texCoord).r;
+    oColor = vec4(vec3(edge), 1.);
+}
@@ -0,0 +1,36 @@
+#version 450
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texCoord;
+// Rows of transposed world matrix
+layout(location = 3) in vec4 world0;
+layout(location = 4) in vec4 world1;
+layout(location = 5) in vec4 world2;
+
+layout(binding = 0) uniform Transforms
+{
+    mat4 viewProj;
+};
+
+layout(location = 0) out vec3 oNormal;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+void main()
+{
+    vec4 worldPos = vec4(
+        dot(world0, position),
+        dot(world1, position),
+        dot(world2, position),
+        1.);
+    oNormal = normalize(vec3(
+        dot(world0.xyz, normal),
+        dot(world1.xyz, normal),
+        dot(world2.xyz, normal)));
+    gl_Position = viewProj * worldPos;
+    gl_Position.y = -gl_Position.y;
+}
@@ -0,0 +1,24 @@
+#version 450
+
+layout(location = 0) in vec4 position;
+
+layout(binding = 0) uniform Transforms
+{
+    mat4 worldViewProj;
+};
+
+layout(location = 0) out vec3 oNormal;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+void main()
+{
+    oNormal = vec3(0.);
+    gl_Position = worldViewProj * position;
+    gl_Position.y = -gl_Position.y;
+    // Pull towards viewer to win depth test against faces the edge lies on
+    gl_Position.z -= 0.0002 * gl_Position.w;
+}
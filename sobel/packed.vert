@@ -0,0 +1,52 @@
+#version 450
+
+// Quantized position is dequantized by worldViewProj
+layout(location = 0) in vec4 position;
+// Compiled once per normal format: OCTAHEDRAL16 for snorm16 (x, y),
+// UNORM1010102 for 10:10:10:2 unorm, otherwise float normal.
+// Texture coordinates are never read, so mesh may have no attribute 2.
+#if defined(OCTAHEDRAL16)
+layout(location = 1) in vec2 packedNormal;
+#elif defined(UNORM1010102)
+layout(location = 1) in vec3 packedNormal;
+#else
+layout(location = 1) in vec3 normal;
+#endif
+
+layout(binding = 0) uniform Transforms
+{
+    mat4 worldViewProj;
+};
+
+layout(location = 0) out vec3 oNormal;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+#ifdef OCTAHEDRAL16
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1. - abs(e.x) - abs(e.y));
+    if (n.z < 0.)
+    {
+        vec2 signNotZero = vec2(n.x >= 0. ? 1. : -1., n.y >= 0. ? 1. : -1.);
+        n.xy = (1. - abs(n.yx)) * signNotZero;
+    }
+    return normalize(n);
+}
+#endif
+
+void main()
+{
+#if defined(OCTAHEDRAL16)
+    oNormal = decodeOctahedral(packedNormal);
+#elif defined(UNORM1010102)
+    oNormal = normalize(packedNormal * 2. - 1.);
+#else
+    oNormal = normal;
+#endif
+    gl_Position = worldViewProj * vec4(position.xyz, 1.);
+    gl_Position.y = -gl_Position.y;
+}
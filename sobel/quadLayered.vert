@@ -0,0 +1,23 @@
+#version 450
+#extension GL_ARB_shader_viewport_layer_array : require
+
+layout(location = 0) out vec2 oTexCoord;
+layout(location = 1) flat out int oLayer;
+
+out gl_PerVertex
+{
+  vec4 gl_Position;
+};
+
+void main()
+{
+  vec2 positions[4] = vec2[4](
+    vec2(-1.,-1.),
+    vec2(-1., 1.),
+    vec2( 1.,-1.),
+    vec2( 1., 1.));
+  gl_Position = vec4(positions[gl_VertexIndex], 0., 1.);
+  oTexCoord = gl_Position.xy * 0.5 + 0.5;
+  oLayer = gl_InstanceIndex;
+  gl_Layer = gl_InstanceIndex;
+}
@@ -1,25 +1,113 @@
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <chrono>
+#include <iostream>
 #include "../framework/vulkanApp.h"
 #include "../framework/bezierMesh.h"
+#include "../framework/bezierControlMesh.h"
+#include "../framework/staticMesh.h"
+#include "../framework/meshWeld.h"
+#include "../framework/meshOptimizer.h"
+#include "../framework/gpuPatchCulling.h"
+#include "../framework/instanceBuffer.h"
+#include "../framework/turntableBatch.h"
+#include "../framework/meshEdges.h"
+#include "../framework/edgeLines.h"
+#include "../framework/imageReadback.h"
+#include "../framework/imageEncoder.h"
+#include "../framework/patchFile.h"
+#include "../framework/threadPool.h"
+#include "../framework/parallelRecorder.h"
+#include "../framework/frameBenchmark.h"
+#include "../framework/cameraPath.h"
+#include "../framework/allocationAudit.h"
+#include "../framework/poolHostAllocator.h"
+#include "../framework/asyncEdgeFilter.h"
+#include "../framework/commandLine.h"
 #include "teapot.h"
 
+// Default subdivision is baked by compiler, so --static-mesh does no evaluation at startup
+alignas(16) static constexpr StaticPatchMesh<kTeapotNumPatches, 8> teapotMesh =
+    tessellateStaticPatches<8>(teapotPatches, teapotVertices);
+
 class SobelApp : public VulkanApp
 {
     struct Framebuffer
     {
         std::shared_ptr<magma::ColorAttachment2D> color;
         std::shared_ptr<magma::ImageView> colorView;
+        std::shared_ptr<magma::DepthStencilAttachment2D> depth;
+        std::shared_ptr<magma::ImageView> depthView;
         std::shared_ptr<magma::RenderPass> renderPass;
         std::shared_ptr<magma::Framebuffer> framebuffer;
-    } fb;
+    } fb, edgeFb;
+
+    struct AsyncFrame
+    {   // Mask target and commands of frame in flight
+        Framebuffer fb;
+        std::shared_ptr<magma::CommandBuffer> rtCmdBuffer;
+        std::unique_ptr<magma::aux::BlitRectangle> blitRect;
+        std::vector<std::shared_ptr<magma::CommandBuffer>> cmdBuffers; // Per swapchain image
+        bool dirty = true;
+    };
 
     std::shared_ptr<magma::CommandBuffer> rtCmdBuffer;
     std::shared_ptr<magma::Semaphore> rtSemaphore;
     std::shared_ptr<magma::GraphicsPipeline> rtSolidDrawPipeline;
+    std::shared_ptr<magma::GraphicsPipeline> rtEdgeLinePipeline;
     std::vector<magma::PipelineShaderStage> rtShaderStages;
     std::shared_ptr<magma::PipelineLayout> rtPipelineLayout;
 
-    std::unique_ptr<BezierPatchMesh> mesh;
+    std::unique_ptr<Mesh> mesh;
+    BezierControlMesh *controlMesh = nullptr;
+    BezierPatchMesh *patchMesh = nullptr;
+    std::string patchFile;
+    PatchSet patchSet;
+    const uint32_t (*patches)[16] = teapotPatches;
+    uint32_t numPatches = kTeapotNumPatches;
+    const float (*patchVertices)[3] = teapotVertices;
+    bool gpuBezier;
+    bool staticMesh;
+    bool weld;
+    bool optimize;
+    bool pack;
+    bool cull;
+    bool gpuCull;
+    std::shared_ptr<GpuPatchCuller> gpuCuller;
+    PatchCuller culler;
+    CullStats cullStats;
+    std::chrono::nanoseconds cullTime{0};
+    uint32_t instanceCount;
+    std::unique_ptr<InstancedScene> scene;
+    std::unique_ptr<InstanceBuffer> instanceBuffer;
+    std::chrono::nanoseconds instanceUpdateTime{0};
+    uint64_t instanceUpdates = 0;
+    uint32_t turntableViews;
+    uint32_t recordRounds;
+    uint32_t recordThreadCount;
+    uint32_t hostAllocRounds;
+    std::unique_ptr<ThreadPool> recordThreads;
+    std::unique_ptr<ParallelRecorder> recorder;
+    bool meshEdgeMode;
+    uint32_t creaseAngle;
+    std::unique_ptr<MeshEdges> meshEdges;
+    std::unique_ptr<EdgeLines> edgeLines;
+    uint32_t edgeLineCount = 0;
+    EdgeStats edgeStats;
+    std::chrono::nanoseconds edgeTime{0};
+    uint32_t edgeFrames = 0;
+    VertexFormat vertexFormat;
+    uint32_t subdivisionDegree;
     std::unique_ptr<magma::aux::BlitRectangle> blitRect;
+    std::unique_ptr<magma::aux::BlitRectangle> edgeBlitRect;
+    std::string readbackDir;
+    uint32_t readbackSlots;
+    std::unique_ptr<ImageReadback> readback;
+    std::unique_ptr<AsyncEdgeFilter> asyncFilter;
+    std::vector<AsyncFrame> asyncFrames;
+    std::string asyncTrace;
+    uint64_t frameIndex = 0;
 
     std::shared_ptr<magma::UniformBuffer<rapid::matrix>> uniformBuffer;
     std::shared_ptr<magma::DescriptorPool> descriptorPool;
@@ -27,48 +115,208 @@ class SobelApp : public VulkanApp
     std::shared_ptr<magma::DescriptorSet> descriptorSet;
     
     rapid::matrix viewProj;
+    rapid::matrix meshTransform;
+    float angle = 0.f;
+    std::unique_ptr<FrameBenchmark> benchmark;
+    std::unique_ptr<CameraPath> cameraPath;
 
 public:
     SobelApp(const AppEntry& entry):
         VulkanApp(entry, TEXT("Sobel"), 1280, 720, false)
     {
+        const CommandLine cmdLine(entry);
+        readbackDir = cmdLine.getValue("--readback", std::string());
+        readbackSlots = cmdLine.getValue("--readback-slots", 3U);
+        asyncTrace = cmdLine.getValue("--async-trace", std::string());
+        patchFile = cmdLine.getValue("--patch-file", std::string());
+        gpuBezier = cmdLine.hasOption("--gpu-bezier");
+        staticMesh = cmdLine.hasOption("--static-mesh");
+        weld = cmdLine.hasOption("--weld");
+        optimize = cmdLine.hasOption("--optimize");
+        pack = cmdLine.hasOption("--pack");
+        cull = cmdLine.hasOption("--cull");
+        gpuCull = cmdLine.hasOption("--gpu-cull");
+        instanceCount = std::max(cmdLine.getValue("--instances", 1U), 1U);
+        turntableViews = cmdLine.getValue("--turntable", 0U);
+        recordRounds = cmdLine.getValue("--record-benchmark", 0U);
+        recordThreadCount = cmdLine.getValue("--record-threads", 0U);
+        hostAllocRounds = cmdLine.getValue("--host-alloc-benchmark", 0U);
+        meshEdgeMode = cmdLine.hasOption("--mesh-edges");
+        creaseAngle = cmdLine.getValue("--crease-angle", 45U);
+        parseVertexFormat(cmdLine);
+        subdivisionDegree = cmdLine.getValue("--subdivision", 8U);
+        const uint32_t benchmarkFrames = cmdLine.getValue("--benchmark", 0U);
+        if (benchmarkFrames)
+        {   // 60 Hz step by default
+            const float timestep = std::stof(cmdLine.getValue("--timestep", std::string("16.6667")));
+            benchmark = std::make_unique<FrameBenchmark>(benchmarkFrames,
+                cmdLine.getValue("--benchmark-warmup", 10U), timestep);
+            createCameraPath();
+        }
         initialize();
 
         setupView();
+        if (!patchFile.empty())
+            loadPatches();
         createMesh();
-        createFramebuffer({width, height});
+        if (instanceCount > 1)
+            createScene();
+        if (meshEdgeMode)
+            createMeshEdges();
+        fb = createMaskTarget({width, height});
         createUniformBuffer();
         setupDescriptorSet();
         setupPipelines();
         createBlitRectangle();
+        if (asyncCompute && (recordThreadCount || meshEdgeMode || !readbackDir.empty()))
+        {   // These record against single mask target
+            std::cout << "Async compute can't be combined with --record-threads, --mesh-edges or --readback\n";
+            asyncCompute = false;
+        }
+        if (asyncCompute)
+            createAsyncFilter();
+        if (recordThreadCount)
+        {   // Each thread records its slice of draws into secondary command buffer
+            recordThreads = std::make_unique<ThreadPool>(recordThreadCount);
+            recorder = std::make_unique<ParallelRecorder>(device, queue->getFamilyIndex(), *recordThreads);
+        }
         recordRenderToTextureCommandBuffer();
         recordCommandBuffer(FrontBuffer);
         recordCommandBuffer(BackBuffer);
+        if (!readbackDir.empty())
+            setupReadback({width, height});
+        if (turntableViews)
+            runTurntable();
+        if (recordRounds)
+            benchmarkRecording();
+        if (hostAllocRounds)
+            benchmarkHostAllocator();
         timer->run();
     }
 
+    ~SobelApp()
+    {
+        if (asyncFilter)
+            device->waitIdle(); // Frames are in flight
+        if (benchmark)
+            benchmark->printStatistics();
+        if (asyncFilter)
+        {
+            asyncFilter->printStatistics();
+            if (!asyncTrace.empty())
+                asyncFilter->writeTrace(asyncTrace);
+        }
+        if (cullStats.patchCount)
+        {
+            const float total = static_cast<float>(cullStats.patchCount);
+            std::cout << "Culled " << (cullStats.frustumCulled + cullStats.backfaceCulled) * 100.f / total << "% of patches ("
+                << cullStats.frustumCulled * 100.f / total << "% frustum, "
+                << cullStats.backfaceCulled * 100.f / total << "% back-facing), "
+                << cullTime.count() / total << " us per 1000 patches\n"; // Same as ns per patch
+        }
+        if (edgeFrames)
+        {
+            std::cout << "Mesh edges: " << edgeStats.silhouetteEdges / (float)edgeFrames << " silhouette and "
+                << edgeStats.creaseEdges / (float)edgeFrames << " crease edges of " << meshEdges->getEdgeCount()
+                << " per frame, extracted in " << edgeTime.count() / 1000.f / edgeFrames << " us\n";
+        }
+        if (instanceUpdates)
+        {
+            std::cout << "Instance transforms updated in "
+                << instanceUpdateTime.count() / (float)instanceUpdates / scene->getInstanceCount()
+                << " us per 1000 instances\n"; // Same as ns per instance
+        }
+        if (readback)
+        {
+            device->waitIdle();
+            readback->flush();
+            readback->printStatistics();
+        }
+    }
+
     virtual void render(uint32_t bufferIndex) override
     {
-        updatePerspectiveTransform();
-        queue->submit(
-            rtCmdBuffer,
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            presentFinished, // Wait for swapchain
-            rtSemaphore,
-            nullptr);
+        uint32_t slot = 0;
+        if (asyncFilter)
+        {   // Mask render of previous frame reads the same uniforms
+            AllocationZone zone("wait");
+            slot = asyncFilter->beginFrame();
+        }
+        {
+            AllocationZone zone("update");
+            updatePerspectiveTransform();
+        }
+        AllocationZone zone("submit");
+        if (asyncFilter)
+        {   // Edge filter of this frame overlaps mask render of the next one, so previous frame is presented
+            if (asyncFrames[slot].dirty)
+                recordAsyncMask(slot);
+            asyncFilter->submit(
+                asyncFrames[slot].rtCmdBuffer,
+                asyncFrames[asyncFilter->getPresentSlot()].cmdBuffers[bufferIndex],
+                presentFinished, // Wait for swapchain
+                renderFinished,
+                waitFences[bufferIndex]);
+        }
+        else
+        {
+            queue->submit(
+                rtCmdBuffer,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                presentFinished, // Wait for swapchain
+                rtSemaphore,
+                nullptr);
+
+            queue->submit(
+                commandBuffers[bufferIndex],
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                rtSemaphore, // Wait for render-to-texture
+                renderFinished,
+                waitFences[bufferIndex]);
+        }
+
+        if (readback)
+        {   // Copy is ordered after render-to-texture by barrier
+            AllocationZone zone("readback");
+            std::shared_ptr<magma::CommandBuffer> cmdCopy;
+            std::shared_ptr<magma::Fence> copyFence;
+            readback->poll();
+            if (readback->acquire(frameIndex, cmdCopy, copyFence))
+                queue->submit(cmdCopy, 0, nullptr, nullptr, copyFence);
+        }
+        ++frameIndex;
+        if (benchmark && benchmark->endFrame())
+            close();
+    }
 
-        queue->submit(
-            commandBuffers[bufferIndex],
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            rtSemaphore, // Wait for render-to-texture
-            renderFinished,
-            waitFences[bufferIndex]);
+    void parseVertexFormat(const CommandLine& cmdLine)
+    {   // Packed by default, full float formats can be selected for comparison
+        const std::string positions = cmdLine.getValue("--positions", std::string("u16"));
+        const std::string normals = cmdLine.getValue("--normals", std::string("oct"));
+        const std::string texCoords = cmdLine.getValue("--texcoords", std::string("implicit"));
+        vertexFormat.position = ("f32" == positions) ? PositionFormat::Float32 : PositionFormat::Unorm16;
+        if ("f32" == normals)
+            vertexFormat.normal = NormalFormat::Float32;
+        else if ("1010102" == normals)
+            vertexFormat.normal = NormalFormat::Unorm1010102;
+        else
+            vertexFormat.normal = NormalFormat::Octahedral16;
+        if ("f32" == texCoords)
+            vertexFormat.texCoord = TexCoordFormat::Float32;
+        else if ("u16" == texCoords)
+            vertexFormat.texCoord = TexCoordFormat::Unorm16;
+        else
+            vertexFormat.texCoord = TexCoordFormat::Implicit;
     }
 
     void setupView()
     {
-        const rapid::vector3 eye(0.f, 3.f, 8.f);
-        const rapid::vector3 center(0.f, 2.f, 0.f);
+        setViewProj(rapid::vector3(0.f, 3.f, 8.f), rapid::vector3(0.f, 2.f, 0.f));
+        meshTransform = rapid::identity();
+    }
+
+    void setViewProj(const rapid::vector3& eye, const rapid::vector3& center)
+    {
         const rapid::vector3 up(0.f, 1.f, 0.f);
         const float fov = rapid::radians(60.f);
         const float aspect = width/(float)height;
@@ -78,36 +326,281 @@ public:
         viewProj = view * proj;
     }
 
+    void createCameraPath()
+    {   // Orbit around teapot with varying height and distance, passes close to spout and lid
+        const std::vector<CameraPath::Key> keys = {
+            {{0.f, 3.f, 8.f}, {0.f, 2.f, 0.f}},
+            {{6.f, 4.5f, 5.f}, {0.5f, 2.f, 0.f}},
+            {{5.f, 1.5f, -1.f}, {1.f, 1.5f, 0.f}},
+            {{0.f, 6.f, -6.f}, {0.f, 2.5f, 0.f}},
+            {{-5.f, 2.f, -4.f}, {-0.5f, 2.f, 0.f}},
+            {{-7.f, 3.5f, 4.f}, {0.f, 2.f, 0.f}}
+        };
+        cameraPath = std::make_unique<CameraPath>(keys, 12.f);
+    }
+
     void updatePerspectiveTransform()
     {
         const float speed = 0.05f;
-        static float angle = 0.f;
-        angle += timer->millisecondsElapsed() * speed;
-        const rapid::matrix world = rapid::rotationY(rapid::radians(angle));
-        magma::helpers::mapScoped<rapid::matrix>(uniformBuffer, true, [this, &world](auto *worldViewProj)
+        // Fixed step in benchmark mode, so that every run renders the same frames
+        const float elapsed = benchmark ? benchmark->getTimestep() : timer->millisecondsElapsed();
+        angle += elapsed * speed;
+        if (cameraPath)
         {
-            *worldViewProj = world * viewProj;
+            float eye[3], center[3];
+            cameraPath->evaluate(benchmark->getTime(), eye, center);
+            setViewProj(rapid::vector3(eye[0], eye[1], eye[2]), rapid::vector3(center[0], center[1], center[2]));
+        }
+        if (scene)
+        {   // Each instance spins on its own, shared uniform has only camera
+            updateInstances(elapsed * 0.001f);
+            return;
+        }
+        const rapid::matrix world = meshTransform * rapid::rotationY(rapid::radians(angle));
+        const rapid::matrix worldViewProj = world * viewProj;
+        magma::helpers::mapScoped<rapid::matrix>(uniformBuffer, true, [&worldViewProj](auto *data)
+        {
+            *data = worldViewProj;
         });
+        if (cull && patchMesh)
+            cullPatches(worldViewProj);
+        if (gpuCuller)
+            gpuCuller->setWorldViewProj(reinterpret_cast<const float *>(&worldViewProj));
+        if (meshEdges)
+            extractEdges(worldViewProj);
+    }
+
+    void extractEdges(const rapid::matrix& worldViewProj)
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        PatchCuller view; // Only to get eye position in object space
+        view.setWorldViewProj(reinterpret_cast<const float *>(&worldViewProj));
+        if (!view.hasEye())
+            return;
+        const uint32_t count = meshEdges->extract(view.getEye(), edgeLines->getVertices(), &edgeStats);
+        edgeTime += std::chrono::high_resolution_clock::now() - start;
+        ++edgeFrames;
+        if (count != edgeLineCount)
+        {
+            edgeLineCount = count;
+            recordRenderToTextureCommandBuffer();
+        }
+    }
+
+    void updateInstances(float dt)
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        scene->update(dt, instanceBuffer->getTransforms());
+        instanceUpdateTime += std::chrono::high_resolution_clock::now() - start;
+        ++instanceUpdates;
+        magma::helpers::mapScoped<rapid::matrix>(uniformBuffer, true, [this](auto *data)
+        {
+            *data = viewProj;
+        });
+    }
+
+    void cullPatches(const rapid::matrix& worldViewProj)
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        culler.setWorldViewProj(reinterpret_cast<const float *>(&worldViewProj));
+        const bool changed = patchMesh->cull(culler, &cullStats);
+        cullTime += std::chrono::high_resolution_clock::now() - start;
+        if (changed)
+            recordRenderToTextureCommandBuffer();
+    }
+
+    void loadPatches()
+    {
+        ThreadPool pool;
+        PatchFileStats stats;
+        const auto start = std::chrono::high_resolution_clock::now();
+        patchSet = loadPatchFile(patchFile, &pool, &stats);
+        const std::chrono::duration<float> loadTime = std::chrono::high_resolution_clock::now() - start;
+        patches = patchSet.getPatches();
+        numPatches = patchSet.getPatchCount();
+        patchVertices = patchSet.getVertices();
+        std::cout << "Loaded " << numPatches << " patches (" << patchSet.getVertexCount() << " control points) from "
+            << patchFile << " in " << loadTime.count() * 1000.f << " ms, "
+            << stats.fileSize / 1e6f / loadTime.count() << " MB/s, "
+            << numPatches / 1e6f / loadTime.count() << "M patches/s (" << stats.chunkCount << " chunks on "
+            << pool.getThreadCount() << " threads)\n";
     }
 
     void createMesh()
     {
-        const uint32_t subdivisionDegree = 8;
-        mesh = std::make_unique<BezierPatchMesh>(teapotPatches, kTeapotNumPatches, teapotVertices, subdivisionDegree, cmdBufferCopy);
+        if (gpuCull && !gpuBezier)
+        {
+            std::cout << "GPU culling requires --gpu-bezier, drawing without it\n";
+            gpuCull = false;
+        }
+        if (gpuBezier)
+        {   // Patches are evaluated in vertex shader from control points
+            std::unique_ptr<BezierControlMesh> bezierMesh(std::make_unique<BezierControlMesh>(
+                patches, numPatches, patchVertices, subdivisionDegree, cmdBufferCopy));
+            const uint64_t bakedSize = BezierPatchMesh::getMemorySize(numPatches, subdivisionDegree);
+            std::cout << "Control point mesh takes " << bezierMesh->getMemorySize() << " bytes, "
+                << bakedSize / (float)bezierMesh->getMemorySize() << "x less than baked vertices\n";
+            if (gpuCull)
+            {   // Visible patches are selected in compute shader
+                gpuCuller = std::make_shared<GpuPatchCuller>(device, pipelineCache,
+                    bezierMesh->getBounds(), bezierMesh->getIndexCount(), cmdBufferCopy);
+                bezierMesh->setCuller(gpuCuller);
+            }
+            controlMesh = bezierMesh.get();
+            mesh = std::move(bezierMesh);
+        }
+        else if (weld || optimize || pack)
+        {
+            IndexedMesh patchMesh = tessellateBezierPatches(patches, numPatches, patchVertices, subdivisionDegree);
+            if (weld)
+            {   // Merge vertices on shared patch borders and poles into one mesh
+                const WeldStats stats = weldVertices(patchMesh);
+                std::cout << "Welded " << stats.vertexCountBefore << " vertices to " << stats.vertexCountAfter
+                    << " (" << stats.degenerateTriangles << " degenerate triangles removed), "
+                    << stats.bytesBefore << " to " << stats.bytesAfter << " bytes\n";
+            }
+            if (optimize)
+                optimizeMesh(patchMesh);
+            if (pack)
+                mesh = std::make_unique<StaticMesh>(packVertices(patchMesh), cmdBufferCopy);
+            else
+                mesh = std::make_unique<StaticMesh>(patchMesh, cmdBufferCopy);
+        }
+        else
+        {
+            if (staticMesh && !patchFile.empty())
+            {
+                std::cout << "Static mesh is built-in teapot, tessellating patch file at startup\n";
+                staticMesh = false;
+            }
+            else if (staticMesh && subdivisionDegree != teapotMesh.subdivisionDegree)
+            {
+                std::cout << "Static mesh is baked with subdivision " << teapotMesh.subdivisionDegree
+                    << ", tessellating at startup\n";
+                staticMesh = false;
+            }
+            const auto start = std::chrono::high_resolution_clock::now();
+            std::unique_ptr<BezierPatchMesh> bezierMesh(staticMesh ?
+                std::make_unique<BezierPatchMesh>(getPatchMeshData(teapotMesh), cmdBufferCopy) :
+                std::make_unique<BezierPatchMesh>(patches, numPatches, patchVertices, subdivisionDegree, cmdBufferCopy));
+            const std::chrono::duration<float, std::milli> loadTime = std::chrono::high_resolution_clock::now() - start;
+            std::cout << (staticMesh ? "Uploaded static" : "Tessellated and uploaded") << " patch mesh in "
+                << loadTime.count() << " ms\n";
+            patchMesh = bezierMesh.get();
+            mesh = std::move(bezierMesh);
+        }
+    }
+
+    void createScene()
+    {
+        if (controlMesh || pack)
+        {   // Instance stream follows float position, normal and texcoord streams
+            std::cout << "Instancing requires unpacked CPU-tessellated mesh, drawing single object\n";
+            instanceCount = 1;
+            return;
+        }
+        // Lay out copies on a grid that fills the same view as single teapot
+        const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(instanceCount))));
+        const uint32_t rows = (instanceCount + columns - 1) / columns;
+        const float spacing = 8.f / columns;
+        const float scale = spacing / 7.f; // Teapot is about 6.5 units wide
+        scene = std::make_unique<InstancedScene>();
+        for (uint32_t i = 0; i < instanceCount; ++i)
+        {
+            const uint32_t column = i % columns, row = i / columns;
+            const float x = (column - (columns - 1) * .5f) * spacing;
+            const float y = 2.f + (row - (rows - 1) * .5f) * spacing - 1.5f * scale;
+            const float angle = i * 0.61803399f * 6.2831853f; // Golden ratio to decorrelate phases
+            const float speed = rapid::radians(30.f + 40.f * ((i * 7919) % 101) / 100.f);
+            scene->addInstance(x, y, 0.f, scale, angle, (i & 1) ? speed : -speed);
+        }
+        instanceBuffer = std::make_unique<InstanceBuffer>(device, instanceCount);
+        scene->update(0.f, instanceBuffer->getTransforms());
+        mesh->setInstanceCount(instanceCount);
+        if (cull)
+        {   // Patch bounds are not transformed per instance
+            std::cout << "Patch culling doesn't support instancing, drawing all patches\n";
+            cull = false;
+        }
     }
 
-    void createFramebuffer(const VkExtent2D& extent)
+    void createMeshEdges()
     {
-        fb.color = std::make_shared<magma::ColorAttachment2D>(device, VK_FORMAT_R8_UNORM, extent, 1, 1);
-        fb.colorView = std::make_shared<magma::ImageView>(fb.color);
+        if (controlMesh || pack || scene)
+        {   // Edges are extracted in object space of single float mesh
+            std::cout << "Mesh edges require unpacked CPU-tessellated mesh, using image-space filter\n";
+            meshEdgeMode = false;
+            return;
+        }
+        // Adjacency needs shared vertices on patch borders, so build it from welded tessellation
+        IndexedMesh patchMesh = tessellateBezierPatches(patches, numPatches, patchVertices, subdivisionDegree);
+        weldVertices(patchMesh);
+        meshEdges = std::make_unique<MeshEdges>(patchMesh, static_cast<float>(creaseAngle));
+        edgeLines = std::make_unique<EdgeLines>(device, meshEdges->getEdgeCount());
+        std::cout << "Built adjacency of " << meshEdges->getEdgeCount() << " edges\n";
+    }
+
+    void optimizeMesh(IndexedMesh& patchMesh) const
+    {
+        const VertexCacheStats before = analyzeVertexCache(patchMesh.indices.data(), patchMesh.indices.size(), patchMesh.getVertexCount());
+        optimizeVertexCache(patchMesh.indices.data(), patchMesh.indices.size(), patchMesh.getVertexCount());
+        optimizeVertexFetch(patchMesh);
+        const VertexCacheStats after = analyzeVertexCache(patchMesh.indices.data(), patchMesh.indices.size(), patchMesh.getVertexCount());
+        const MeshletList meshlets = buildMeshlets(patchMesh.indices.data(), patchMesh.indices.size(), patchMesh.getVertexCount());
+        std::cout << "Vertex cache ACMR " << before.acmr << " -> " << after.acmr
+            << ", ATVR " << before.atvr << " -> " << after.atvr
+            << ", " << meshlets.meshlets.size() << " meshlets of "
+            << patchMesh.getTriangleCount() / (float)meshlets.meshlets.size() << " triangles on average\n";
+    }
+
+    PackedMesh packVertices(const IndexedMesh& patchMesh)
+    {
+        PackedMesh packedMesh = packMesh(patchMesh, vertexFormat);
+        const rapid::float3& lo = packedMesh.boundsMin;
+        const rapid::float3& ext = packedMesh.boundsExtent;
+        // Dequantize positions with world transform
+        meshTransform = rapid::scaling(ext.x, ext.y, ext.z) * rapid::translation(lo.x, lo.y, lo.z);
+        std::cout << "Packed " << packedMesh.vertexCount << " vertices to " << vertexFormat.getVertexSize()
+            << " bytes each (" << sizeof(rapid::float3) * 2 + sizeof(rapid::float2) << " unpacked), "
+            << packedMesh.indexSize * 8 << "-bit indices, "
+            << patchMesh.getMemorySize() << " to " << packedMesh.getMemorySize() << " bytes, "
+            << "max position error " << packedMesh.maxPositionError
+            << ", max normal error " << packedMesh.maxNormalErrorDegrees << " degrees\n";
+        return packedMesh;
+    }
+
+    Framebuffer createMaskTarget(const VkExtent2D& extent) const
+    {
+        Framebuffer target;
+        target.color = std::make_shared<magma::ColorAttachment2D>(device, VK_FORMAT_R8_UNORM, extent, 1, 1);
+        target.colorView = std::make_shared<magma::ImageView>(target.color);
 
         // Make sure that we are fit to hardware limits
         const VkImageFormatProperties formatProperties = physicalDevice->getImageFormatProperties(
-            fb.color->getFormat(), VK_IMAGE_TYPE_2D, true, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
-        const magma::AttachmentDescription colorAttachment(fb.color->getFormat(), 1,
+            target.color->getFormat(), VK_IMAGE_TYPE_2D, true, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+        const magma::AttachmentDescription colorAttachment(target.color->getFormat(), 1,
             magma::attachments::colorClearStoreReadOnly);
-        fb.renderPass = std::make_shared<magma::RenderPass>(device, colorAttachment);
-        fb.framebuffer = std::make_shared<magma::Framebuffer>(fb.renderPass, fb.colorView);
+        if (meshEdges)
+        {   // Faces are drawn to depth only to hide occluded edges
+            const VkFormat depthFormat = getSupportedDepthFormat(false, true);
+            target.depth = std::make_shared<magma::DepthStencilAttachment2D>(device, depthFormat, extent, 1, 1);
+            target.depthView = std::make_shared<magma::ImageView>(target.depth);
+            const magma::AttachmentDescription depthAttachment(depthFormat, 1,
+                magma::op::clearDontCare, // Clear depth, don't care
+                magma::op::dontCareDontCare, // Stencil don't care
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+            const std::initializer_list<magma::AttachmentDescription> attachments = {colorAttachment, depthAttachment};
+            target.renderPass = std::make_shared<magma::RenderPass>(device, attachments);
+            target.framebuffer = std::make_shared<magma::Framebuffer>(target.renderPass,
+                std::vector<std::shared_ptr<const magma::ImageView>>{target.colorView, target.depthView});
+        }
+        else
+        {
+            target.renderPass = std::make_shared<magma::RenderPass>(device, colorAttachment);
+            target.framebuffer = std::make_shared<magma::Framebuffer>(target.renderPass, target.colorView);
+        }
+        return target;
     }
 
     void createUniformBuffer()
@@ -119,20 +612,28 @@ public:
     {   // Create descriptor pool
         constexpr uint32_t maxDescriptorSets = 1; // One set is enough for us
         const magma::Descriptor uniformBufferDesc = magma::descriptors::UniformBuffer(1);
-        descriptorPool = std::make_shared<magma::DescriptorPool>(device, maxDescriptorSets,
-            std::vector<magma::Descriptor>
-            {   // Allocate simply one uniform buffer
-                uniformBufferDesc
-            });
-        // Setup descriptor set layout:
-        // Here we describe that slot 0 in vertex shader will have uniform buffer binding
-        descriptorSetLayout = std::make_shared<magma::DescriptorSetLayout>(device,
-            std::initializer_list<magma::DescriptorSetLayout::Binding>{
-                magma::bindings::VertexStageBinding(0, uniformBufferDesc)
-            });
-        // Connect our uniform buffer to binding point
+        const magma::Descriptor storageBufferDesc = magma::descriptors::StorageBuffer(2);
+        std::vector<magma::Descriptor> descriptors{uniformBufferDesc};
+        std::vector<magma::DescriptorSetLayout::Binding> bindings{
+            // Here we describe that slot 0 in vertex shader will have uniform buffer binding
+            magma::bindings::VertexStageBinding(0, uniformBufferDesc)
+        };
+        if (controlMesh)
+        {   // Slot 1 has patch control points, slot 2 maps instances to patches
+            descriptors.push_back(storageBufferDesc);
+            bindings.push_back(magma::bindings::VertexStageBinding(1, magma::descriptors::StorageBuffer(1)));
+            bindings.push_back(magma::bindings::VertexStageBinding(2, magma::descriptors::StorageBuffer(1)));
+        }
+        descriptorPool = std::make_shared<magma::DescriptorPool>(device, maxDescriptorSets, descriptors);
+        descriptorSetLayout = std::make_shared<magma::DescriptorSetLayout>(device, bindings);
+        // Connect our buffers to binding points
         descriptorSet = descriptorPool->allocateDescriptorSet(descriptorSetLayout);
         descriptorSet->update(0, uniformBuffer);
+        if (controlMesh)
+        {
+            descriptorSet->update(1, controlMesh->getControlPoints());
+            descriptorSet->update(2, controlMesh->getPatchIndices());
+        }
     }
 
     void setupPipelines()
@@ -141,10 +642,10 @@ public:
         rtSolidDrawPipeline = std::make_shared<magma::GraphicsPipeline>(device, pipelineCache,
             std::vector<magma::PipelineShaderStage>
             {
-                VertexShader(device, "transform.o"),
-                FragmentShader(device, "fill.o")
+                VertexShader(device, getVertexShaderFileName()),
+                FragmentShader(device, meshEdges ? "black.o" : "fill.o")
             },
-            mesh->getVertexInput(),
+            scene ? InstanceBuffer::getVertexInput() : mesh->getVertexInput(),
             magma::renderstates::triangleList,
             magma::renderstates::fillCullBackCW,
             magma::renderstates::noMultisample,
@@ -153,6 +654,42 @@ public:
             std::initializer_list<VkDynamicState>{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR},
             rtPipelineLayout,
             fb.renderPass);
+        if (meshEdges)
+        {
+            rtEdgeLinePipeline = std::make_shared<magma::GraphicsPipeline>(device, pipelineCache,
+                std::vector<magma::PipelineShaderStage>
+                {
+                    VertexShader(device, "lines.o"),
+                    FragmentShader(device, "fill.o")
+                },
+                EdgeLines::getVertexInput(),
+                magma::renderstates::lineList,
+                magma::renderstates::fillCullNoneCW,
+                magma::renderstates::noMultisample,
+                magma::renderstates::depthLessOrEqual,
+                magma::renderstates::dontBlendWriteRGB,
+                std::initializer_list<VkDynamicState>{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR},
+                rtPipelineLayout,
+                fb.renderPass);
+        }
+    }
+
+    const char *getVertexShaderFileName() const
+    {
+        if (controlMesh)
+            return "bezier.o";
+        if (scene)
+            return "instanced.o";
+        if (pack)
+        {   // Variants differ in normal decoding, none reads texture coordinates
+            switch (vertexFormat.normal)
+            {
+            case NormalFormat::Octahedral16: return "packedOct16.o";
+            case NormalFormat::Unorm1010102: return "packed1010102.o";
+            default: return "packedFloat.o";
+            }
+        }
+        return "transform.o";
     }
 
     void createBlitRectangle()
@@ -167,36 +704,372 @@ public:
         renderPass = std::make_shared<magma::RenderPass>(device, colorAttachment);
 
         blitRect = std::make_unique<magma::aux::BlitRectangle>(renderPass,
+            VertexShader(device, "quad.o"),
+            FragmentShader(device, meshEdges ? "copy.o" : "sobel.o"));
+    }
+
+    void createAsyncFilter()
+    {   // The first frame slot renders to the same target as single queue path
+        asyncFrames.resize(AsyncEdgeFilter::frameCount);
+        std::vector<std::shared_ptr<magma::Image2D>> masks;
+        std::vector<std::shared_ptr<magma::ImageView>> maskViews;
+        for (uint32_t i = 0; i < AsyncEdgeFilter::frameCount; ++i)
+        {
+            AsyncFrame& frame = asyncFrames[i];
+            frame.fb = i ? createMaskTarget(fb.framebuffer->getExtent()) : fb;
+            masks.push_back(frame.fb.color);
+            maskViews.push_back(frame.fb.colorView);
+        }
+        asyncFilter = std::make_unique<AsyncEdgeFilter>(physicalDevice, pipelineCache,
+            queue, computeQueue, computeCommandPool, masks, maskViews);
+        if (!asyncFilter->separateFamilies())
+            std::cout << "No dedicated compute queue family, edge filter is submitted to graphics family\n";
+        for (uint32_t i = 0; i < AsyncEdgeFilter::frameCount; ++i)
+        {   // Edges are filtered already, so presentation only copies them
+            AsyncFrame& frame = asyncFrames[i];
+            frame.rtCmdBuffer = commandPools[0]->allocateCommandBuffer(true);
+            frame.blitRect = std::make_unique<magma::aux::BlitRectangle>(renderPass,
+                VertexShader(device, "quad.o"),
+                FragmentShader(device, "copy.o"));
+            frame.cmdBuffers = commandPools[0]->allocateCommandBuffers(static_cast<uint32_t>(framebuffers.size()), true);
+            for (uint32_t j = 0; j < static_cast<uint32_t>(framebuffers.size()); ++j)
+            {
+                const std::shared_ptr<magma::CommandBuffer>& cmdBuffer = frame.cmdBuffers[j];
+                cmdBuffer->begin();
+                {
+                    asyncFilter->recordEdgeAcquire(*cmdBuffer, i);
+                    frame.blitRect->blit(framebuffers[j], asyncFilter->getEdgeView(i), cmdBuffer);
+                }
+                cmdBuffer->end();
+            }
+        }
+    }
+
+    void setupReadback(const VkExtent2D& extent)
+    {   // Edge image is rendered to offscreen target to be copied to host
+        edgeFb.color = std::make_shared<magma::ColorAttachment2D>(device, VK_FORMAT_R8_UNORM, extent, 1, 1);
+        edgeFb.colorView = std::make_shared<magma::ImageView>(edgeFb.color);
+        const magma::AttachmentDescription colorAttachment(edgeFb.color->getFormat(), 1,
+            magma::op::dontCareStore, // Don't care, store
+            magma::op::dontCareDontCare, // Stencil don't care
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        edgeFb.renderPass = std::make_shared<magma::RenderPass>(device, colorAttachment);
+        edgeFb.framebuffer = std::make_shared<magma::Framebuffer>(edgeFb.renderPass, edgeFb.colorView);
+        edgeBlitRect = std::make_unique<magma::aux::BlitRectangle>(edgeFb.renderPass,
             VertexShader(device, "quad.o"),
             FragmentShader(device, "sobel.o"));
+        readback = std::make_unique<ImageReadback>(commandPools[0], edgeFb.color, readbackSlots,
+            [this](uint64_t frame, const uint8_t *pixels, uint32_t width, uint32_t height)
+            {   // Called from writer thread
+                writeEdgeImage("edge", frame, pixels, width, height);
+            },
+            [this](std::shared_ptr<magma::CommandBuffer> cmdBuffer)
+            {   // Wait for mask from previous submission
+                cmdBuffer->pipelineBarrier(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    magma::MemoryBarrier(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+                edgeBlitRect->blit(edgeFb.framebuffer, fb.colorView, cmdBuffer);
+            });
     }
 
-    void recordRenderToTextureCommandBuffer()
-    {
-        rtCmdBuffer = commandPools[0]->allocateCommandBuffer(true);
-        rtSemaphore = std::make_shared<magma::Semaphore>(device);
+    void writeEdgeImage(const char *prefix, uint64_t frame, const uint8_t *pixels, uint32_t width, uint32_t height) const
+    {   // May be called from writer thread, so failure is reported rather than thrown
+        const std::string index = std::to_string(frame);
+        const std::string filename = readbackDir + "/" + prefix + std::string(6 - std::min<size_t>(6, index.size()), '0') + index +
+            getFileExtension(ImageFileFormat::Pgm);
+        EncodedBuffer data;
+        encodePgm(pixels, width, height, data);
+        if (!writeFile(filename, data))
+            std::cerr << "Failed to write " << filename << std::endl;
+    }
 
-        rtCmdBuffer->begin();
+    void runTurntable()
+    {   // Catalog views around the model, layered batch is compared with one view per submission
+        if (controlMesh || pack || scene)
+        {
+            std::cout << "Turntable batch requires unpacked CPU-tessellated mesh\n";
+            return;
+        }
+        if (!extensions->EXT_shader_viewport_index_layer)
+        {
+            std::cout << "Turntable batch requires VK_EXT_shader_viewport_index_layer\n";
+            return;
+        }
+        const VkPhysicalDeviceLimits& limits = physicalDevice->getProperties().limits;
+        const uint32_t viewCount = std::min({turntableViews, TurntableBatch::maxViews,
+            limits.maxFramebufferLayers, limits.maxImageArrayLayers});
+        const rapid::vector3 center(0.f, 2.f, 0.f);
+        const rapid::vector3 up(0.f, 1.f, 0.f);
+        const rapid::matrix proj = rapid::perspectiveFovRH(rapid::radians(60.f), width/(float)height, 1.f, 100.f);
+        std::vector<rapid::matrix> views(viewCount);
+        for (uint32_t i = 0; i < viewCount; ++i)
+        {   // Same distance and height as interactive view
+            const float angle = 2.f * 3.14159265f * i / viewCount;
+            const rapid::vector3 eye(8.f * std::sin(angle), 3.f, 8.f * std::cos(angle));
+            views[i] = rapid::lookAtRH(eye, center, up) * proj;
+        }
+        TurntableBatch batch(device, pipelineCache, mesh->getVertexInput(), width, height, viewCount);
+        TurntableBatch single(device, pipelineCache, mesh->getVertexInput(), width, height, 1);
+        batch.setViews(reinterpret_cast<const float *>(views.data()));
+        std::shared_ptr<magma::CommandBuffer> batchCmdBuffer = commandPools[0]->allocateCommandBuffer(true);
+        batchCmdBuffer->begin();
+        batch.record(*batchCmdBuffer, *mesh);
+        batchCmdBuffer->end();
+        std::shared_ptr<magma::CommandBuffer> singleCmdBuffer = commandPools[0]->allocateCommandBuffer(true);
+        singleCmdBuffer->begin();
+        single.record(*singleCmdBuffer, *mesh);
+        singleCmdBuffer->end();
+        std::shared_ptr<magma::Fence> fence = std::make_shared<magma::Fence>(device);
+        auto submitAndWait = [this, &fence](const std::shared_ptr<magma::CommandBuffer>& cmdBuffer)
+        {
+            fence->reset();
+            queue->submit(cmdBuffer, 0, nullptr, nullptr, fence);
+            fence->wait();
+        };
+        constexpr uint32_t rounds = 10;
+        submitAndWait(batchCmdBuffer); // Warm up
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < rounds; ++i)
+            submitAndWait(batchCmdBuffer);
+        const std::chrono::duration<double> batchTime = std::chrono::high_resolution_clock::now() - start;
+        start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < rounds; ++i)
+        {
+            for (const rapid::matrix& viewProj : views)
+            {   // Baseline: upload camera, submit and wait for every view
+                single.setViews(reinterpret_cast<const float *>(&viewProj));
+                submitAndWait(singleCmdBuffer);
+            }
+        }
+        const std::chrono::duration<double> singleTime = std::chrono::high_resolution_clock::now() - start;
+        const double batchRate = rounds * viewCount / batchTime.count();
+        const double singleRate = rounds * viewCount / singleTime.count();
+        std::cout << "Turntable of " << viewCount << " views: " << batchRate << " views/s batched, "
+            << singleRate << " views/s one view per submission (" << batchRate / singleRate << "x)\n";
+        if (!readbackDir.empty())
+        {
+            std::shared_ptr<magma::CommandBuffer> copyCmdBuffer = commandPools[0]->allocateCommandBuffer(true);
+            copyCmdBuffer->begin();
+            batch.record(*copyCmdBuffer, *mesh);
+            batch.recordReadback(*copyCmdBuffer);
+            copyCmdBuffer->end();
+            submitAndWait(copyCmdBuffer);
+            for (uint32_t i = 0; i < viewCount; ++i)
+                writeEdgeImage("turntable", i, batch.getEdgeLayer(i), width, height);
+        }
+    }
+
+    void benchmarkRecording()
+    {   // Re-record the same commands, GPU is not involved
+        recordRenderToTextureCommandBuffer(); // Warm up
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < recordRounds; ++i)
+            recordRenderToTextureCommandBuffer();
+        const std::chrono::duration<double, std::micro> recordTime = std::chrono::high_resolution_clock::now() - start;
+        const double perRecording = recordTime.count() / recordRounds;
+        std::cout << "Recorded " << mesh->getDrawCount() << " draws in " << perRecording << " us, "
+            << perRecording * 1000. / mesh->getDrawCount() << " us per 1000 draws";
+        if (recorder)
+        {
+            std::cout << " (" << recorder->getSliceCount(mesh->getDrawCount()) << " slices on "
+                << recorder->getThreadCount() << " threads)";
+        }
+        std::cout << "\n";
+    }
+
+    void benchmarkHostAllocator()
+    {   // Same object churn with driver's own host allocator and with pooled one
+        std::ifstream file("cull.o", std::ios::in | std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("failed to open file \"cull.o\"");
+        const std::vector<char> code((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        PoolHostAllocator hostAllocator;
+        const VkAllocationCallbacks *allocators[] = {nullptr, hostAllocator};
+        for (const VkAllocationCallbacks *allocator : allocators)
+        {
+            createTestPipeline(code, allocator); // Warm up
+            createTestCommandPool(allocator);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (uint32_t i = 0; i < hostAllocRounds; ++i)
+                createTestPipeline(code, allocator);
+            const std::chrono::duration<double, std::micro> pipelineTime = std::chrono::high_resolution_clock::now() - start;
+            start = std::chrono::high_resolution_clock::now();
+            for (uint32_t i = 0; i < hostAllocRounds; ++i)
+                createTestCommandPool(allocator);
+            const std::chrono::duration<double, std::micro> cmdBufferTime = std::chrono::high_resolution_clock::now() - start;
+            std::cout << (allocator ? "Pooled" : "Driver") << " host allocator: compute pipeline in "
+                << pipelineTime.count() / hostAllocRounds << " us, pool of 16 command buffers in "
+                << cmdBufferTime.count() / hostAllocRounds << " us\n";
+        }
+        hostAllocator.printStatistics();
+    }
+
+    void createTestPipeline(const std::vector<char>& code, const VkAllocationCallbacks *allocator)
+    {   // Module, layouts and pipeline are object scope, compilation itself is command scope
+        const VkDevice hDevice = *device;
+        VkShaderModuleCreateInfo moduleInfo = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+        moduleInfo.codeSize = code.size();
+        moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+        VkShaderModule module;
+        if (vkCreateShaderModule(hDevice, &moduleInfo, allocator, &module) != VK_SUCCESS)
+            throw std::runtime_error("failed to create shader module");
+        VkDescriptorSetLayoutBinding bindings[4] = {};
+        for (uint32_t i = 0; i < 4; ++i)
+        {   // Same as GpuPatchCuller
+            bindings[i].binding = i;
+            bindings[i].descriptorType = i ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        VkDescriptorSetLayoutCreateInfo setLayoutInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+        setLayoutInfo.bindingCount = 4;
+        setLayoutInfo.pBindings = bindings;
+        VkDescriptorSetLayout setLayout;
+        if (vkCreateDescriptorSetLayout(hDevice, &setLayoutInfo, allocator, &setLayout) != VK_SUCCESS)
+        {
+            vkDestroyShaderModule(hDevice, module, allocator);
+            throw std::runtime_error("failed to create descriptor set layout");
+        }
+        VkPipelineLayoutCreateInfo layoutInfo = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+        layoutInfo.setLayoutCount = 1;
+        layoutInfo.pSetLayouts = &setLayout;
+        VkPipelineLayout layout;
+        if (vkCreatePipelineLayout(hDevice, &layoutInfo, allocator, &layout) != VK_SUCCESS)
+        {
+            vkDestroyDescriptorSetLayout(hDevice, setLayout, allocator);
+            vkDestroyShaderModule(hDevice, module, allocator);
+            throw std::runtime_error("failed to create pipeline layout");
+        }
+        VkComputePipelineCreateInfo pipelineInfo = {VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = module;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = layout;
+        pipelineInfo.basePipelineIndex = -1;
+        VkPipeline pipeline; // No cache, so that driver compiles shader each time
+        const VkResult result = vkCreateComputePipelines(hDevice, VK_NULL_HANDLE, 1, &pipelineInfo, allocator, &pipeline);
+        if (VK_SUCCESS == result)
+            vkDestroyPipeline(hDevice, pipeline, allocator);
+        vkDestroyPipelineLayout(hDevice, layout, allocator);
+        vkDestroyDescriptorSetLayout(hDevice, setLayout, allocator);
+        vkDestroyShaderModule(hDevice, module, allocator);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create compute pipeline");
+    }
+
+    void createTestCommandPool(const VkAllocationCallbacks *allocator)
+    {   // Command buffers use allocator of their pool, recording allocates in command scope
+        const VkDevice hDevice = *device;
+        VkCommandPoolCreateInfo poolInfo = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        poolInfo.queueFamilyIndex = queue->getFamilyIndex();
+        VkCommandPool pool;
+        if (vkCreateCommandPool(hDevice, &poolInfo, allocator, &pool) != VK_SUCCESS)
+            throw std::runtime_error("failed to create command pool");
+        VkCommandBufferAllocateInfo allocInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocInfo.commandPool = pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 16;
+        VkCommandBuffer cmdBuffers[16];
+        if (vkAllocateCommandBuffers(hDevice, &allocInfo, cmdBuffers) == VK_SUCCESS)
         {
-            rtCmdBuffer->setRenderArea(0, 0, fb.framebuffer->getExtent());
-            rtCmdBuffer->beginRenderPass(fb.renderPass, fb.framebuffer, {magma::clears::blackColor});
+            VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            for (VkCommandBuffer cmdBuffer : cmdBuffers)
             {
-                const uint32_t width = fb.framebuffer->getExtent().width;
-                const uint32_t height = fb.framebuffer->getExtent().height;
-                rtCmdBuffer->setViewport(0, 0, width, height);
-                rtCmdBuffer->setScissor(magma::Scissor(0, 0, fb.framebuffer->getExtent()));
-                rtCmdBuffer->bindDescriptorSet(rtPipelineLayout, descriptorSet);
-                rtCmdBuffer->bindPipeline(rtSolidDrawPipeline);
-                mesh->draw(rtCmdBuffer);
+                vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+                for (int i = 0; i < 64; ++i)
+                {
+                    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        0, 0, nullptr, 0, nullptr, 0, nullptr);
+                }
+                vkEndCommandBuffer(cmdBuffer);
             }
-            rtCmdBuffer->endRenderPass();
         }
+        vkDestroyCommandPool(hDevice, pool, allocator); // Frees command buffers
+    }
+
+    void recordRenderToTextureCommandBuffer()
+    {   // Also called mid-frame by culling and edge extraction. Without async compute
+        // rtCmdBuffer is not pending then, as VulkanApp::onPaint() waits for device idle
+        // after each present. With async compute it is never submitted: slot buffers are
+        // marked dirty and re-recorded in recordAsyncMask() after AsyncEdgeFilter::beginFrame()
+        // has waited for the previous frame of the slot.
+        if (!rtCmdBuffer)
+        {
+            rtCmdBuffer = commandPools[0]->allocateCommandBuffer(true);
+            rtSemaphore = std::make_shared<magma::Semaphore>(device);
+        }
+
+        rtCmdBuffer->begin();
+        recordMask(*rtCmdBuffer, fb);
         rtCmdBuffer->end();
+        for (AsyncFrame& frame : asyncFrames)
+            frame.dirty = true; // Re-recorded when its slot comes round
+    }
+
+    void recordAsyncMask(uint32_t slot)
+    {   // Previous frame of this slot is done, see AsyncEdgeFilter::beginFrame()
+        AsyncFrame& frame = asyncFrames[slot];
+        frame.rtCmdBuffer->begin();
+        {
+            asyncFilter->recordMaskBegin(*frame.rtCmdBuffer, slot);
+            recordMask(*frame.rtCmdBuffer, frame.fb);
+            asyncFilter->recordMaskEnd(*frame.rtCmdBuffer, slot);
+        }
+        frame.rtCmdBuffer->end();
+        frame.dirty = false;
+    }
+
+    void recordMask(magma::CommandBuffer& cmdBuffer, const Framebuffer& target)
+    {
+        if (gpuCuller)
+            gpuCuller->recordCulling(cmdBuffer);
+        if (recorder)
+        {
+            std::vector<VkClearValue> clearValues(meshEdges ? 2 : 1);
+            clearValues[0].color = {{0.f, 0.f, 0.f, 1.f}};
+            if (meshEdges)
+                clearValues[1].depthStencil = {1.f, 0};
+            recorder->recordRenderPass(cmdBuffer, *target.renderPass, *target.framebuffer, clearValues, mesh->getDrawCount(),
+                [this](magma::CommandBuffer& sliceCmdBuffer, uint32_t firstDraw, uint32_t drawCount)
+                {
+                    recordDraws(sliceCmdBuffer, firstDraw, drawCount);
+                });
+        }
+        else
+        {
+            cmdBuffer.setRenderArea(0, 0, target.framebuffer->getExtent());
+            if (meshEdges)
+                cmdBuffer.beginRenderPass(target.renderPass, target.framebuffer, {magma::clears::blackColor, magma::clears::depthOne});
+            else
+                cmdBuffer.beginRenderPass(target.renderPass, target.framebuffer, {magma::clears::blackColor});
+            recordDraws(cmdBuffer, 0, mesh->getDrawCount());
+            cmdBuffer.endRenderPass();
+        }
+    }
+
+    void recordDraws(magma::CommandBuffer& cmdBuffer, uint32_t firstDraw, uint32_t drawCount)
+    {   // Secondary command buffer doesn't inherit state, so everything is set per slice
+        const uint32_t width = fb.framebuffer->getExtent().width;
+        const uint32_t height = fb.framebuffer->getExtent().height;
+        cmdBuffer.setViewport(0, 0, width, height);
+        cmdBuffer.setScissor(magma::Scissor(0, 0, fb.framebuffer->getExtent()));
+        cmdBuffer.bindDescriptorSet(rtPipelineLayout, descriptorSet);
+        cmdBuffer.bindPipeline(rtSolidDrawPipeline);
+        if (instanceBuffer)
+            instanceBuffer->bind(cmdBuffer);
+        mesh->draw(cmdBuffer, firstDraw, drawCount);
+        if (edgeLines && firstDraw + drawCount == mesh->getDrawCount())
+        {   // Lines are drawn over faces, so only the last slice records them
+            cmdBuffer.bindPipeline(rtEdgeLinePipeline);
+            edgeLines->draw(cmdBuffer, edgeLineCount);
+        }
     }
 
     void recordCommandBuffer(uint32_t index)
     {
-        std::shared_ptr<magma::CommandBuffer> cmdBuffer = commandBuffers[index];
+        const std::shared_ptr<magma::CommandBuffer>& cmdBuffer = commandBuffers[index];
         cmdBuffer->begin();
         {
             blitRect->blit(framebuffers[index], fb.colorView, cmdBuffer);
@@ -60,6 +60,6 @@ float Scharr(sampler2D s, vec2 uv, float radius)
 
 void main()
 {
-    float grad = Sobel(mask, texCoord);
+    float grad = Sobel(mask, texCoord, 1.);
     oColor = vec4(vec3(grad), 1.);
 }
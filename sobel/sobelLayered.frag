@@ -0,0 +1,38 @@
+#version 450
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 1) flat in int layer;
+layout(location = 0) out vec4 oColor;
+layout(binding = 0) uniform sampler2DArray masks;
+
+float Sobel(sampler2DArray s, vec2 uv, float layer, float radius)
+{
+    mat3 Gx = mat3(-1., 0., 1.,
+                   -2., 0., 2.,
+                   -1., 0., 1.);
+
+    mat3 Gy = mat3(-1., -2., -1.,
+                    0.,  0.,  0.,
+                    1.,  2.,  1.);
+
+    vec2 kernelSize = vec2(radius) / vec2(textureSize(s, 0).xy);
+    vec2 grad = vec2(0.);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            vec2 offset = vec2(i - 1, j - 1) * kernelSize;
+            float lum = texture(s, vec3(uv + offset, layer)).r;
+            grad += vec2(Gx[i][j], Gy[i][j]) * lum;
+        }
+    }
+
+    return length(grad);
+}
+
+void main()
+{
+    float grad = Sobel(masks, texCoord, float(layer), 1.);
+    oColor = vec4(vec3(grad), 1.);
+}
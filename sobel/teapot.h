@@ -1,7 +1,7 @@
 static const unsigned short kTeapotNumPatches = 32;
 static const unsigned short kTeapotNumVertices = 306;
 
-unsigned teapotPatches[kTeapotNumPatches][16] = {
+constexpr unsigned teapotPatches[kTeapotNumPatches][16] = {
 	{  1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15,  16},
 	{  4,  17,  18,  19,   8,  20,  21,  22,  12,  23,  24,  25,  16,  26,  27,  28},
 	{ 19,  29,  30,  31,  22,  32,  33,  34,  25,  35,  36,  37,  28,  38,  39,  40},
@@ -36,7 +36,7 @@ unsigned teapotPatches[kTeapotNumPatches][16] = {
 	{270, 270, 270, 270, 300, 305, 306, 279, 297, 303, 304, 275, 294, 301, 302, 271}
 };
 
-float teapotVertices[kTeapotNumVertices][3] = {
+constexpr float teapotVertices[kTeapotNumVertices][3] = {
 	{ 1.4000,  0.0000,  2.4000},                                                     
 	{ 1.4000, -0.7840,  2.4000},                                                     
 	{ 0.7840, -1.4000,  2.4000},                                                     
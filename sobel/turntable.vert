@@ -0,0 +1,27 @@
+#version 450
+#extension GL_ARB_shader_viewport_layer_array : require
+#define MAX_VIEWS 64
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texCoord;
+
+layout(binding = 0) uniform Views
+{
+    mat4 viewProj[MAX_VIEWS];
+};
+
+layout(location = 0) out vec3 oNormal;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+void main()
+{   // One instance per view, each view has its own layer
+    oNormal = normal;
+    gl_Position = viewProj[gl_InstanceIndex] * position;
+    gl_Position.y = -gl_Position.y;
+    gl_Layer = gl_InstanceIndex;
+}